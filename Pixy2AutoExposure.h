@@ -0,0 +1,132 @@
+//
+// Auto-exposure controller.  Each update() gets the frame rate and, if luma
+// sampling is on (lumaTarget != 0), the mean luminance of a few getRGB
+// samples, and says which camera brightness to use next:
+//  - frame rate below targetFps - fpsBand: darker, the exposure is dragging
+//    the frame rate down
+//  - luminance above lumaTarget + lumaBand: darker
+//  - otherwise, once the hold after the last change has run out, brighter if
+//    the frame rate has headroom (targetFps + fpsBand or more) and the image
+//    isn't bright enough yet (or luma sampling is off)
+// Without luma sampling that last rule probes for the brightest setting that
+// keeps the frame rate up, so every time a step up has to be taken back the
+// hold doubles (up to PIXY_EXPOSURE_MAX_HOLD) and the probing slows down.
+//
+// Luma sampling uses getRGB, which only works in the video program, so
+// TPixy2::serviceExposure() only samples while Pixy runs video anyway and
+// passes no luminance otherwise (the frame rate rules still apply).
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2AUTOEXPOSURE_H
+#define _PIXY2AUTOEXPOSURE_H
+
+#define PIXY_EXPOSURE_DEFAULT_BRIGHTNESS 80
+#define PIXY_EXPOSURE_DEFAULT_FPS 50
+#define PIXY_EXPOSURE_DEFAULT_PERIOD 500 // ms
+#define PIXY_EXPOSURE_MAX_HOLD 64        // updates
+#define PIXY_EXPOSURE_GRID_COLS 4        // luma samples
+#define PIXY_EXPOSURE_GRID_ROWS 3
+
+class Pixy2AutoExposure
+{
+public:
+    Pixy2AutoExposure()
+    {
+        targetFps = PIXY_EXPOSURE_DEFAULT_FPS;
+        fpsBand = 5;
+        lumaTarget = 0;
+        lumaBand = 16;
+        minBrightness = 1;
+        maxBrightness = 255;
+        step = 8;
+        holdUpdates = 2;
+        period = PIXY_EXPOSURE_DEFAULT_PERIOD;
+        running = false;
+        reset(PIXY_EXPOSURE_DEFAULT_BRIGHTNESS);
+    }
+
+    // Start over from brightness b
+    void reset(uint8_t b)
+    {
+        brightness = b;
+        fps = luma = -1;
+        m_hold = 0;
+        m_backoff = holdUpdates;
+        m_raised = false;
+    }
+
+    // Returns the brightness to set, or -1 to leave it as it is
+    int16_t update(int8_t frameRate, int16_t lumaSample);
+
+    // Rec. 601 luma of an RGB value, 0..255
+    static uint8_t lumaOf(uint8_t r, uint8_t g, uint8_t b)
+    {
+        return ((uint16_t)r * 77 + (uint16_t)g * 150 + (uint16_t)b * 29) >> 8;
+    }
+
+    uint8_t targetFps;
+    uint8_t fpsBand;
+    uint8_t lumaTarget; // 0 = don't sample luma
+    uint8_t lumaBand;
+    uint8_t minBrightness;
+    uint8_t maxBrightness;
+    uint8_t step;
+    uint8_t holdUpdates; // updates to wait after a change before going brighter
+    uint16_t period;     // ms between updates
+    bool running;
+
+    uint8_t brightness; // current setting
+    int8_t fps;         // last frame rate, -1 if unknown
+    int16_t luma;       // last luminance, -1 if not sampled
+
+private:
+    uint8_t m_hold;
+    uint8_t m_backoff;
+    bool m_raised; // the last change was a step up
+};
+
+inline int16_t Pixy2AutoExposure::update(int8_t frameRate, int16_t lumaSample)
+{
+    int16_t next;
+    bool tooSlow, tooBright;
+
+    if (frameRate < 0)
+        return -1;
+    fps = frameRate;
+    luma = lumaSample;
+
+    tooSlow = fps < (int16_t)targetFps - fpsBand;
+    tooBright = luma >= 0 && luma > (int16_t)lumaTarget + lumaBand;
+    if (tooSlow || tooBright)
+    {
+        if (brightness <= minBrightness)
+            return -1;
+        // a step up that costs frames was one too many, probe less often
+        if (tooSlow && m_raised && m_backoff < PIXY_EXPOSURE_MAX_HOLD)
+            m_backoff <<= 1;
+        next = brightness > minBrightness + step ? brightness - step : minBrightness;
+        m_raised = false;
+    }
+    else if (m_hold > 0)
+    {
+        m_hold--;
+        return -1;
+    }
+    else if (fps >= (int16_t)targetFps + fpsBand && (luma < 0 || luma < (int16_t)lumaTarget - lumaBand))
+    {
+        if (brightness >= maxBrightness)
+            return -1;
+        next = brightness + step < maxBrightness ? brightness + step : maxBrightness;
+        m_raised = true;
+    }
+    else
+        return -1;
+
+    m_hold = luma >= 0 ? holdUpdates : m_backoff;
+    brightness = next;
+    return next;
+}
+
+#endif
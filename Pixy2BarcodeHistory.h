@@ -0,0 +1,141 @@
+//
+// Ring buffer of recent barcode sightings with a voting filter.  A code is
+// confirmed once it has been seen votesRequired times within window ms, and
+// is only confirmed again after it has been out of sight for a whole window.
+// Each confirmation raises PIXY_EVT_LINE_BARCODE with the code + 1 as value
+// (0 is reserved for "any value" on the message bus).
+//
+// Confirmations are queued and only raised from flushEvents(): an event
+// handler may run straight away on the current fiber and talk to Pixy, which
+// would overwrite the buffer the features were just parsed from.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2BARCODEHISTORY_H
+#define _PIXY2BARCODEHISTORY_H
+
+#define LINE_BARCODE_HISTORY_SIZE 16
+#define LINE_BARCODE_MAX_CODE 15
+#define LINE_BARCODE_DEFAULT_VOTES 3
+#define LINE_BARCODE_DEFAULT_WINDOW 500 // ms
+
+struct BarcodeSighting
+{
+    uint32_t m_time; // ms
+    uint8_t m_x;
+    uint8_t m_y;
+    uint8_t m_flags;
+    uint8_t m_code;
+};
+
+class Pixy2BarcodeHistory
+{
+public:
+    Pixy2BarcodeHistory()
+    {
+        votesRequired = LINE_BARCODE_DEFAULT_VOTES;
+        window = LINE_BARCODE_DEFAULT_WINDOW;
+        clear();
+    }
+
+    void clear()
+    {
+        count = 0;
+        m_next = 0;
+        m_confirmed = 0;
+        m_pending = 0;
+        memset(m_lastSeen, 0, sizeof(m_lastSeen));
+    }
+
+    void add(const Barcode *barcodes, uint8_t numBarcodes, uint32_t now);
+    void flushEvents();
+    // Copy the sightings out oldest first, returns the number copied
+    uint8_t copy(BarcodeSighting *out);
+
+    uint8_t votesRequired;
+    uint16_t window;
+    uint8_t count;
+
+private:
+    uint8_t votes(uint8_t code, uint32_t now);
+
+    BarcodeSighting m_entries[LINE_BARCODE_HISTORY_SIZE];
+    uint8_t m_next;
+    uint16_t m_confirmed; // bit per code, confirmed and still in sight
+    uint16_t m_pending;   // bit per code, confirmed but the event isn't raised yet
+    uint32_t m_lastSeen[LINE_BARCODE_MAX_CODE + 1];
+};
+
+inline uint8_t Pixy2BarcodeHistory::votes(uint8_t code, uint32_t now)
+{
+    uint8_t i, n;
+
+    for (i = 0, n = 0; i < count; i++)
+    {
+        if (m_entries[i].m_code == code && now - m_entries[i].m_time <= window)
+            n++;
+    }
+    return n;
+}
+
+inline void Pixy2BarcodeHistory::add(const Barcode *barcodes, uint8_t numBarcodes, uint32_t now)
+{
+    uint8_t i, code;
+    BarcodeSighting *entry;
+
+    for (i = 0; i < numBarcodes; i++)
+    {
+        code = barcodes[i].m_code;
+        if (code > LINE_BARCODE_MAX_CODE)
+            continue;
+
+        entry = &m_entries[m_next];
+        entry->m_time = now;
+        entry->m_x = barcodes[i].m_x;
+        entry->m_y = barcodes[i].m_y;
+        entry->m_flags = barcodes[i].m_flags;
+        entry->m_code = code;
+        m_next = (m_next + 1) % LINE_BARCODE_HISTORY_SIZE;
+        if (count < LINE_BARCODE_HISTORY_SIZE)
+            count++;
+
+        // out of sight for a whole window -> it's a new pass over the code
+        if (now - m_lastSeen[code] > window)
+            m_confirmed &= ~(1 << code);
+        m_lastSeen[code] = now;
+
+        if (!(m_confirmed & (1 << code)) && votes(code, now) >= votesRequired)
+        {
+            m_confirmed |= 1 << code;
+            m_pending |= 1 << code;
+        }
+    }
+}
+
+inline void Pixy2BarcodeHistory::flushEvents()
+{
+    uint8_t code;
+    uint16_t pending;
+
+    // clear first, a handler may fetch more features and confirm more codes
+    pending = m_pending;
+    m_pending = 0;
+    for (code = 0; pending; code++, pending >>= 1)
+    {
+        if (pending & 1)
+            MicroBitEvent evt(PIXY_EVT_LINE_BARCODE, code + 1);
+    }
+}
+
+inline uint8_t Pixy2BarcodeHistory::copy(BarcodeSighting *out)
+{
+    uint8_t i, start;
+
+    start = count < LINE_BARCODE_HISTORY_SIZE ? 0 : m_next;
+    for (i = 0; i < count; i++)
+        out[i] = m_entries[(start + i) % LINE_BARCODE_HISTORY_SIZE];
+    return count;
+}
+
+#endif
@@ -81,6 +81,11 @@ struct Block
     uint8_t m_age;
 };
 
+#include "Pixy2ColorCodes.h"
+#include "Pixy2Geometry.h"
+#include "Pixy2Heatmap.h"
+#include "Pixy2PanTilt.h"
+
 template <class LinkType>
 class TPixy2;
 
@@ -94,10 +99,24 @@ public:
     }
 
     int8_t getBlocks(bool wait = true, uint8_t sigmap = CCC_SIG_ALL, uint8_t maxBlocks = 0xff);
+    int8_t getColorCodes(bool wait = true, uint8_t maxBlocks = 0xff);
+    // Get blocks and move the pan-tilt servos towards the target, returns the number of blocks
+    int8_t trackPanTilt(bool wait = true);
 
     uint8_t numBlocks;
     Block *blocks;
 
+    // Decoded color codes of the last getColorCodes() call
+    Pixy2ColorCodes codes;
+
+    // Target selection and servo loops of trackPanTilt()
+    Pixy2PanTilt panTilt;
+
+#if PIXY2_ENABLE_HEATMAP
+    // Where the signatures of the frames fetched show up
+    Pixy2Heatmap heatmap;
+#endif
+
 private:
     TPixy2<LinkType> *m_pixy;
 };
@@ -117,13 +136,21 @@ int8_t Pixy2CCC<LinkType>::getBlocks(bool wait, uint8_t sigmap, uint8_t maxBlock
         m_pixy->m_type = CCC_REQUEST_BLOCKS;
 
         // send request
-        m_pixy->sendPacket();
-        if (m_pixy->recvPacket() == 0)
+        if (m_pixy->exchange() == 0)
         {
             if (m_pixy->m_type == CCC_RESPONSE_BLOCKS)
             {
+                PIXY_SPAN_SCOPE(m_pixy->spans, PIXY_SPAN_PARSE, CCC_REQUEST_BLOCKS);
                 blocks = (Block *)m_pixy->m_buf;
                 numBlocks = m_pixy->m_length / sizeof(Block);
+#if PIXY2_ENABLE_TELEMETRY
+                if (m_pixy->telemetry.running)
+                    m_pixy->telemetry.addBlocks(blocks, numBlocks);
+#endif
+#if PIXY2_ENABLE_HEATMAP
+                if (heatmap.running)
+                    heatmap.update(blocks, numBlocks, m_pixy->frameWidth, m_pixy->frameHeight);
+#endif
                 return numBlocks;
             }
             // deal with busy and program changing states from Pixy (we'll wait)
@@ -147,4 +174,34 @@ int8_t Pixy2CCC<LinkType>::getBlocks(bool wait, uint8_t sigmap, uint8_t maxBlock
     }
 }
 
+template <class LinkType>
+int8_t Pixy2CCC<LinkType>::getColorCodes(bool wait, uint8_t maxBlocks)
+{
+    int8_t res;
+
+    codes.numCodes = 0;
+    res = getBlocks(wait, CCC_COLOR_CODES, maxBlocks);
+    if (res < 0)
+        return res;
+    return codes.decode(blocks, numBlocks);
+}
+
+template <class LinkType>
+int8_t Pixy2CCC<LinkType>::trackPanTilt(bool wait)
+{
+    int8_t res;
+
+    res = getBlocks(wait, panTilt.sigmap());
+    if (res < 0)
+        return res;
+    if (panTilt.update(blocks, numBlocks, m_pixy->frameWidth, m_pixy->frameHeight))
+    {
+        // blocks point into the packet buffer, which this overwrites
+        blocks = NULL;
+        numBlocks = 0;
+        m_pixy->setServos(panTilt.status.m_pan, panTilt.status.m_tilt);
+    }
+    return res;
+}
+
 #endif
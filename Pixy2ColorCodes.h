@@ -0,0 +1,167 @@
+//
+// Native decoding of color-code (CC) blocks.  A CC block reports its
+// signature as octal digits packed 3 bits each (e.g. sig 0123 is the color
+// code "1-2-3") and carries a meaningful m_angle.  Pixy2ColorCodes turns a
+// whole frame of blocks into decoded ColorCode records in one pass: digit
+// sequence, index of the matching registered code and a Q14 heading vector
+// taken from the sine table in Pixy2Math.h.
+//
+
+#include "pxt.h"
+#include "Pixy2Math.h"
+
+#ifndef _PIXY2COLORCODES_H
+#define _PIXY2COLORCODES_H
+
+#define CCC_MAX_CODE_DIGITS 5 // 15-bit signature -> at most 5 octal digits
+#define CCC_MAX_REGISTERED_CODES 8
+#define CCC_MAX_CODES 8 // decoded codes kept per frame
+#define CCC_CODE_NO_MATCH 0xff
+
+// ColorCode flags
+#define CCC_CODE_FLAG_INVALID 0x01 // zero digit or fewer than 2 digits
+
+struct ColorCode
+{
+    uint16_t m_signature;
+    uint16_t m_x;
+    uint16_t m_y;
+    uint16_t m_width;
+    uint16_t m_height;
+    int16_t m_angle;
+    int16_t m_headingX; // cos(m_angle) in Q14
+    int16_t m_headingY; // sin(m_angle) in Q14
+    uint8_t m_index;
+    uint8_t m_age;
+    uint8_t m_match; // index into the registered codes or CCC_CODE_NO_MATCH
+    uint8_t m_numDigits;
+    uint8_t m_digits[CCC_MAX_CODE_DIGITS]; // most significant digit first
+    uint8_t m_flags;
+};
+
+class Pixy2ColorCodes
+{
+public:
+    Pixy2ColorCodes()
+    {
+        numCodes = 0;
+        m_numRegistered = 0;
+    }
+
+    // Split a CC signature into its octal digits, returns the number of digits
+    static uint8_t decodeSignature(uint16_t signature, uint8_t *digits);
+    // Convert a code written as decimal digits (e.g. 123) into its signature (0123 octal).
+    // Returns 0 if any digit is outside 1..7 or there are too many digits.
+    static uint16_t encodeDigits(uint32_t decimal);
+
+    int8_t registerCode(uint16_t signature);
+    void clearCodes();
+    uint8_t match(uint16_t signature);
+
+    // Decode every CC block of a frame into codes[], returns numCodes
+    uint8_t decode(const Block *blocks, uint8_t numBlocks);
+
+    uint8_t numCodes;
+    ColorCode codes[CCC_MAX_CODES];
+
+private:
+    uint16_t m_registered[CCC_MAX_REGISTERED_CODES];
+    uint8_t m_numRegistered;
+};
+
+inline uint8_t Pixy2ColorCodes::decodeSignature(uint16_t signature, uint8_t *digits)
+{
+    int8_t shift;
+    uint8_t n;
+
+    // skip leading zero digits, then copy the rest out
+    for (shift = 3 * (CCC_MAX_CODE_DIGITS - 1); shift > 0 && ((signature >> shift) & 0x07) == 0; shift -= 3)
+        ;
+    for (n = 0; shift >= 0; shift -= 3)
+        digits[n++] = (signature >> shift) & 0x07;
+    return n;
+}
+
+inline uint16_t Pixy2ColorCodes::encodeDigits(uint32_t decimal)
+{
+    uint16_t signature;
+    uint8_t d, shift;
+
+    for (signature = 0, shift = 0; decimal > 0; decimal /= 10, shift += 3)
+    {
+        d = decimal % 10;
+        if (d == 0 || d > CCC_MAX_SIGNATURE || shift >= 3 * CCC_MAX_CODE_DIGITS)
+            return 0;
+        signature |= d << shift;
+    }
+    return signature;
+}
+
+inline int8_t Pixy2ColorCodes::registerCode(uint16_t signature)
+{
+    uint8_t i;
+
+    if (signature <= CCC_MAX_SIGNATURE)
+        return PIXY_RESULT_ERROR;
+    i = match(signature);
+    if (i != CCC_CODE_NO_MATCH)
+        return i; // already registered
+    if (m_numRegistered >= CCC_MAX_REGISTERED_CODES)
+        return PIXY_RESULT_ERROR;
+    m_registered[m_numRegistered] = signature;
+    return m_numRegistered++;
+}
+
+inline void Pixy2ColorCodes::clearCodes()
+{
+    m_numRegistered = 0;
+}
+
+inline uint8_t Pixy2ColorCodes::match(uint16_t signature)
+{
+    uint8_t i;
+
+    for (i = 0; i < m_numRegistered; i++)
+    {
+        if (m_registered[i] == signature)
+            return i;
+    }
+    return CCC_CODE_NO_MATCH;
+}
+
+inline uint8_t Pixy2ColorCodes::decode(const Block *blocks, uint8_t numBlocks)
+{
+    uint8_t i, j;
+    ColorCode *code;
+
+    for (i = 0, numCodes = 0; i < numBlocks && numCodes < CCC_MAX_CODES; i++)
+    {
+        if (blocks[i].m_signature <= CCC_MAX_SIGNATURE)
+            continue; // regular block
+
+        code = &codes[numCodes++];
+        code->m_signature = blocks[i].m_signature;
+        code->m_x = blocks[i].m_x;
+        code->m_y = blocks[i].m_y;
+        code->m_width = blocks[i].m_width;
+        code->m_height = blocks[i].m_height;
+        code->m_angle = blocks[i].m_angle;
+        code->m_headingX = pixyCos(blocks[i].m_angle);
+        code->m_headingY = pixySin(blocks[i].m_angle);
+        code->m_index = blocks[i].m_index;
+        code->m_age = blocks[i].m_age;
+        code->m_match = match(code->m_signature);
+        code->m_numDigits = decodeSignature(code->m_signature, code->m_digits);
+        code->m_flags = code->m_numDigits < 2 ? CCC_CODE_FLAG_INVALID : 0;
+        for (j = 0; j < code->m_numDigits; j++)
+        {
+            if (code->m_digits[j] == 0)
+                code->m_flags |= CCC_CODE_FLAG_INVALID;
+        }
+        for (; j < CCC_MAX_CODE_DIGITS; j++)
+            code->m_digits[j] = 0;
+    }
+    return numCodes;
+}
+
+#endif
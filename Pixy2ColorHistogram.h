@@ -0,0 +1,142 @@
+//
+// Color histogram of getRGB samples, integer math only.  Two binnings:
+//   VIDEO_HIST_HSV  12 hue bins of 30 degrees (bin 0 is red, centered on
+//                   0 degrees) plus black, gray and white bins (12, 13, 14)
+//                   for samples with little saturation
+//   VIDEO_HIST_RGB  2 bits per channel, bin = r << 4 | g << 2 | b
+// summarize() reduces it to the mean color and the most populated bins.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2COLORHISTOGRAM_H
+#define _PIXY2COLORHISTOGRAM_H
+
+#define VIDEO_HIST_HSV 0
+#define VIDEO_HIST_RGB 1
+
+#define VIDEO_HIST_MAX_BINS 64
+#define VIDEO_HIST_HUE_BINS 12
+#define VIDEO_HIST_BLACK 12
+#define VIDEO_HIST_GRAY 13
+#define VIDEO_HIST_WHITE 14
+#define VIDEO_HIST_MIN_SATURATION 48 // 0..255, below this a sample counts as black/gray/white
+#define VIDEO_HIST_DOMINANT 3
+#define VIDEO_HIST_NO_BIN 0xff
+
+struct ColorSummary
+{
+    uint16_t m_samples;
+    uint16_t m_counts[VIDEO_HIST_DOMINANT];
+    uint8_t m_bins[VIDEO_HIST_DOMINANT]; // most populated first, VIDEO_HIST_NO_BIN if unused
+    uint8_t m_r;                         // mean color
+    uint8_t m_g;
+    uint8_t m_b;
+    uint8_t m_mode;
+    uint8_t m_reserved;
+};
+
+class Pixy2ColorHistogram
+{
+public:
+    Pixy2ColorHistogram(uint8_t mode = VIDEO_HIST_HSV)
+    {
+        m_mode = mode;
+        m_samples = 0;
+        m_sumR = m_sumG = m_sumB = 0;
+        memset(m_counts, 0, sizeof(m_counts));
+    }
+
+    static uint8_t hsvBin(const uint8_t *rgb);
+    static uint8_t rgbBin(const uint8_t *rgb)
+    {
+        return ((rgb[0] >> 6) << 4) | ((rgb[1] >> 6) << 2) | (rgb[2] >> 6);
+    }
+
+    void add(const uint8_t *rgb)
+    {
+        m_counts[m_mode == VIDEO_HIST_HSV ? hsvBin(rgb) : rgbBin(rgb)]++;
+        m_sumR += rgb[0];
+        m_sumG += rgb[1];
+        m_sumB += rgb[2];
+        m_samples++;
+    }
+
+    void summarize(ColorSummary *summary);
+
+private:
+    uint8_t m_mode;
+    uint16_t m_samples;
+    uint32_t m_sumR;
+    uint32_t m_sumG;
+    uint32_t m_sumB;
+    uint16_t m_counts[VIDEO_HIST_MAX_BINS];
+};
+
+inline uint8_t Pixy2ColorHistogram::hsvBin(const uint8_t *rgb)
+{
+    uint8_t max, min, d;
+    int16_t h;
+
+    max = rgb[0] > rgb[1] ? rgb[0] : rgb[1];
+    max = max > rgb[2] ? max : rgb[2];
+    min = rgb[0] < rgb[1] ? rgb[0] : rgb[1];
+    min = min < rgb[2] ? min : rgb[2];
+    d = max - min;
+
+    if (max == 0 || (uint16_t)d * 255 / max < VIDEO_HIST_MIN_SATURATION)
+    {
+        if (max < 64)
+            return VIDEO_HIST_BLACK;
+        return max < 192 ? VIDEO_HIST_GRAY : VIDEO_HIST_WHITE;
+    }
+
+    if (max == rgb[0])
+        h = 60 * ((int16_t)rgb[1] - rgb[2]) / d;
+    else if (max == rgb[1])
+        h = 120 + 60 * ((int16_t)rgb[2] - rgb[0]) / d;
+    else
+        h = 240 + 60 * ((int16_t)rgb[0] - rgb[1]) / d;
+    // shift by half a bin so that bin 0 is centered on red
+    h += 15;
+    if (h < 0)
+        h += 360;
+    return (h / 30) % VIDEO_HIST_HUE_BINS;
+}
+
+inline void Pixy2ColorHistogram::summarize(ColorSummary *summary)
+{
+    uint8_t i, j, k;
+
+    summary->m_samples = m_samples;
+    summary->m_mode = m_mode;
+    summary->m_reserved = 0;
+    summary->m_r = m_samples ? m_sumR / m_samples : 0;
+    summary->m_g = m_samples ? m_sumG / m_samples : 0;
+    summary->m_b = m_samples ? m_sumB / m_samples : 0;
+    for (j = 0; j < VIDEO_HIST_DOMINANT; j++)
+    {
+        summary->m_bins[j] = VIDEO_HIST_NO_BIN;
+        summary->m_counts[j] = 0;
+    }
+
+    // keep the top bins sorted by inserting each populated bin in place
+    for (i = 0; i < VIDEO_HIST_MAX_BINS; i++)
+    {
+        if (m_counts[i] == 0)
+            continue;
+        for (j = 0; j < VIDEO_HIST_DOMINANT && summary->m_counts[j] >= m_counts[i]; j++)
+            ;
+        if (j == VIDEO_HIST_DOMINANT)
+            continue;
+        for (k = VIDEO_HIST_DOMINANT - 1; k > j; k--)
+        {
+            summary->m_bins[k] = summary->m_bins[k - 1];
+            summary->m_counts[k] = summary->m_counts[k - 1];
+        }
+        summary->m_bins[j] = i;
+        summary->m_counts[j] = m_counts[i];
+    }
+}
+
+#endif
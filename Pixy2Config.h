@@ -0,0 +1,206 @@
+//
+// Compile-time selection of the Pixy2 program modules.  A module that is
+// switched off isn't a member of TPixy2, none of its templates are compiled
+// and its shims in pixy2.cpp are reduced to stubs that fail (return null or
+// an error), so it costs neither flash nor RAM.
+//
+// Select them in the pxt.json of the application, e.g. for a CCC-only build:
+//
+//     "yotta": {
+//         "config": {
+//             "PIXY2_ENABLE_LINE": 0,
+//             "PIXY2_ENABLE_VIDEO": 0
+//         }
+//     }
+//
+// yotta builds see these as YOTTA_CFG_PIXY2_*, CODAL builds as PIXY2_*
+// directly.  Everything is enabled by default.
+//
+// PIXY2_BUFFER_SIZE sets the size of the packet buffer embedded in the Pixy2
+// object, see TPixy2Sized.
+//
+// Bus tuning, see Link2I2C and Link2SPI: PIXY2_I2C_FREQUENCY (Hz, 0 leaves
+// the bus as the runtime set it up), PIXY2_I2C_MAX_SEND (bytes per write),
+// PIXY2_I2C_REPEATED_START and PIXY2_SPI_FREQUENCY (Hz).
+//
+// PIXY2_ENABLE_RECORD (off by default) puts a Link2Record between Pixy2 and
+// the bus, so startRecording() can capture the traffic into a static buffer
+// of PIXY2_RECORD_SIZE bytes, see Pixy2LinkTrace.h.
+//
+// PIXY2_ENABLE_SPANS (off by default) times the phases of every request into
+// a ring of PIXY2_SPAN_COUNT spans, see Pixy2Spans.h.
+//
+// PIXY2_ENABLE_HEATMAP (off by default) keeps a decaying grid of where each
+// signature shows up, PIXY2_HEATMAP_COLS x PIXY2_HEATMAP_ROWS cells per
+// signature, see Pixy2Heatmap.h.
+//
+// PIXY2_ENABLE_LINE_MAP (off by default) maps the intersections the robot
+// passes, up to PIXY2_LINE_MAP_NODES of them, and plans the turns to a goal
+// from it, see Pixy2LineMap.h.
+//
+// PIXY2_GEOMETRY_DSP selects the packed DSP kernels of Pixy2Geometry.h over
+// the scalar ones, on by default where the compiler has the DSP extension.
+//
+// PIXY2_ENABLE_TELEMETRY (off by default) adds the binary telemetry stream of
+// Pixy2Telemetry.h, queued in PIXY2_TELEMETRY_SIZE bytes.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2CONFIG_H
+#define _PIXY2CONFIG_H
+
+#if !defined(PIXY2_ENABLE_CCC) && defined(YOTTA_CFG_PIXY2_ENABLE_CCC)
+#define PIXY2_ENABLE_CCC YOTTA_CFG_PIXY2_ENABLE_CCC
+#endif
+#ifndef PIXY2_ENABLE_CCC
+#define PIXY2_ENABLE_CCC 1
+#endif
+
+#if !defined(PIXY2_ENABLE_LINE) && defined(YOTTA_CFG_PIXY2_ENABLE_LINE)
+#define PIXY2_ENABLE_LINE YOTTA_CFG_PIXY2_ENABLE_LINE
+#endif
+#ifndef PIXY2_ENABLE_LINE
+#define PIXY2_ENABLE_LINE 1
+#endif
+
+#if !defined(PIXY2_ENABLE_VIDEO) && defined(YOTTA_CFG_PIXY2_ENABLE_VIDEO)
+#define PIXY2_ENABLE_VIDEO YOTTA_CFG_PIXY2_ENABLE_VIDEO
+#endif
+#ifndef PIXY2_ENABLE_VIDEO
+#define PIXY2_ENABLE_VIDEO 1
+#endif
+
+#if !defined(PIXY2_BUFFER_SIZE) && defined(YOTTA_CFG_PIXY2_BUFFER_SIZE)
+#define PIXY2_BUFFER_SIZE YOTTA_CFG_PIXY2_BUFFER_SIZE
+#endif
+#ifndef PIXY2_BUFFER_SIZE
+#define PIXY2_BUFFER_SIZE PIXY_BUFFERSIZE
+#endif
+
+#if !defined(PIXY2_I2C_FREQUENCY) && defined(YOTTA_CFG_PIXY2_I2C_FREQUENCY)
+#define PIXY2_I2C_FREQUENCY YOTTA_CFG_PIXY2_I2C_FREQUENCY
+#endif
+#ifndef PIXY2_I2C_FREQUENCY
+#define PIXY2_I2C_FREQUENCY 0
+#endif
+
+#if !defined(PIXY2_I2C_MAX_SEND) && defined(YOTTA_CFG_PIXY2_I2C_MAX_SEND)
+#define PIXY2_I2C_MAX_SEND YOTTA_CFG_PIXY2_I2C_MAX_SEND
+#endif
+#ifndef PIXY2_I2C_MAX_SEND
+#define PIXY2_I2C_MAX_SEND 16
+#endif
+
+#if !defined(PIXY2_I2C_REPEATED_START) && defined(YOTTA_CFG_PIXY2_I2C_REPEATED_START)
+#define PIXY2_I2C_REPEATED_START YOTTA_CFG_PIXY2_I2C_REPEATED_START
+#endif
+#ifndef PIXY2_I2C_REPEATED_START
+#define PIXY2_I2C_REPEATED_START 0
+#endif
+
+#if !defined(PIXY2_SPI_FREQUENCY) && defined(YOTTA_CFG_PIXY2_SPI_FREQUENCY)
+#define PIXY2_SPI_FREQUENCY YOTTA_CFG_PIXY2_SPI_FREQUENCY
+#endif
+#ifndef PIXY2_SPI_FREQUENCY
+#define PIXY2_SPI_FREQUENCY 2000000
+#endif
+
+#if !defined(PIXY2_ENABLE_RECORD) && defined(YOTTA_CFG_PIXY2_ENABLE_RECORD)
+#define PIXY2_ENABLE_RECORD YOTTA_CFG_PIXY2_ENABLE_RECORD
+#endif
+#ifndef PIXY2_ENABLE_RECORD
+#define PIXY2_ENABLE_RECORD 0
+#endif
+
+#if !defined(PIXY2_RECORD_SIZE) && defined(YOTTA_CFG_PIXY2_RECORD_SIZE)
+#define PIXY2_RECORD_SIZE YOTTA_CFG_PIXY2_RECORD_SIZE
+#endif
+#ifndef PIXY2_RECORD_SIZE
+#define PIXY2_RECORD_SIZE 2048
+#endif
+
+#if !defined(PIXY2_ENABLE_SPANS) && defined(YOTTA_CFG_PIXY2_ENABLE_SPANS)
+#define PIXY2_ENABLE_SPANS YOTTA_CFG_PIXY2_ENABLE_SPANS
+#endif
+#ifndef PIXY2_ENABLE_SPANS
+#define PIXY2_ENABLE_SPANS 0
+#endif
+
+#if !defined(PIXY2_SPAN_COUNT) && defined(YOTTA_CFG_PIXY2_SPAN_COUNT)
+#define PIXY2_SPAN_COUNT YOTTA_CFG_PIXY2_SPAN_COUNT
+#endif
+#ifndef PIXY2_SPAN_COUNT
+#define PIXY2_SPAN_COUNT 64
+#endif
+
+#if !defined(PIXY2_ENABLE_TELEMETRY) && defined(YOTTA_CFG_PIXY2_ENABLE_TELEMETRY)
+#define PIXY2_ENABLE_TELEMETRY YOTTA_CFG_PIXY2_ENABLE_TELEMETRY
+#endif
+#ifndef PIXY2_ENABLE_TELEMETRY
+#define PIXY2_ENABLE_TELEMETRY 0
+#endif
+
+#if !defined(PIXY2_TELEMETRY_SIZE) && defined(YOTTA_CFG_PIXY2_TELEMETRY_SIZE)
+#define PIXY2_TELEMETRY_SIZE YOTTA_CFG_PIXY2_TELEMETRY_SIZE
+#endif
+#ifndef PIXY2_TELEMETRY_SIZE
+#define PIXY2_TELEMETRY_SIZE 512
+#endif
+
+#if !defined(PIXY2_ENABLE_HEATMAP) && defined(YOTTA_CFG_PIXY2_ENABLE_HEATMAP)
+#define PIXY2_ENABLE_HEATMAP YOTTA_CFG_PIXY2_ENABLE_HEATMAP
+#endif
+#ifndef PIXY2_ENABLE_HEATMAP
+#define PIXY2_ENABLE_HEATMAP 0
+#endif
+
+#if !defined(PIXY2_HEATMAP_COLS) && defined(YOTTA_CFG_PIXY2_HEATMAP_COLS)
+#define PIXY2_HEATMAP_COLS YOTTA_CFG_PIXY2_HEATMAP_COLS
+#endif
+#ifndef PIXY2_HEATMAP_COLS
+#define PIXY2_HEATMAP_COLS 12
+#endif
+
+#if !defined(PIXY2_HEATMAP_ROWS) && defined(YOTTA_CFG_PIXY2_HEATMAP_ROWS)
+#define PIXY2_HEATMAP_ROWS YOTTA_CFG_PIXY2_HEATMAP_ROWS
+#endif
+#ifndef PIXY2_HEATMAP_ROWS
+#define PIXY2_HEATMAP_ROWS 8
+#endif
+
+#if !defined(PIXY2_ENABLE_LINE_MAP) && defined(YOTTA_CFG_PIXY2_ENABLE_LINE_MAP)
+#define PIXY2_ENABLE_LINE_MAP YOTTA_CFG_PIXY2_ENABLE_LINE_MAP
+#endif
+#ifndef PIXY2_ENABLE_LINE_MAP
+#define PIXY2_ENABLE_LINE_MAP 0
+#endif
+
+#if !defined(PIXY2_LINE_MAP_NODES) && defined(YOTTA_CFG_PIXY2_LINE_MAP_NODES)
+#define PIXY2_LINE_MAP_NODES YOTTA_CFG_PIXY2_LINE_MAP_NODES
+#endif
+#ifndef PIXY2_LINE_MAP_NODES
+#define PIXY2_LINE_MAP_NODES 16
+#endif
+
+#if !defined(PIXY2_GEOMETRY_DSP) && defined(YOTTA_CFG_PIXY2_GEOMETRY_DSP)
+#define PIXY2_GEOMETRY_DSP YOTTA_CFG_PIXY2_GEOMETRY_DSP
+#endif
+#ifndef PIXY2_GEOMETRY_DSP
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#define PIXY2_GEOMETRY_DSP 1
+#else
+#define PIXY2_GEOMETRY_DSP 0
+#endif
+#endif
+
+// Bits of the feature mask reported by getEnabledFeatures()
+#define PIXY2_FEATURE_CCC 0x01
+#define PIXY2_FEATURE_LINE 0x02
+#define PIXY2_FEATURE_VIDEO 0x04
+
+#define PIXY2_FEATURES ((PIXY2_ENABLE_CCC ? PIXY2_FEATURE_CCC : 0) | \
+                        (PIXY2_ENABLE_LINE ? PIXY2_FEATURE_LINE : 0) | \
+                        (PIXY2_ENABLE_VIDEO ? PIXY2_FEATURE_VIDEO : 0))
+
+#endif
@@ -0,0 +1,306 @@
+//
+// Batch geometry of a frame of blocks: area, squared distance of the center
+// to a point, intersection over union with a reference box and whether the
+// center is inside a region, for all blocks in one pass.
+//
+// Every kernel comes twice.  The packed version keeps x/y and width/height
+// of a block as pairs of 16-bit lanes in one word, loaded straight from the
+// Block, and works on both lanes at once with the DSP instructions of the
+// Cortex-M4 (micro:bit v2).  The scalar version is plain C.  With
+// PIXY2_GEOMETRY_DSP (on by default where the compiler has the DSP
+// extension) the pixyBlock*() functions use the packed kernels, otherwise
+// the scalar ones.  Elsewhere the packed instructions are emulated in C, so
+// tools/pixy2geometry.cpp can check both versions against each other on a
+// host.
+//
+// Coordinates of points and boxes must stay within -4096..4095 so that the
+// differences fit in a lane, see pixyClampCoord().
+//
+
+#include "pxt.h"
+#include "Pixy2Math.h"
+
+#ifndef _PIXY2GEOMETRY_H
+#define _PIXY2GEOMETRY_H
+
+#define PIXY_GEOMETRY_COORD_LIMIT 4095
+#define PIXY_GEOMETRY_LANES 0x80008000 // sign bits of both lanes
+#define PIXY_GEOMETRY_CHUNK 16          // blocks per kernel call in the shims, keeps the stack small
+#define PIXY_GEOMETRY_RECORD_SIZE 26     // of a block in cccGetBlockGeometryAsBuffer()
+#define PIXY_GEOMETRY_BENCH_ROUNDS 100
+#define PIXY_GEOMETRY_BENCH_MAX_BLOCKS 32
+
+// ------------------------ packed 16-bit lanes ------------------------
+// Lane 0 is the low half of the word, so the pair loaded from &m_x has x in
+// lane 0 and y in lane 1.
+
+// Two adjacent uint16_t, unaligned is fine on Cortex-M3/M4
+inline uint32_t pixyLoadPair(const uint16_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t pixyPackPair(int16_t lo, int16_t hi)
+{
+    return (uint16_t)lo | (uint32_t)(uint16_t)hi << 16;
+}
+
+// Halve both lanes of unsigned values
+inline uint32_t pixyHalvePair(uint32_t a)
+{
+    return (a >> 1) & 0x7fff7fff;
+}
+
+#if PIXY2_GEOMETRY_DSP
+
+inline uint32_t pixySadd16(uint32_t a, uint32_t b)
+{
+    uint32_t r;
+    __asm__("sadd16 %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+    return r;
+}
+
+inline uint32_t pixySsub16(uint32_t a, uint32_t b)
+{
+    uint32_t r;
+    __asm__("ssub16 %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+    return r;
+}
+
+// Lane-wise signed max and min, the subtraction sets the GE flags sel picks by
+inline uint32_t pixyMax16(uint32_t a, uint32_t b)
+{
+    uint32_t r;
+    __asm__("ssub16 %0, %1, %2\n\tsel %0, %1, %2" : "=&r"(r) : "r"(a), "r"(b) : "cc");
+    return r;
+}
+
+inline uint32_t pixyMin16(uint32_t a, uint32_t b)
+{
+    uint32_t r;
+    __asm__("ssub16 %0, %1, %2\n\tsel %0, %2, %1" : "=&r"(r) : "r"(a), "r"(b) : "cc");
+    return r;
+}
+
+// lane 0 * lane 0 + lane 1 * lane 1
+inline int32_t pixySmuad(uint32_t a, uint32_t b)
+{
+    int32_t r;
+    __asm__("smuad %0, %1, %2" : "=r"(r) : "r"(a), "r"(b) : "cc");
+    return r;
+}
+
+// lane 0 * lane 1
+inline int32_t pixySmulbt(uint32_t a)
+{
+    int32_t r;
+    __asm__("smulbt %0, %1, %1" : "=r"(r) : "r"(a));
+    return r;
+}
+
+#else
+
+inline int16_t pixyLane(uint32_t a, uint8_t lane)
+{
+    return (int16_t)(a >> (lane * 16));
+}
+
+inline uint32_t pixySadd16(uint32_t a, uint32_t b)
+{
+    return pixyPackPair(pixyLane(a, 0) + pixyLane(b, 0), pixyLane(a, 1) + pixyLane(b, 1));
+}
+
+inline uint32_t pixySsub16(uint32_t a, uint32_t b)
+{
+    return pixyPackPair(pixyLane(a, 0) - pixyLane(b, 0), pixyLane(a, 1) - pixyLane(b, 1));
+}
+
+inline uint32_t pixyMax16(uint32_t a, uint32_t b)
+{
+    return pixyPackPair(pixyLane(a, 0) > pixyLane(b, 0) ? pixyLane(a, 0) : pixyLane(b, 0),
+                        pixyLane(a, 1) > pixyLane(b, 1) ? pixyLane(a, 1) : pixyLane(b, 1));
+}
+
+inline uint32_t pixyMin16(uint32_t a, uint32_t b)
+{
+    return pixyPackPair(pixyLane(a, 0) < pixyLane(b, 0) ? pixyLane(a, 0) : pixyLane(b, 0),
+                        pixyLane(a, 1) < pixyLane(b, 1) ? pixyLane(a, 1) : pixyLane(b, 1));
+}
+
+inline int32_t pixySmuad(uint32_t a, uint32_t b)
+{
+    return (int32_t)pixyLane(a, 0) * pixyLane(b, 0) + (int32_t)pixyLane(a, 1) * pixyLane(b, 1);
+}
+
+inline int32_t pixySmulbt(uint32_t a)
+{
+    return (int32_t)pixyLane(a, 0) * pixyLane(a, 1);
+}
+
+#endif
+
+inline int16_t pixyClampCoord(int32_t v)
+{
+    return (int16_t)pixyClamp(v, PIXY_GEOMETRY_COORD_LIMIT);
+}
+
+// IoU of an intersection in Q14, 0 if both boxes are empty
+inline uint16_t pixyIoU(uint32_t inter, uint32_t area, uint32_t refArea)
+{
+    uint32_t uni = area + refArea - inter;
+    return uni ? (inter << PIXY_Q14_SHIFT) / uni : 0;
+}
+
+// ------------------------ packed kernels ------------------------
+
+inline void pixyBlockAreasPacked(const Block *blocks, uint8_t n, uint32_t *areas)
+{
+    uint8_t i;
+
+    for (i = 0; i < n; i++)
+        areas[i] = pixySmulbt(pixyLoadPair(&blocks[i].m_width));
+}
+
+inline void pixyBlockDistancesPacked(const Block *blocks, uint8_t n, int16_t x, int16_t y, uint32_t *dist2)
+{
+    uint32_t point, d;
+    uint8_t i;
+
+    point = pixyPackPair(x, y);
+    for (i = 0; i < n; i++)
+    {
+        d = pixySsub16(pixyLoadPair(&blocks[i].m_x), point);
+        dist2[i] = pixySmuad(d, d);
+    }
+}
+
+// The reference box is centered on x, y like a Block
+inline void pixyBlockIoUsPacked(const Block *blocks, uint8_t n, int16_t x, int16_t y, uint16_t width, uint16_t height,
+                                uint16_t *iou)
+{
+    uint32_t refSize, refLo, refHi, refArea, size, lo, hi, ext;
+    uint8_t i;
+
+    refSize = pixyPackPair(width, height);
+    refLo = pixySsub16(pixyPackPair(x, y), pixyHalvePair(refSize));
+    refHi = pixySadd16(refLo, refSize);
+    refArea = (uint32_t)width * height;
+    for (i = 0; i < n; i++)
+    {
+        size = pixyLoadPair(&blocks[i].m_width);
+        lo = pixySsub16(pixyLoadPair(&blocks[i].m_x), pixyHalvePair(size));
+        hi = pixySadd16(lo, size);
+        ext = pixyMax16(pixySsub16(pixyMin16(hi, refHi), pixyMax16(lo, refLo)), 0);
+        iou[i] = pixyIoU(pixySmulbt(ext), pixySmulbt(size), refArea);
+    }
+}
+
+// Bit i of mask is set if the center of block i is inside left..right, top..bottom (inclusive)
+inline void pixyBlockInRegionPacked(const Block *blocks, uint8_t n, int16_t left, int16_t top, int16_t right,
+                                    int16_t bottom, uint32_t *mask)
+{
+    uint32_t lo, hi, xy;
+    uint8_t i;
+
+    lo = pixyPackPair(left, top);
+    hi = pixyPackPair(right, bottom);
+    for (i = 0; i < n; i++)
+    {
+        if ((i & 31) == 0)
+            mask[i >> 5] = 0;
+        xy = pixyLoadPair(&blocks[i].m_x);
+        // outside if either difference is negative in either lane
+        if (!((pixySsub16(xy, lo) | pixySsub16(hi, xy)) & PIXY_GEOMETRY_LANES))
+            mask[i >> 5] |= 1UL << (i & 31);
+    }
+}
+
+// ------------------------ scalar kernels ------------------------
+
+inline void pixyBlockAreasScalar(const Block *blocks, uint8_t n, uint32_t *areas)
+{
+    uint8_t i;
+
+    for (i = 0; i < n; i++)
+        areas[i] = (uint32_t)blocks[i].m_width * blocks[i].m_height;
+}
+
+inline void pixyBlockDistancesScalar(const Block *blocks, uint8_t n, int16_t x, int16_t y, uint32_t *dist2)
+{
+    int32_t dx, dy;
+    uint8_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        dx = (int32_t)blocks[i].m_x - x;
+        dy = (int32_t)blocks[i].m_y - y;
+        dist2[i] = dx * dx + dy * dy;
+    }
+}
+
+inline void pixyBlockIoUsScalar(const Block *blocks, uint8_t n, int16_t x, int16_t y, uint16_t width, uint16_t height,
+                                uint16_t *iou)
+{
+    int32_t refLeft, refTop, left, top, w, h;
+    uint8_t i;
+
+    refLeft = x - (width >> 1);
+    refTop = y - (height >> 1);
+    for (i = 0; i < n; i++)
+    {
+        const Block &b = blocks[i];
+        left = b.m_x - (b.m_width >> 1);
+        top = b.m_y - (b.m_height >> 1);
+        w = pixyMin(left + b.m_width, refLeft + width) - pixyMax(left, refLeft);
+        h = pixyMin(top + b.m_height, refTop + height) - pixyMax(top, refTop);
+        iou[i] = pixyIoU(w > 0 && h > 0 ? w * h : 0, (uint32_t)b.m_width * b.m_height, (uint32_t)width * height);
+    }
+}
+
+inline void pixyBlockInRegionScalar(const Block *blocks, uint8_t n, int16_t left, int16_t top, int16_t right,
+                                    int16_t bottom, uint32_t *mask)
+{
+    uint8_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        if ((i & 31) == 0)
+            mask[i >> 5] = 0;
+        if (blocks[i].m_x >= left && blocks[i].m_x <= right && blocks[i].m_y >= top && blocks[i].m_y <= bottom)
+            mask[i >> 5] |= 1UL << (i & 31);
+    }
+}
+
+// ------------------------ selected kernels ------------------------
+
+#if PIXY2_GEOMETRY_DSP
+#define PIXY_GEOMETRY_KERNEL(name) name##Packed
+#else
+#define PIXY_GEOMETRY_KERNEL(name) name##Scalar
+#endif
+
+inline void pixyBlockAreas(const Block *blocks, uint8_t n, uint32_t *areas)
+{
+    PIXY_GEOMETRY_KERNEL(pixyBlockAreas)(blocks, n, areas);
+}
+
+inline void pixyBlockDistances(const Block *blocks, uint8_t n, int16_t x, int16_t y, uint32_t *dist2)
+{
+    PIXY_GEOMETRY_KERNEL(pixyBlockDistances)(blocks, n, x, y, dist2);
+}
+
+inline void pixyBlockIoUs(const Block *blocks, uint8_t n, int16_t x, int16_t y, uint16_t width, uint16_t height,
+                          uint16_t *iou)
+{
+    PIXY_GEOMETRY_KERNEL(pixyBlockIoUs)(blocks, n, x, y, width, height, iou);
+}
+
+inline void pixyBlockInRegion(const Block *blocks, uint8_t n, int16_t left, int16_t top, int16_t right,
+                              int16_t bottom, uint32_t *mask)
+{
+    PIXY_GEOMETRY_KERNEL(pixyBlockInRegion)(blocks, n, left, top, right, bottom, mask);
+}
+
+#endif
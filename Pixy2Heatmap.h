@@ -0,0 +1,118 @@
+//
+// Where in the frame each signature tends to show up over a run.  Every
+// frame of blocks adds the center of each block to a coarse grid per
+// signature (signatures 1..7, all color codes share an 8th grid), and older
+// frames fade out exponentially with a time constant of 2^shift frames.
+//
+// Decaying every cell on every frame would cost the whole grid per frame, so
+// instead the weight of a new block grows by 2^-shift per frame and the
+// cells are halved (with the weight) whenever it reaches 2.  That keeps
+// update() at O(blocks) plus an O(cells) rescale every ~0.7 time constants.
+// A cell divided by the weight is its occupancy: the decayed average number
+// of blocks per frame in it, 1.0 = CCC_HEATMAP_ONE.  Cells are 32 bits, as
+// 1.0 is up to 65536 in a cell and busier cells have to rank above it.
+//
+// The grid is PIXY2_HEATMAP_COLS x PIXY2_HEATMAP_ROWS, fixed, so memory
+// doesn't depend on how long it runs.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2HEATMAP_H
+#define _PIXY2HEATMAP_H
+
+#define CCC_HEATMAP_LAYERS 8      // signatures 1..7, then color codes
+#define CCC_HEATMAP_CELLS (PIXY2_HEATMAP_COLS * PIXY2_HEATMAP_ROWS)
+#define CCC_HEATMAP_ONE 32768     // occupancy of 1.0, Q15
+#define CCC_HEATMAP_WEIGHT_ONE 65536
+#define CCC_HEATMAP_MIN_SHIFT 1
+#define CCC_HEATMAP_MAX_SHIFT 12
+#define CCC_HEATMAP_DEFAULT_SHIFT 8 // 256 frames, about 4 s at 60 fps
+
+class Pixy2Heatmap
+{
+public:
+    Pixy2Heatmap()
+    {
+        running = false;
+        m_shift = CCC_HEATMAP_DEFAULT_SHIFT;
+        reset();
+    }
+
+    void reset()
+    {
+        memset(m_cells, 0, sizeof(m_cells));
+        m_weight = CCC_HEATMAP_WEIGHT_ONE;
+        frames = 0;
+    }
+
+    // Time constant of 2^shift frames, resets the heatmap
+    void setShift(uint8_t shift)
+    {
+        m_shift = shift < CCC_HEATMAP_MIN_SHIFT ? CCC_HEATMAP_MIN_SHIFT : (shift > CCC_HEATMAP_MAX_SHIFT ? CCC_HEATMAP_MAX_SHIFT : shift);
+        reset();
+    }
+
+    uint8_t shift()
+    {
+        return m_shift;
+    }
+
+    static uint8_t layer(uint16_t signature)
+    {
+        return signature > CCC_MAX_SIGNATURE ? CCC_HEATMAP_LAYERS - 1 : signature - 1;
+    }
+
+    // Add a frame of blocks in a frame of width x height pixels
+    void update(const Block *blocks, uint8_t numBlocks, uint16_t width, uint16_t height);
+
+    // Occupancy of a cell of a layer, CCC_HEATMAP_ONE = a block there in every frame
+    uint32_t occupancy(uint8_t layer, uint16_t cell)
+    {
+        return ((uint64_t)m_cells[layer][cell] << 15) / (m_weight >> 1);
+    }
+
+    bool running;
+    uint32_t frames; // since reset()
+
+private:
+    uint32_t m_cells[CCC_HEATMAP_LAYERS][CCC_HEATMAP_CELLS];
+    uint32_t m_weight; // of a block this frame, CCC_HEATMAP_WEIGHT_ONE..2 * CCC_HEATMAP_WEIGHT_ONE
+    uint8_t m_shift;
+};
+
+inline void Pixy2Heatmap::update(const Block *blocks, uint8_t numBlocks, uint16_t width, uint16_t height)
+{
+    uint32_t add, *cells;
+    uint16_t col, row;
+    uint8_t i;
+
+    if (width == 0 || height == 0)
+        return;
+
+    // fade the older frames by growing the weight of this one
+    m_weight += m_weight >> m_shift;
+    if (m_weight >= 2 * CCC_HEATMAP_WEIGHT_ONE)
+    {
+        for (cells = &m_cells[0][0]; cells < &m_cells[0][0] + CCC_HEATMAP_LAYERS * CCC_HEATMAP_CELLS; cells++)
+            *cells = (*cells + 1) >> 1;
+        m_weight >>= 1;
+    }
+    frames++;
+
+    // a block adds 1 / 2^shift of the weight (in CCC_HEATMAP_ONE, half of
+    // CCC_HEATMAP_WEIGHT_ONE), so a block in every frame settles at 1.0
+    add = (m_weight >> 1) >> m_shift;
+    if (add == 0)
+        add = 1;
+    for (i = 0; i < numBlocks; i++)
+    {
+        if (blocks[i].m_signature == 0)
+            continue;
+        col = blocks[i].m_x >= width ? PIXY2_HEATMAP_COLS - 1 : (uint32_t)blocks[i].m_x * PIXY2_HEATMAP_COLS / width;
+        row = blocks[i].m_y >= height ? PIXY2_HEATMAP_ROWS - 1 : (uint32_t)blocks[i].m_y * PIXY2_HEATMAP_ROWS / height;
+        m_cells[layer(blocks[i].m_signature)][row * PIXY2_HEATMAP_COLS + col] += add;
+    }
+}
+
+#endif
@@ -2,10 +2,13 @@
 #define _PIXY2I2C_H
 
 #include "TPixy2.h"
+#include "Pixy2LinkTrace.h"
 #include "pxt.h"
 
 #define PIXY_I2C_DEFAULT_ADDR 0x54
-#define PIXY_I2C_MAX_SEND 16 // don't send any more than 16 bytes at a time
+#define PIXY_I2C_MAX_SEND 16 // default write chunk, see PIXY2_I2C_MAX_SEND
+#define PIXY_I2C_PROBE_ROUNDS 10 // request pairs timed per setting by probeLink()
+#define PIXY_I2C_RUNTIME_FREQUENCY 100000 // the bus frequency the runtime sets up
 
 namespace String_
 {
@@ -18,15 +21,25 @@ namespace pins
     int i2cWriteBuffer(int address, Buffer buf, bool repeat);
 }
 
+// The bus settings start out from Pixy2Config.h and can be changed at any
+// time, call configure() after changing frequency.
 class Link2I2C
 {
 public:
+    Link2I2C()
+    {
+        frequency = PIXY2_I2C_FREQUENCY;
+        maxSend = PIXY2_I2C_MAX_SEND;
+        repeatedStart = PIXY2_I2C_REPEATED_START;
+    }
+
     int8_t open(uint32_t arg) // take I2C address as argument to open
     {
         if (arg == PIXY_DEFAULT_ARGVAL)
             m_addr = PIXY_I2C_DEFAULT_ADDR;
         else
             m_addr = arg;
+        configure();
         return 0;
     }
 
@@ -34,6 +47,18 @@ public:
     {
     }
 
+    // Apply the bus frequency
+    void configure()
+    {
+        if (frequency == 0)
+            return;
+#if MICROBIT_CODAL
+        uBit.i2c.setFrequency(frequency);
+#else
+        uBit.i2c.frequency(frequency);
+#endif
+    }
+
     int16_t recv(uint8_t *buf, uint8_t len, uint16_t *cs = NULL)
     {
         uint8_t i;
@@ -51,15 +76,20 @@ public:
 
     int16_t send(uint8_t *buf, uint8_t len)
     {
-        int8_t i, packet;
-        for (i = 0; i < len; i += PIXY_I2C_MAX_SEND)
+        uint16_t i;
+        uint8_t packet, chunk;
+
+        chunk = maxSend ? maxSend : PIXY_I2C_MAX_SEND;
+        for (i = 0; i < len; i += chunk)
         {
-            if (len - i < PIXY_I2C_MAX_SEND)
+            if (len - i < chunk)
                 packet = len - i;
             else
-                packet = PIXY_I2C_MAX_SEND;
+                packet = chunk;
             Buffer req = pxt::mkBuffer(buf + i, packet);
-            int resp = pins::i2cWriteBuffer(m_addr, req, false);
+            // a request is always followed by reading the response, with a repeated
+            // start that can follow straight away without releasing the bus
+            int resp = pins::i2cWriteBuffer(m_addr, req, repeatedStart && i + packet >= len);
             if (resp == MICROBIT_I2C_ERROR) {
                 return 0;
             }
@@ -67,10 +97,18 @@ public:
         return len;
     }
 
+    uint32_t frequency; // Hz, 0 = leave the bus as it is
+    uint8_t maxSend;    // bytes per write
+    bool repeatedStart; // end requests without a stop, so the response is read with a repeated start
+
 private:
     uint8_t m_addr;
 };
 
-typedef TPixy2<Link2I2C> Pixy2I2C;
+#if PIXY2_ENABLE_RECORD
+typedef TPixy2Sized<Link2Record<Link2I2C>, PIXY2_BUFFER_SIZE> Pixy2I2C;
+#else
+typedef TPixy2Sized<Link2I2C, PIXY2_BUFFER_SIZE> Pixy2I2C;
+#endif
 
 #endif
\ No newline at end of file
@@ -110,6 +110,13 @@ struct Barcode
     uint8_t m_code;
 };
 
+#include "Pixy2LineDelta.h"
+#include "Pixy2LineSteering.h"
+#include "Pixy2LineLookahead.h"
+#include "Pixy2LineRoute.h"
+#include "Pixy2LineMap.h"
+#include "Pixy2BarcodeHistory.h"
+
 template <class LinkType>
 class TPixy2;
 
@@ -120,6 +127,8 @@ public:
     Pixy2Line(TPixy2<LinkType> *pixy)
     {
         m_pixy = pixy;
+        m_defaultTurn = 0;
+        m_nextTurnSet = false;
     }
 
     int8_t getMainFeatures(uint8_t features = LINE_ALL_FEATURES, bool wait = true)
@@ -132,6 +141,13 @@ public:
         return getFeatures(LINE_GET_ALL_FEATURES, features, wait);
     }
 
+    // Get features and compare them against the previous call, the changes are left in delta
+    int8_t getFeatureChanges(uint8_t type, uint8_t features = LINE_ALL_FEATURES, bool wait = true);
+    // Get the main vector and update steering from it, returns the number of vectors used (0 or 1)
+    int8_t getSteering(bool wait = true);
+    // Get the main vector and estimate the line ahead from it and the ones before, see Pixy2LineLookahead
+    int8_t getLookahead(LineLookahead *est, bool wait = true);
+
     int8_t setMode(uint8_t mode);
     int8_t setNextTurn(int16_t angle);
     int8_t setDefaultTurn(int16_t angle);
@@ -147,9 +163,28 @@ public:
     uint8_t numBarcodes;
     Barcode *barcodes;
 
+    Pixy2LineDelta delta;
+    Pixy2LineSteering steering;
+    Pixy2LineLookahead lookahead;
+    Pixy2LineRoute route;
+#if PIXY2_ENABLE_LINE_MAP
+    Pixy2LineMap map;
+#endif
+    Pixy2BarcodeHistory barcodeHistory;
+
+    // Raise the events queued by the last requests, call once done with the feature data
+    void flushEvents()
+    {
+        barcodeHistory.flushEvents();
+    }
+
 private:
     int8_t getFeatures(uint8_t type, uint8_t features, bool wait);
     TPixy2<LinkType> *m_pixy;
+    // what Pixy will turn at the next intersection
+    int16_t m_nextTurn;
+    int16_t m_defaultTurn;
+    bool m_nextTurnSet;
 };
 
 template <class LinkType>
@@ -158,6 +193,9 @@ int8_t Pixy2Line<LinkType>::getFeatures(uint8_t type, uint8_t features, bool wai
     int8_t res;
     uint8_t offset, fsize, ftype, *fdata;
 
+    // nothing points into the buffer at this point, so it's safe to run event handlers
+    flushEvents();
+
     vectors = NULL;
     numVectors = 0;
     intersections = NULL;
@@ -165,6 +203,15 @@ int8_t Pixy2Line<LinkType>::getFeatures(uint8_t type, uint8_t features, bool wai
     barcodes = NULL;
     numBarcodes = 0;
 
+    // arm the next planned turn before the feature request overwrites the buffer
+    if (route.needsArm() && setNextTurn(route.next()) == PIXY_RESULT_OK)
+        route.setArmed();
+#if PIXY2_ENABLE_LINE_MAP
+    // the planned route comes first, the map only fills in when there's none
+    else if (!route.remaining() && map.needsArm() && setNextTurn(map.next()) == PIXY_RESULT_OK)
+        map.setArmed();
+#endif
+
     while (1)
     {
         // fill in request data
@@ -174,11 +221,11 @@ int8_t Pixy2Line<LinkType>::getFeatures(uint8_t type, uint8_t features, bool wai
         m_pixy->m_bufPayload[1] = features;
 
         // send request
-        m_pixy->sendPacket();
-        if (m_pixy->recvPacket() == 0)
+        if (m_pixy->exchange() == 0)
         {
             if (m_pixy->m_type == LINE_RESPONSE_GET_FEATURES)
             {
+                PIXY_SPAN_SCOPE(m_pixy->spans, PIXY_SPAN_PARSE, LINE_REQUEST_GET_FEATURES);
                 // parse line response
                 for (offset = 0, res = 0; m_pixy->m_length > offset; offset += fsize + 2)
                 {
@@ -207,6 +254,32 @@ int8_t Pixy2Line<LinkType>::getFeatures(uint8_t type, uint8_t features, bool wai
                     else
                         break; // parse error
                 }
+#if PIXY2_ENABLE_LINE_MAP
+                if (type == LINE_GET_MAIN_FEATURES)
+                    map.addBarcodes(barcodes, numBarcodes, numVectors ? vectors : NULL);
+#endif
+                if (route.update(type, features, vectors, numVectors, numIntersections))
+                {
+#if PIXY2_ENABLE_LINE_MAP
+                    map.pass(numIntersections ? intersections : NULL, m_nextTurnSet ? m_nextTurn : m_defaultTurn,
+                             current_time_ms());
+#endif
+                    // Pixy goes back to the default turn after the intersection
+                    m_nextTurnSet = false;
+                }
+                if (type == LINE_GET_MAIN_FEATURES && (features & LINE_VECTOR))
+                    lookahead.add(numVectors ? vectors : NULL, m_pixy->frameWidth, current_time_ms());
+                if (numBarcodes)
+                    barcodeHistory.add(barcodes, numBarcodes, current_time_ms());
+#if PIXY2_ENABLE_TELEMETRY
+                if (m_pixy->telemetry.running)
+                {
+                    if (features & LINE_VECTOR)
+                        m_pixy->telemetry.addVectors(vectors, numVectors);
+                    if (features & LINE_BARCODE)
+                        m_pixy->telemetry.addBarcodes(barcodes, numBarcodes);
+                }
+#endif
                 return res;
             }
             else if (m_pixy->m_type == PIXY_TYPE_RESPONSE_ERROR)
@@ -227,6 +300,43 @@ int8_t Pixy2Line<LinkType>::getFeatures(uint8_t type, uint8_t features, bool wai
     }
 }
 
+template <class LinkType>
+int8_t Pixy2Line<LinkType>::getFeatureChanges(uint8_t type, uint8_t features, bool wait)
+{
+    int8_t res;
+
+    delta.numChanges = 0;
+    res = getFeatures(type, features, wait);
+    if (res < 0)
+        return res;
+    return delta.compare(features, vectors, numVectors, intersections, numIntersections, barcodes, numBarcodes);
+}
+
+template <class LinkType>
+int8_t Pixy2Line<LinkType>::getSteering(bool wait)
+{
+    int8_t res;
+
+    res = getMainFeatures(LINE_VECTOR, wait);
+    if (res < 0)
+        return res;
+    if (steering.update(numVectors ? vectors : NULL, m_pixy->frameWidth, current_time_ms()) < 0)
+        return 0;
+    return 1;
+}
+
+template <class LinkType>
+int8_t Pixy2Line<LinkType>::getLookahead(LineLookahead *est, bool wait)
+{
+    int8_t res;
+
+    res = getMainFeatures(LINE_VECTOR, wait);
+    if (res < 0)
+        return res;
+    lookahead.estimate(est);
+    return est->m_valid;
+}
+
 template <class LinkType>
 int8_t Pixy2Line<LinkType>::setMode(uint8_t mode)
 {
@@ -235,8 +345,7 @@ int8_t Pixy2Line<LinkType>::setMode(uint8_t mode)
     *(int8_t *)m_pixy->m_bufPayload = mode;
     m_pixy->m_length = 1;
     m_pixy->m_type = LINE_REQUEST_SET_MODE;
-    m_pixy->sendPacket();
-    if (m_pixy->recvPacket() == 0 && m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
+    if (m_pixy->exchange() == 0 && m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
     {
         res = *(uint32_t *)m_pixy->m_buf;
         return (int8_t)res;
@@ -253,10 +362,14 @@ int8_t Pixy2Line<LinkType>::setNextTurn(int16_t angle)
     *(int16_t *)m_pixy->m_bufPayload = angle;
     m_pixy->m_length = 2;
     m_pixy->m_type = LINE_REQUEST_SET_NEXT_TURN_ANGLE;
-    m_pixy->sendPacket();
-    if (m_pixy->recvPacket() == 0 && m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
+    if (m_pixy->exchange() == 0 && m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
     {
         res = *(uint32_t *)m_pixy->m_buf;
+        if ((int8_t)res == PIXY_RESULT_OK)
+        {
+            m_nextTurn = angle;
+            m_nextTurnSet = true;
+        }
         return (int8_t)res;
     }
     else
@@ -271,10 +384,11 @@ int8_t Pixy2Line<LinkType>::setDefaultTurn(int16_t angle)
     *(int16_t *)m_pixy->m_bufPayload = angle;
     m_pixy->m_length = 2;
     m_pixy->m_type = LINE_REQUEST_SET_DEFAULT_TURN_ANGLE;
-    m_pixy->sendPacket();
-    if (m_pixy->recvPacket() == 0 && m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
+    if (m_pixy->exchange() == 0 && m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
     {
         res = *(uint32_t *)m_pixy->m_buf;
+        if ((int8_t)res == PIXY_RESULT_OK)
+            m_defaultTurn = angle;
         return (int8_t)res;
     }
     else
@@ -289,8 +403,7 @@ int8_t Pixy2Line<LinkType>::setVector(uint8_t index)
     *(int8_t *)m_pixy->m_bufPayload = index;
     m_pixy->m_length = 1;
     m_pixy->m_type = LINE_REQUEST_SET_VECTOR;
-    m_pixy->sendPacket();
-    if (m_pixy->recvPacket() == 0 && m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
+    if (m_pixy->exchange() == 0 && m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
     {
         res = *(uint32_t *)m_pixy->m_buf;
         return (int8_t)res;
@@ -306,8 +419,8 @@ int8_t Pixy2Line<LinkType>::reverseVector()
 
     m_pixy->m_length = 0;
     m_pixy->m_type = LINE_REQUEST_REVERSE_VECTOR;
-    m_pixy->sendPacket();
-    if (m_pixy->recvPacket() == 0 && m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
+    // flips the vector, so a lost response can't be retried
+    if (m_pixy->exchange(false) == 0 && m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
     {
         res = *(uint32_t *)m_pixy->m_buf;
         return (int8_t)res;
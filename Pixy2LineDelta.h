@@ -0,0 +1,306 @@
+//
+// Frame-to-frame change detection for line features.  Pixy2LineDelta keeps
+// a copy of the previous frame's vectors, intersections and barcodes and
+// reports only what was added, removed or moved since then:
+//   - vectors are keyed by m_index, they've moved if an endpoint shifted
+//     by more than threshold or their flags changed
+//   - barcodes are paired by m_code, intersections by branch count m_n,
+//     each with the nearest unpaired feature of the previous frame
+//
+// Only the first LINE_DELTA_MAX_* features of each type are compared.  When
+// a frame has more, a LINE_DELTA_TRUNCATED change for that type comes first
+// (its index is the number Pixy sent) so the caller knows some are missing.
+//
+// Usage: compare() a freshly parsed frame, serialize() the changes while
+// the frame data is still in the Pixy buffer, then commit() it.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2LINEDELTA_H
+#define _PIXY2LINEDELTA_H
+
+#define LINE_DELTA_ADDED 0x01
+#define LINE_DELTA_REMOVED 0x02
+#define LINE_DELTA_MOVED 0x03
+#define LINE_DELTA_TRUNCATED 0x04 // no feature data, the frame had more of the type than are compared
+
+#define LINE_DELTA_MAX_VECTORS 16
+#define LINE_DELTA_MAX_INTERSECTIONS 4
+#define LINE_DELTA_MAX_BARCODES 8
+#define LINE_DELTA_MAX_CHANGES (2 * (LINE_DELTA_MAX_VECTORS + LINE_DELTA_MAX_INTERSECTIONS + LINE_DELTA_MAX_BARCODES) + 3)
+#define LINE_DELTA_RECORD_HEADER_SIZE 3
+#define LINE_DELTA_DEFAULT_THRESHOLD 2
+
+struct LineChange
+{
+    uint8_t m_op;    // LINE_DELTA_ADDED, LINE_DELTA_REMOVED, LINE_DELTA_MOVED or LINE_DELTA_TRUNCATED
+    uint8_t m_type;  // LINE_VECTOR, LINE_INTERSECTION or LINE_BARCODE
+    uint8_t m_index; // into the current frame, or the previous one for removals, number of features for truncations
+};
+
+class Pixy2LineDelta
+{
+public:
+    Pixy2LineDelta()
+    {
+        threshold = LINE_DELTA_DEFAULT_THRESHOLD;
+        numChanges = 0;
+        m_features = 0;
+        reset();
+    }
+
+    // Forget the previous frame so that the next compare() reports everything as added
+    void reset()
+    {
+        m_numVectors = m_numIntersections = m_numBarcodes = 0;
+    }
+
+    uint8_t compare(uint8_t features, Vector *vectors, uint8_t numVectors,
+                    Intersection *intersections, uint8_t numIntersections,
+                    Barcode *barcodes, uint8_t numBarcodes);
+    uint16_t serializedSize();
+    void serialize(uint8_t *buf);
+    void commit();
+
+    uint8_t threshold;
+    uint8_t numChanges;
+    LineChange changes[LINE_DELTA_MAX_CHANGES];
+
+private:
+    static uint8_t distance(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+    void addChange(uint8_t op, uint8_t type, uint8_t index);
+    uint8_t featureSize(const LineChange &change);
+    uint8_t intersectionLines(const LineChange &change);
+    const uint8_t *featureData(const LineChange &change);
+
+    uint8_t m_features;
+
+    // current frame, points into the Pixy buffer until commit()
+    Vector *m_curVectors;
+    Intersection *m_curIntersections;
+    Barcode *m_curBarcodes;
+    uint8_t m_numCurVectors;
+    uint8_t m_numCurIntersections;
+    uint8_t m_numCurBarcodes;
+
+    // previous frame
+    Vector m_vectors[LINE_DELTA_MAX_VECTORS];
+    Intersection m_intersections[LINE_DELTA_MAX_INTERSECTIONS];
+    Barcode m_barcodes[LINE_DELTA_MAX_BARCODES];
+    uint8_t m_numVectors;
+    uint8_t m_numIntersections;
+    uint8_t m_numBarcodes;
+};
+
+inline uint8_t Pixy2LineDelta::distance(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+    uint8_t dx = x0 > x1 ? x0 - x1 : x1 - x0;
+    uint8_t dy = y0 > y1 ? y0 - y1 : y1 - y0;
+    return dx > dy ? dx : dy;
+}
+
+inline void Pixy2LineDelta::addChange(uint8_t op, uint8_t type, uint8_t index)
+{
+    if (numChanges >= LINE_DELTA_MAX_CHANGES)
+        return;
+    changes[numChanges].m_op = op;
+    changes[numChanges].m_type = type;
+    changes[numChanges].m_index = index;
+    numChanges++;
+}
+
+inline uint8_t Pixy2LineDelta::compare(uint8_t features, Vector *vectors, uint8_t numVectors,
+                                       Intersection *intersections, uint8_t numIntersections,
+                                       Barcode *barcodes, uint8_t numBarcodes)
+{
+    uint8_t i, j, best, d, bestDist;
+    uint32_t paired;
+
+    m_features = features;
+    m_curVectors = vectors;
+    m_curIntersections = intersections;
+    m_curBarcodes = barcodes;
+    m_numCurVectors = numVectors < LINE_DELTA_MAX_VECTORS ? numVectors : LINE_DELTA_MAX_VECTORS;
+    m_numCurIntersections = numIntersections < LINE_DELTA_MAX_INTERSECTIONS ? numIntersections : LINE_DELTA_MAX_INTERSECTIONS;
+    m_numCurBarcodes = numBarcodes < LINE_DELTA_MAX_BARCODES ? numBarcodes : LINE_DELTA_MAX_BARCODES;
+    numChanges = 0;
+
+    if (features & LINE_VECTOR)
+    {
+        if (numVectors > m_numCurVectors)
+            addChange(LINE_DELTA_TRUNCATED, LINE_VECTOR, numVectors);
+        for (i = 0, paired = 0; i < m_numCurVectors; i++)
+        {
+            for (j = 0; j < m_numVectors && m_vectors[j].m_index != vectors[i].m_index; j++)
+                ;
+            if (j == m_numVectors)
+            {
+                addChange(LINE_DELTA_ADDED, LINE_VECTOR, i);
+                continue;
+            }
+            paired |= 1UL << j;
+            d = distance(vectors[i].m_x0, vectors[i].m_y0, m_vectors[j].m_x0, m_vectors[j].m_y0);
+            if (d <= threshold)
+                d = distance(vectors[i].m_x1, vectors[i].m_y1, m_vectors[j].m_x1, m_vectors[j].m_y1);
+            if (d > threshold || vectors[i].m_flags != m_vectors[j].m_flags)
+                addChange(LINE_DELTA_MOVED, LINE_VECTOR, i);
+        }
+        for (j = 0; j < m_numVectors; j++)
+        {
+            if (!(paired & (1UL << j)))
+                addChange(LINE_DELTA_REMOVED, LINE_VECTOR, j);
+        }
+    }
+
+    if (features & LINE_INTERSECTION)
+    {
+        if (numIntersections > m_numCurIntersections)
+            addChange(LINE_DELTA_TRUNCATED, LINE_INTERSECTION, numIntersections);
+        for (i = 0, paired = 0; i < m_numCurIntersections; i++)
+        {
+            for (j = 0, best = 0xff, bestDist = 0xff; j < m_numIntersections; j++)
+            {
+                if ((paired & (1UL << j)) || m_intersections[j].m_n != intersections[i].m_n)
+                    continue;
+                d = distance(intersections[i].m_x, intersections[i].m_y, m_intersections[j].m_x, m_intersections[j].m_y);
+                if (d < bestDist || best == 0xff)
+                {
+                    best = j;
+                    bestDist = d;
+                }
+            }
+            if (best == 0xff)
+                addChange(LINE_DELTA_ADDED, LINE_INTERSECTION, i);
+            else
+            {
+                paired |= 1UL << best;
+                if (bestDist > threshold)
+                    addChange(LINE_DELTA_MOVED, LINE_INTERSECTION, i);
+            }
+        }
+        for (j = 0; j < m_numIntersections; j++)
+        {
+            if (!(paired & (1UL << j)))
+                addChange(LINE_DELTA_REMOVED, LINE_INTERSECTION, j);
+        }
+    }
+
+    if (features & LINE_BARCODE)
+    {
+        if (numBarcodes > m_numCurBarcodes)
+            addChange(LINE_DELTA_TRUNCATED, LINE_BARCODE, numBarcodes);
+        for (i = 0, paired = 0; i < m_numCurBarcodes; i++)
+        {
+            for (j = 0, best = 0xff, bestDist = 0xff; j < m_numBarcodes; j++)
+            {
+                if ((paired & (1UL << j)) || m_barcodes[j].m_code != barcodes[i].m_code)
+                    continue;
+                d = distance(barcodes[i].m_x, barcodes[i].m_y, m_barcodes[j].m_x, m_barcodes[j].m_y);
+                if (d < bestDist || best == 0xff)
+                {
+                    best = j;
+                    bestDist = d;
+                }
+            }
+            if (best == 0xff)
+                addChange(LINE_DELTA_ADDED, LINE_BARCODE, i);
+            else
+            {
+                paired |= 1UL << best;
+                if (bestDist > threshold)
+                    addChange(LINE_DELTA_MOVED, LINE_BARCODE, i);
+            }
+        }
+        for (j = 0; j < m_numBarcodes; j++)
+        {
+            if (!(paired & (1UL << j)))
+                addChange(LINE_DELTA_REMOVED, LINE_BARCODE, j);
+        }
+    }
+
+    return numChanges;
+}
+
+inline uint8_t Pixy2LineDelta::featureSize(const LineChange &change)
+{
+    if (change.m_op == LINE_DELTA_TRUNCATED)
+        return 0;
+    if (change.m_type == LINE_VECTOR)
+        return sizeof(Vector);
+    if (change.m_type == LINE_BARCODE)
+        return sizeof(Barcode);
+    // only send the intersection lines that are in use
+    return sizeof(Intersection) - sizeof(IntersectionLine) * (LINE_MAX_INTERSECTION_LINES - intersectionLines(change));
+}
+
+inline uint8_t Pixy2LineDelta::intersectionLines(const LineChange &change)
+{
+    const Intersection *intersection = (const Intersection *)featureData(change);
+
+    // a damaged frame could claim more than the struct holds
+    return intersection->m_n > LINE_MAX_INTERSECTION_LINES ? LINE_MAX_INTERSECTION_LINES : intersection->m_n;
+}
+
+inline const uint8_t *Pixy2LineDelta::featureData(const LineChange &change)
+{
+    bool removed = change.m_op == LINE_DELTA_REMOVED;
+
+    if (change.m_type == LINE_VECTOR)
+        return (const uint8_t *)(removed ? &m_vectors[change.m_index] : &m_curVectors[change.m_index]);
+    if (change.m_type == LINE_INTERSECTION)
+        return (const uint8_t *)(removed ? &m_intersections[change.m_index] : &m_curIntersections[change.m_index]);
+    return (const uint8_t *)(removed ? &m_barcodes[change.m_index] : &m_curBarcodes[change.m_index]);
+}
+
+// Each record is: op, feature type, data size, then the feature struct as Pixy sent it
+inline uint16_t Pixy2LineDelta::serializedSize()
+{
+    uint16_t size;
+    uint8_t i;
+
+    for (i = 0, size = 0; i < numChanges; i++)
+        size += LINE_DELTA_RECORD_HEADER_SIZE + featureSize(changes[i]);
+    return size;
+}
+
+inline void Pixy2LineDelta::serialize(uint8_t *buf)
+{
+    uint8_t i, size;
+
+    for (i = 0; i < numChanges; i++)
+    {
+        size = featureSize(changes[i]);
+        buf[0] = changes[i].m_op;
+        buf[1] = changes[i].m_type;
+        buf[2] = size;
+        if (size)
+            memcpy(buf + LINE_DELTA_RECORD_HEADER_SIZE, featureData(changes[i]), size);
+        // m_n, so that the reader only looks at the lines that were sent
+        if (size && changes[i].m_type == LINE_INTERSECTION)
+            buf[LINE_DELTA_RECORD_HEADER_SIZE + 2] = intersectionLines(changes[i]);
+        buf += LINE_DELTA_RECORD_HEADER_SIZE + size;
+    }
+}
+
+inline void Pixy2LineDelta::commit()
+{
+    if (m_features & LINE_VECTOR)
+    {
+        memcpy(m_vectors, m_curVectors, m_numCurVectors * sizeof(Vector));
+        m_numVectors = m_numCurVectors;
+    }
+    if (m_features & LINE_INTERSECTION)
+    {
+        memcpy(m_intersections, m_curIntersections, m_numCurIntersections * sizeof(Intersection));
+        m_numIntersections = m_numCurIntersections;
+    }
+    if (m_features & LINE_BARCODE)
+    {
+        memcpy(m_barcodes, m_curBarcodes, m_numCurBarcodes * sizeof(Barcode));
+        m_numBarcodes = m_numCurBarcodes;
+    }
+    m_features = 0;
+}
+
+#endif
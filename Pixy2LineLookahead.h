@@ -0,0 +1,174 @@
+//
+// Lookahead along the line from the recent main vectors.  Pixy2Line adds
+// the main vector of every getMainFeatures() frame with its time, and
+// estimate() fits straight lines through the last LINE_LOOKAHEAD_HISTORY
+// headings and offsets over time (least squares, integer math): their
+// slopes are how fast the line turns and drifts sideways in the image, and
+// the fits extrapolated lookahead ms into the future predict where the line
+// will be.  Dividing the heading rate by the robot's speed gives the
+// curvature of the path.
+//
+// Heading and offset are measured like in Pixy2LineSteering.  The history
+// starts over when the vector is lost, Pixy starts tracking another line
+// (the vector index changes) or frames are more than LINE_LOOKAHEAD_MAX_GAP
+// ms apart.
+//
+
+#include "pxt.h"
+#include "Pixy2Math.h"
+
+#ifndef _PIXY2LINELOOKAHEAD_H
+#define _PIXY2LINELOOKAHEAD_H
+
+#define LINE_LOOKAHEAD_HISTORY 8
+#define LINE_LOOKAHEAD_MAX_GAP 500 // ms
+#define LINE_LOOKAHEAD_DEFAULT_MS 200
+#define LINE_LOOKAHEAD_MAX_MS 2000
+
+struct LineLookahead
+{
+    int16_t m_heading;          // Q6 degrees, of the last vector
+    int16_t m_offset;           // Q14 fraction of the half frame width, of the last vector head
+    int32_t m_headingRate;      // Q6 degrees per second
+    int32_t m_offsetRate;       // Q14 per second
+    int32_t m_curvature;        // Q6 degrees per meter, 0 without a speed
+    int16_t m_predictedHeading; // Q6 degrees, lookahead ms from the last vector
+    int16_t m_predictedOffset;  // Q14
+    int16_t m_predictedX;       // pixels
+    uint8_t m_samples;          // vectors the estimate is made from
+    uint8_t m_valid;            // 0 if there is no vector
+};
+
+class Pixy2LineLookahead
+{
+public:
+    Pixy2LineLookahead()
+    {
+        lookahead = LINE_LOOKAHEAD_DEFAULT_MS;
+        speed = 0;
+        reset();
+    }
+
+    void reset()
+    {
+        m_count = 0;
+    }
+
+    // Add the main vector of a frame, NULL if there was none
+    void add(const Vector *vector, uint16_t frameWidth, uint32_t now);
+
+    void estimate(LineLookahead *est);
+
+    uint16_t lookahead; // ms
+    uint16_t speed;     // of the robot in mm/s, 0 = unknown
+
+private:
+    // Least squares slope through the samples in units per second, and the fit at time t (ms from the last sample)
+    int32_t fit(const int32_t *values, int32_t t, int32_t *at);
+
+    // Q6 degrees into -180..180 degrees
+    static int32_t wrap(int32_t heading)
+    {
+        while (heading > 180 * PIXY_DEG_ONE)
+            heading -= 360 * PIXY_DEG_ONE;
+        while (heading < -180 * PIXY_DEG_ONE)
+            heading += 360 * PIXY_DEG_ONE;
+        return heading;
+    }
+
+    uint32_t m_time[LINE_LOOKAHEAD_HISTORY];   // ms, oldest first
+    int32_t m_heading[LINE_LOOKAHEAD_HISTORY]; // unwrapped against the previous sample
+    int32_t m_offset[LINE_LOOKAHEAD_HISTORY];
+    uint16_t m_frameWidth;
+    uint8_t m_index;
+    uint8_t m_count;
+};
+
+inline void Pixy2LineLookahead::add(const Vector *vector, uint16_t frameWidth, uint32_t now)
+{
+    int32_t heading;
+    uint8_t i;
+
+    if (vector == NULL || frameWidth == 0)
+    {
+        reset();
+        return;
+    }
+    if (m_count && (vector->m_index != m_index || now - m_time[m_count - 1] > LINE_LOOKAHEAD_MAX_GAP))
+        reset();
+    if (m_count == LINE_LOOKAHEAD_HISTORY)
+    {
+        for (i = 1; i < LINE_LOOKAHEAD_HISTORY; i++)
+        {
+            m_time[i - 1] = m_time[i];
+            m_heading[i - 1] = m_heading[i];
+            m_offset[i - 1] = m_offset[i];
+        }
+        m_count--;
+    }
+
+    // same conventions as Pixy2LineSteering: image y grows downwards, tail (0) to head (1)
+    heading = pixyAtan2((int32_t)vector->m_x1 - vector->m_x0, (int32_t)vector->m_y0 - vector->m_y1);
+    // keep the headings continuous across +-180 degrees so the fit doesn't jump
+    if (m_count)
+        heading = m_heading[m_count - 1] + wrap(heading - m_heading[m_count - 1]);
+    m_time[m_count] = now;
+    m_heading[m_count] = heading;
+    m_offset[m_count] = (((int32_t)vector->m_x1 * 2 - frameWidth) << PIXY_Q14_SHIFT) / frameWidth;
+    m_frameWidth = frameWidth;
+    m_index = vector->m_index;
+    m_count++;
+}
+
+inline int32_t Pixy2LineLookahead::fit(const int32_t *values, int32_t t, int32_t *at)
+{
+    int64_t st, sv, stt, stv, d;
+    int32_t ti, slope;
+    uint8_t i;
+
+    st = sv = stt = stv = 0;
+    for (i = 0; i < m_count; i++)
+    {
+        ti = (int32_t)(m_time[i] - m_time[m_count - 1]);
+        st += ti;
+        sv += values[i];
+        stt += (int64_t)ti * ti;
+        stv += (int64_t)ti * values[i];
+    }
+    // n * sum((t - mean)^2) and n * sum((t - mean)(v - mean))
+    d = m_count * stt - st * st;
+    if (d <= 0)
+    {
+        // one sample, or all at the same time
+        *at = values[m_count - 1];
+        return 0;
+    }
+    slope = (int32_t)((m_count * stv - st * sv) * 1000 / d);
+    // v(t) = mean + slope * (t - mean t)
+    *at = (int32_t)((sv * 1000 + (int64_t)slope * (t * m_count - st)) / (m_count * 1000));
+    return slope;
+}
+
+inline void Pixy2LineLookahead::estimate(LineLookahead *est)
+{
+    int32_t heading, offset;
+
+    memset(est, 0, sizeof(*est));
+    if (m_count == 0)
+        return;
+    est->m_valid = 1;
+    est->m_samples = m_count;
+    est->m_heading = wrap(m_heading[m_count - 1]);
+    est->m_offset = m_offset[m_count - 1];
+
+    est->m_headingRate = fit(m_heading, lookahead, &heading);
+    est->m_offsetRate = fit(m_offset, lookahead, &offset);
+    if (speed)
+        est->m_curvature = (int64_t)est->m_headingRate * 1000 / speed;
+
+    est->m_predictedHeading = wrap(heading);
+    est->m_predictedOffset = pixyClamp(offset, PIXY_Q14_ONE);
+    est->m_predictedX = ((int32_t)est->m_predictedOffset * m_frameWidth / PIXY_Q14_ONE + m_frameWidth) / 2;
+}
+
+#endif
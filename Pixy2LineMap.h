@@ -0,0 +1,527 @@
+//
+// Map of the intersections of a maze, built natively from the line features
+// while the robot drives, and a planner that turns it into the next turn.
+//
+// A node is an intersection, keyed by the barcode seen last on the way to
+// it (code 0..15, the one nearest the vector where several are in view), or
+// else by visit order (a new node on every visit, as there's no telling it
+// apart from the others).  It keeps the angles of its branches as Pixy
+// reported them on the first visit, and for each branch the node and branch
+// it leads to and how long the robot took (ms).  Pixy2Line passes every
+// intersection it reaches to pass(), with the turn Pixy was told to take
+// there, which links the branch the robot left the previous node by with
+// the branch it came in by.
+//
+// Branch angles are relative to the direction the robot came from, so on a
+// later visit from another branch they are turned by the difference between
+// the branches: the branch the robot comes in by is always at 180 degrees.
+//
+// With a goal set, plan() computes a next-hop table whenever a link or the
+// goal changes: for every node and every branch the robot can come in by,
+// the branch to leave by towards the goal (Dijkstra over the travel times
+// from the goal backwards, never leaving by the branch it came in by, as
+// Pixy can't turn back at an intersection).  Leaving a node along a branch
+// that leads to a known node, the turn at that node is then a lookup in the
+// table, armed by Pixy2Line before the robot gets there.  At nodes that
+// aren't known yet Pixy takes its default turn.
+//
+// Coming to a node along a branch that wasn't travelled yet, the branch is
+// the one that matches the angles Pixy reports best.  Intersections that
+// look the same from several branches (a cross) can't be told apart that
+// way, a later trip along the link corrects it.
+//
+// The map only learns from the Intersection features of main-feature
+// requests (Pixy reports each intersection there once, when the vector
+// reaches it), so the line features must include intersections.  It holds
+// PIXY2_LINE_MAP_NODES nodes, once it's full new nodes aren't added and the
+// robot counts as lost until it reaches a known one.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2LINEMAP_H
+#define _PIXY2LINEMAP_H
+
+#define LINE_MAP_NONE 0xff          // no node or branch
+#define LINE_MAP_BARCODES 16        // barcode codes 0..15 are node keys
+#define LINE_MAP_NODE_BARCODE 0x01  // node flag, keyed by barcode rather than visit order
+#define LINE_MAP_STATUS_TURN 0x01   // status flags, m_nextTurn is armed for the next intersection
+#define LINE_MAP_STATUS_GOAL 0x02   // the node passed last is the goal
+#define LINE_MAP_STATUS_FULL 0x04   // a node couldn't be added
+#define LINE_MAP_STATUS_ROUTE 0x08  // the goal is reachable from the node ahead
+
+struct LineMapBranch
+{
+    int16_t m_angle;    // degrees, as seen on the first visit
+    uint8_t m_to;       // node it leads to, LINE_MAP_NONE if not travelled yet
+    uint8_t m_toBranch; // branch it arrives by there
+    uint16_t m_time;    // ms
+    uint8_t m_next;     // coming in by this branch, the branch towards the goal, LINE_MAP_NONE if there's no route
+    uint8_t m_reserved;
+};
+
+struct LineMapNode
+{
+    uint8_t m_key;        // barcode code, or visit number
+    uint8_t m_flags;
+    uint8_t m_numBranches;
+    uint8_t m_reserved;
+    LineMapBranch m_branches[LINE_MAX_INTERSECTION_LINES];
+};
+
+struct LineMapStatus
+{
+    int16_t m_nextTurn; // degrees, valid with LINE_MAP_STATUS_TURN
+    uint8_t m_numNodes;
+    uint8_t m_node;     // index of the node passed last, LINE_MAP_NONE if lost
+    uint8_t m_goal;     // barcode code, LINE_MAP_NONE if none
+    uint8_t m_flags;
+    uint16_t m_eta;     // ms from the node ahead to the goal, valid with LINE_MAP_STATUS_ROUTE
+};
+
+class Pixy2LineMap
+{
+public:
+    Pixy2LineMap()
+    {
+        m_goal = LINE_MAP_NONE;
+        reset();
+    }
+
+    // Forget all nodes, keeps the goal
+    void reset()
+    {
+        m_numNodes = 0;
+        m_visits = 0;
+        m_node = m_branch = m_barcode = LINE_MAP_NONE;
+        m_full = m_dirty = false;
+        m_turnPending = m_armed = false;
+    }
+
+    int8_t setGoal(uint8_t code)
+    {
+        if (code >= LINE_MAP_BARCODES && code != LINE_MAP_NONE)
+            return PIXY_RESULT_ERROR;
+        m_goal = code;
+        m_dirty = true;
+        arm();
+        return PIXY_RESULT_OK;
+    }
+
+    // Feed the barcodes of each main-feature request, the last one seen keys the next intersection
+    void addBarcodes(const Barcode *barcodes, uint8_t numBarcodes, const Vector *vector);
+
+    // An intersection was reached, NULL if its lines aren't known, turn is the angle Pixy was told to take
+    void pass(const Intersection *intersection, int16_t turn, uint32_t now);
+
+    // true if a turn for the next intersection still has to be sent to Pixy
+    bool needsArm()
+    {
+        return m_turnPending && !m_armed;
+    }
+
+    int16_t next()
+    {
+        return m_turn;
+    }
+
+    void setArmed()
+    {
+        m_armed = true;
+    }
+
+    void getStatus(LineMapStatus *status);
+
+    uint8_t numNodes()
+    {
+        return m_numNodes;
+    }
+
+    const LineMapNode *node(uint8_t n)
+    {
+        return &m_nodes[n];
+    }
+
+private:
+    uint8_t find(uint8_t key, uint8_t flags);
+    uint8_t add(const Intersection *intersection, uint8_t key, uint8_t flags);
+    // The branch of a node coming in by another one that a turn angle picks, like Pixy does
+    uint8_t branchAt(uint8_t node, uint8_t in, int16_t turn);
+    // The branch a known node was entered by, from the angles Pixy reports now
+    uint8_t entry(uint8_t node, const Intersection *intersection);
+    void link(uint8_t from, uint8_t fromBranch, uint8_t to, uint8_t toBranch, uint16_t time);
+    // Forget where a branch leads, and the way back
+    void unlink(uint8_t node, uint8_t branch);
+    void plan();
+    // Work out the turn for the node ahead
+    void arm();
+
+    // Angle of a branch of a node seen coming in by another one
+    int16_t relative(uint8_t node, uint8_t in, uint8_t branch)
+    {
+        return wrap(m_nodes[node].m_branches[branch].m_angle - m_nodes[node].m_branches[in].m_angle + 180);
+    }
+
+    static int16_t wrap(int32_t angle)
+    {
+        while (angle > 180)
+            angle -= 360;
+        while (angle <= -180)
+            angle += 360;
+        return angle;
+    }
+
+    LineMapNode m_nodes[PIXY2_LINE_MAP_NODES];
+    uint32_t m_dist[PIXY2_LINE_MAP_NODES][LINE_MAX_INTERSECTION_LINES]; // ms to the goal coming in by a branch, from plan()
+    uint32_t m_time;                                                   // when the last node was passed
+    int16_t m_turn;
+    uint8_t m_numNodes;
+    uint8_t m_visits;
+    uint8_t m_node;    // passed last
+    uint8_t m_branch;  // left it by
+    uint8_t m_barcode; // seen since
+    uint8_t m_goal;
+    bool m_full;
+    bool m_dirty; // the next-hop table is out of date
+    bool m_turnPending;
+    bool m_armed;
+};
+
+inline void Pixy2LineMap::addBarcodes(const Barcode *barcodes, uint8_t numBarcodes, const Vector *vector)
+{
+    int32_t dx, dy, px, py, t, len2, d, best;
+    uint8_t i, code;
+
+    for (i = 0, code = LINE_MAP_NONE, best = INT32_MAX; i < numBarcodes; i++)
+    {
+        if (barcodes[i].m_code >= LINE_MAP_BARCODES)
+            continue;
+        if (vector == NULL)
+        {
+            code = barcodes[i].m_code;
+            break;
+        }
+        // squared distance to the vector, the barcode of another line is further away
+        dx = (int32_t)vector->m_x1 - vector->m_x0;
+        dy = (int32_t)vector->m_y1 - vector->m_y0;
+        px = (int32_t)barcodes[i].m_x - vector->m_x0;
+        py = (int32_t)barcodes[i].m_y - vector->m_y0;
+        t = px * dx + py * dy;
+        len2 = dx * dx + dy * dy;
+        if (t <= 0 || len2 == 0)
+            d = px * px + py * py;
+        else if (t >= len2)
+            d = (px - dx) * (px - dx) + (py - dy) * (py - dy);
+        else
+            d = (px * dy - py * dx) * (px * dy - py * dx) / len2;
+        if (d < best)
+        {
+            best = d;
+            code = barcodes[i].m_code;
+        }
+    }
+    if (code != LINE_MAP_NONE)
+        m_barcode = code;
+}
+
+inline uint8_t Pixy2LineMap::find(uint8_t key, uint8_t flags)
+{
+    uint8_t i;
+
+    for (i = 0; i < m_numNodes; i++)
+    {
+        if (m_nodes[i].m_key == key && m_nodes[i].m_flags == flags)
+            return i;
+    }
+    return LINE_MAP_NONE;
+}
+
+inline uint8_t Pixy2LineMap::add(const Intersection *intersection, uint8_t key, uint8_t flags)
+{
+    LineMapNode *node;
+    uint8_t i;
+
+    if (m_numNodes >= PIXY2_LINE_MAP_NODES)
+    {
+        m_full = true;
+        return LINE_MAP_NONE;
+    }
+    node = &m_nodes[m_numNodes];
+    node->m_key = key;
+    node->m_flags = flags;
+    node->m_numBranches = intersection->m_n > LINE_MAX_INTERSECTION_LINES ? LINE_MAX_INTERSECTION_LINES : intersection->m_n;
+    node->m_reserved = 0;
+    for (i = 0; i < node->m_numBranches; i++)
+    {
+        node->m_branches[i].m_angle = wrap(intersection->m_intLines[i].m_angle);
+        node->m_branches[i].m_to = LINE_MAP_NONE;
+        node->m_branches[i].m_toBranch = LINE_MAP_NONE;
+        node->m_branches[i].m_time = 0;
+        node->m_branches[i].m_next = LINE_MAP_NONE;
+        node->m_branches[i].m_reserved = 0;
+    }
+    return m_numNodes++;
+}
+
+inline uint8_t Pixy2LineMap::branchAt(uint8_t node, uint8_t in, int16_t turn)
+{
+    int16_t diff, best;
+    uint8_t i, branch;
+
+    for (i = 0, branch = LINE_MAP_NONE, best = 360; i < m_nodes[node].m_numBranches; i++)
+    {
+        if (i == in && m_nodes[node].m_numBranches > 1)
+            continue; // turning back isn't an option
+        diff = wrap(relative(node, in, i) - turn);
+        if (diff < 0)
+            diff = -diff;
+        if (diff < best)
+        {
+            best = diff;
+            branch = i;
+        }
+    }
+    return branch;
+}
+
+inline uint8_t Pixy2LineMap::entry(uint8_t node, const Intersection *intersection)
+{
+    int32_t error, best;
+    int16_t diff, nearest;
+    uint8_t in, i, j, n, entry;
+
+    // turn the node so that each branch in turn is at 180, and keep the one that matches what Pixy sees best
+    n = intersection->m_n > LINE_MAX_INTERSECTION_LINES ? LINE_MAX_INTERSECTION_LINES : intersection->m_n;
+    for (in = 0, entry = 0, best = INT32_MAX; in < m_nodes[node].m_numBranches; in++)
+    {
+        for (j = 0, error = 0; j < n; j++)
+        {
+            for (i = 0, nearest = 180; i < m_nodes[node].m_numBranches; i++)
+            {
+                diff = wrap(relative(node, in, i) - intersection->m_intLines[j].m_angle);
+                if (diff < 0)
+                    diff = -diff;
+                if (diff < nearest)
+                    nearest = diff;
+            }
+            error += nearest;
+        }
+        if (error < best)
+        {
+            best = error;
+            entry = in;
+        }
+    }
+    return entry;
+}
+
+inline void Pixy2LineMap::unlink(uint8_t node, uint8_t branch)
+{
+    LineMapBranch *a;
+
+    a = &m_nodes[node].m_branches[branch];
+    if (a->m_to == LINE_MAP_NONE)
+        return;
+    m_nodes[a->m_to].m_branches[a->m_toBranch].m_to = LINE_MAP_NONE;
+    a->m_to = LINE_MAP_NONE;
+    m_dirty = true;
+}
+
+inline void Pixy2LineMap::link(uint8_t from, uint8_t fromBranch, uint8_t to, uint8_t toBranch, uint16_t time)
+{
+    LineMapBranch *a, *b;
+
+    a = &m_nodes[from].m_branches[fromBranch];
+    b = &m_nodes[to].m_branches[toBranch];
+    // what was seen last wins over links it contradicts
+    if (a->m_to != to || a->m_toBranch != toBranch)
+        unlink(from, fromBranch);
+    if (b->m_to != from || b->m_toBranch != fromBranch)
+        unlink(to, toBranch);
+    if (a->m_time != time)
+        m_dirty = true;
+    a->m_to = to;
+    a->m_toBranch = toBranch;
+    a->m_time = time;
+    // the line goes both ways
+    b->m_to = from;
+    b->m_toBranch = fromBranch;
+    b->m_time = time;
+}
+
+inline void Pixy2LineMap::pass(const Intersection *intersection, int16_t turn, uint32_t now)
+{
+    uint32_t elapsed;
+    uint8_t key, flags, node, in, i;
+    int16_t diff, best;
+
+    m_armed = m_turnPending = false;
+    if (intersection == NULL || intersection->m_n == 0)
+    {
+        // can't tell where we are
+        m_node = m_barcode = LINE_MAP_NONE;
+        return;
+    }
+    if (m_barcode != LINE_MAP_NONE)
+    {
+        key = m_barcode;
+        flags = LINE_MAP_NODE_BARCODE;
+        node = find(key, flags);
+    }
+    else
+    {
+        key = m_visits;
+        flags = 0;
+        node = LINE_MAP_NONE;
+    }
+    m_barcode = LINE_MAP_NONE;
+    m_visits++;
+
+    if (node == LINE_MAP_NONE)
+    {
+        node = add(intersection, key, flags);
+        if (node == LINE_MAP_NONE)
+        {
+            m_node = LINE_MAP_NONE;
+            return;
+        }
+        // first visit, the branch pointing back is the one we came in by
+        for (i = 0, in = 0, best = 360; i < m_nodes[node].m_numBranches; i++)
+        {
+            diff = wrap(m_nodes[node].m_branches[i].m_angle - 180);
+            if (diff < 0)
+                diff = -diff;
+            if (diff < best)
+            {
+                best = diff;
+                in = i;
+            }
+        }
+    }
+    else if (m_node != LINE_MAP_NONE && m_nodes[m_node].m_branches[m_branch].m_to == node)
+        in = m_nodes[m_node].m_branches[m_branch].m_toBranch;
+    else
+        in = entry(node, intersection);
+
+    if (m_node != LINE_MAP_NONE)
+    {
+        elapsed = now - m_time;
+        link(m_node, m_branch, node, in, elapsed > 0xffff ? 0xffff : elapsed);
+    }
+    m_node = node;
+    m_branch = branchAt(node, in, turn);
+    m_time = now;
+    arm();
+}
+
+inline void Pixy2LineMap::plan()
+{
+    LineMapBranch *back;
+    uint32_t d;
+    uint8_t goal, node, in, from, out, i, j;
+    bool done[PIXY2_LINE_MAP_NODES][LINE_MAX_INTERSECTION_LINES];
+
+    for (i = 0; i < m_numNodes; i++)
+    {
+        for (j = 0; j < LINE_MAX_INTERSECTION_LINES; j++)
+        {
+            m_dist[i][j] = UINT32_MAX;
+            m_nodes[i].m_branches[j].m_next = LINE_MAP_NONE;
+            done[i][j] = false;
+        }
+    }
+    m_dirty = false;
+    goal = m_goal == LINE_MAP_NONE ? LINE_MAP_NONE : find(m_goal, LINE_MAP_NODE_BARCODE);
+    if (goal == LINE_MAP_NONE)
+        return;
+    for (j = 0; j < m_nodes[goal].m_numBranches; j++)
+        m_dist[goal][j] = 0;
+
+    // Dijkstra from the goal over (node, branch came in by) states.  A state is
+    // reached from the states of the node at the other end of its branch that
+    // don't come in by that branch.
+    while (1)
+    {
+        for (i = 0, node = in = LINE_MAP_NONE; i < m_numNodes; i++)
+        {
+            for (j = 0; j < m_nodes[i].m_numBranches; j++)
+            {
+                if (m_dist[i][j] != UINT32_MAX && !done[i][j] &&
+                    (node == LINE_MAP_NONE || m_dist[i][j] < m_dist[node][in]))
+                {
+                    node = i;
+                    in = j;
+                }
+            }
+        }
+        if (node == LINE_MAP_NONE)
+            break;
+        done[node][in] = true;
+        back = &m_nodes[node].m_branches[in];
+        from = back->m_to;
+        out = back->m_toBranch;
+        if (from == LINE_MAP_NONE)
+            continue;
+        d = m_dist[node][in] + (back->m_time ? back->m_time : 1);
+        for (j = 0; j < m_nodes[from].m_numBranches; j++)
+        {
+            if (j == out || d >= m_dist[from][j])
+                continue;
+            m_dist[from][j] = d;
+            m_nodes[from].m_branches[j].m_next = out;
+        }
+    }
+}
+
+inline void Pixy2LineMap::arm()
+{
+    const LineMapBranch *ahead;
+    uint8_t next;
+
+    m_turnPending = m_armed = false;
+    if (m_node == LINE_MAP_NONE || m_goal == LINE_MAP_NONE)
+        return;
+    if (m_dirty)
+        plan();
+    ahead = &m_nodes[m_node].m_branches[m_branch];
+    if (ahead->m_to == LINE_MAP_NONE)
+        return;
+    next = m_nodes[ahead->m_to].m_branches[ahead->m_toBranch].m_next;
+    if (next == LINE_MAP_NONE)
+        return;
+    m_turn = relative(ahead->m_to, ahead->m_toBranch, next);
+    m_turnPending = true;
+}
+
+inline void Pixy2LineMap::getStatus(LineMapStatus *status)
+{
+    const LineMapBranch *ahead;
+    uint32_t d;
+
+    memset(status, 0, sizeof(*status));
+    status->m_numNodes = m_numNodes;
+    status->m_node = m_node;
+    status->m_goal = m_goal;
+    if (m_turnPending)
+    {
+        status->m_flags |= LINE_MAP_STATUS_TURN;
+        status->m_nextTurn = m_turn;
+    }
+    if (m_full)
+        status->m_flags |= LINE_MAP_STATUS_FULL;
+    if (m_node == LINE_MAP_NONE || m_goal == LINE_MAP_NONE)
+        return;
+    if (m_dirty)
+        plan();
+    if (m_nodes[m_node].m_flags == LINE_MAP_NODE_BARCODE && m_nodes[m_node].m_key == m_goal)
+        status->m_flags |= LINE_MAP_STATUS_GOAL;
+    ahead = &m_nodes[m_node].m_branches[m_branch];
+    if (ahead->m_to != LINE_MAP_NONE && m_dist[ahead->m_to][ahead->m_toBranch] != UINT32_MAX)
+    {
+        status->m_flags |= LINE_MAP_STATUS_ROUTE;
+        d = m_dist[ahead->m_to][ahead->m_toBranch];
+        status->m_eta = d > 0xffff ? 0xffff : d;
+    }
+}
+
+#endif
@@ -0,0 +1,113 @@
+//
+// Queue of planned turn angles consumed by Pixy2Line without any round trip
+// through TS.  The head of the queue is armed with a set-next-turn request
+// as soon as possible, and popped once Pixy reports that the intersection
+// it was meant for has been reached (an Intersection feature, or the end of
+// LINE_FLAG_INTERSECTION_PRESENT when intersections weren't requested).
+// The next entry is then armed straight away, long before the robot gets to
+// the following intersection.
+//
+// Only main-feature requests count: Pixy reports an intersection there once,
+// when the vector reaches it, while all-feature requests report every
+// intersection in view on every frame.
+//
+// Arming happens at the start of the next feature request, so the feature
+// data a caller is looking at is never overwritten by it.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2LINEROUTE_H
+#define _PIXY2LINEROUTE_H
+
+#define LINE_ROUTE_MAX_TURNS 16
+
+class Pixy2LineRoute
+{
+public:
+    Pixy2LineRoute()
+    {
+        clear();
+        turnsTaken = 0;
+    }
+
+    int8_t push(int16_t angle)
+    {
+        if (m_count >= LINE_ROUTE_MAX_TURNS)
+            return PIXY_RESULT_ERROR;
+        m_turns[(m_head + m_count) % LINE_ROUTE_MAX_TURNS] = angle;
+        m_count++;
+        return PIXY_RESULT_OK;
+    }
+
+    void clear()
+    {
+        m_head = m_count = 0;
+        m_armed = m_intersectionPresent = false;
+    }
+
+    uint8_t remaining()
+    {
+        return m_count;
+    }
+
+    // true if the head of the queue still has to be sent to Pixy
+    bool needsArm()
+    {
+        return m_count > 0 && !m_armed;
+    }
+
+    int16_t next()
+    {
+        return m_turns[m_head];
+    }
+
+    void setArmed()
+    {
+        m_armed = true;
+    }
+
+    // Feed the result of each feature request, pops the armed turn once its intersection is reached.
+    // Returns true if an intersection was reached.
+    bool update(uint8_t type, uint8_t features, Vector *vectors, uint8_t numVectors, uint8_t numIntersections);
+
+    uint16_t turnsTaken;
+
+private:
+    int16_t m_turns[LINE_ROUTE_MAX_TURNS];
+    uint8_t m_head;
+    uint8_t m_count;
+    bool m_armed;
+    bool m_intersectionPresent;
+};
+
+inline bool Pixy2LineRoute::update(uint8_t type, uint8_t features, Vector *vectors, uint8_t numVectors, uint8_t numIntersections)
+{
+    bool present, reached;
+    uint8_t i;
+
+    if (type != LINE_GET_MAIN_FEATURES)
+        return false;
+    for (i = 0, present = false; i < numVectors; i++)
+    {
+        if (vectors[i].m_flags & LINE_FLAG_INTERSECTION_PRESENT)
+            present = true;
+    }
+    if (features & LINE_INTERSECTION)
+        reached = numIntersections > 0;
+    else
+        reached = m_intersectionPresent && !present && (features & LINE_VECTOR);
+    if (features & LINE_VECTOR)
+        m_intersectionPresent = present;
+
+    if (reached && m_armed)
+    {
+        m_head = (m_head + 1) % LINE_ROUTE_MAX_TURNS;
+        m_count--;
+        m_armed = false;
+        turnsTaken++;
+    }
+    return reached;
+}
+
+#endif
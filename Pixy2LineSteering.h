@@ -0,0 +1,126 @@
+//
+// Line-following steering computed from the main Vector.  Pixy2LineSteering
+// turns the vector into a heading error and a lateral offset error in fixed
+// point, blends them into one steering error and optionally runs it through
+// a PID loop (with anti-windup) whose output is the motor differential.
+//
+// Errors are positive when the line is to the right of the robot.
+//
+
+#include "pxt.h"
+#include "Pixy2Math.h"
+
+#ifndef _PIXY2LINESTEERING_H
+#define _PIXY2LINESTEERING_H
+
+#define LINE_STEER_MIX_ONE 256 // mix is in Q8, 0 = offset only, 256 = heading only
+#define LINE_STEER_DEFAULT_OUTPUT_LIMIT 255
+#define LINE_STEER_GAIN_SHIFT 8 // gains are Q8, in output units per full scale (Q14) error
+#define LINE_STEER_MAX_DT 200 // ms, longer gaps between frames are treated as this
+
+class Pixy2LineSteering
+{
+public:
+    Pixy2LineSteering()
+    {
+        kp = ki = kd = 0;
+        mix = 0;
+        outputLimit = LINE_STEER_DEFAULT_OUTPUT_LIMIT;
+        headingError = offsetError = error = output = 0;
+        reset();
+    }
+
+    // Clear the integrator and derivative history, e.g. after the line was lost
+    void reset()
+    {
+        m_integral = 0;
+        m_havePrev = false;
+    }
+
+    // Compute the errors (and the PID output if any gain is set) from vector.
+    // Returns PIXY_RESULT_ERROR if there is no vector, leaving output unchanged.
+    int8_t update(const Vector *vector, uint16_t frameWidth, uint32_t now);
+
+    int16_t headingError; // Q6 degrees from straight ahead
+    int16_t offsetError;  // Q14 fraction of the half frame width, measured at the vector head
+    int16_t error;        // blend of the two above in Q14, the PID input
+    int16_t output;       // motor differential, -outputLimit..outputLimit
+
+    int32_t kp;
+    int32_t ki; // per second
+    int32_t kd; // per second
+    uint16_t mix;
+    int16_t outputLimit;
+
+private:
+    int32_t m_integral; // Q14 * ms
+    int16_t m_prevError;
+    uint32_t m_prevTime;
+    bool m_havePrev;
+};
+
+inline int8_t Pixy2LineSteering::update(const Vector *vector, uint16_t frameWidth, uint32_t now)
+{
+    int32_t heading, dt;
+    int64_t acc, iLimit, integral;
+
+    if (vector == NULL || frameWidth == 0)
+    {
+        reset();
+        return PIXY_RESULT_ERROR;
+    }
+
+    // image y grows downwards and the vector points from tail (0) to head (1)
+    headingError = pixyAtan2((int32_t)vector->m_x1 - vector->m_x0, (int32_t)vector->m_y0 - vector->m_y1);
+    offsetError = (((int32_t)vector->m_x1 * 2 - frameWidth) << PIXY_Q14_SHIFT) / frameWidth;
+
+    // heading scaled so that 90 degrees is full scale, then blended with the offset
+    // (a heading of 180 degrees is twice full scale, one more than error holds)
+    heading = ((int32_t)headingError << PIXY_Q14_SHIFT) / (90 * PIXY_DEG_ONE);
+    error = pixyClamp((offsetError * (int32_t)(LINE_STEER_MIX_ONE - mix) + heading * (int32_t)mix) >> 8, 0x7fff);
+
+    if (kp == 0 && ki == 0 && kd == 0)
+    {
+        output = 0;
+        return PIXY_RESULT_OK;
+    }
+
+    dt = m_havePrev ? (int32_t)(now - m_prevTime) : 0;
+    if (dt > LINE_STEER_MAX_DT)
+        dt = LINE_STEER_MAX_DT;
+    acc = (int64_t)kp * error;
+    if (dt > 0)
+    {
+        if (kd)
+            acc += (int64_t)kd * ((int32_t)(error - m_prevError) * 1000 / dt);
+        // anti-windup: don't integrate further into saturation, and bound the integral term
+        if (ki && !((output >= outputLimit && error > 0) || (output <= -outputLimit && error < 0)))
+        {
+            iLimit = (((int64_t)outputLimit << (PIXY_Q14_SHIFT + LINE_STEER_GAIN_SHIFT)) * 1000) / (ki < 0 ? -ki : ki);
+            if (iLimit > 0x7fffffff)
+                iLimit = 0x7fffffff;
+            integral = (int64_t)m_integral + (int32_t)error * dt;
+            if (integral > iLimit)
+                integral = iLimit;
+            else if (integral < -iLimit)
+                integral = -iLimit;
+            m_integral = (int32_t)integral;
+        }
+    }
+    if (ki)
+        acc += (int64_t)ki * m_integral / 1000;
+
+    acc >>= PIXY_Q14_SHIFT + LINE_STEER_GAIN_SHIFT;
+    if (acc > outputLimit)
+        output = outputLimit;
+    else if (acc < -outputLimit)
+        output = -outputLimit;
+    else
+        output = (int16_t)acc;
+    m_prevError = error;
+    m_prevTime = now;
+    m_havePrev = true;
+    return PIXY_RESULT_OK;
+}
+
+#endif
@@ -0,0 +1,331 @@
+//
+// Record and replay of the traffic between TPixy2 and its link.
+//
+// Link2Record<LinkType> wraps a link and, while its trace is recording,
+// appends every open/send/recv/close with its result, its bytes and the time
+// since the previous one to a Pixy2LinkTrace.  Link2Replay is a link without
+// a camera: it answers from such a trace, so TPixy2 parses exactly what Pixy
+// sent when the trace was recorded, on the micro:bit or compiled on a host
+// (see tools/pixy2replay.cpp).
+//
+// A trace is a 4 byte header ('P', 'X', 'L', PIXY_LINK_TRACE_VERSION)
+// followed by records, multi-byte values little endian:
+//   uint8_t  op      PIXY_LINK_OPEN/SEND/RECV/CLOSE
+//   uint8_t  len     number of data bytes
+//   uint16_t dt      us since the previous record, 0xffff = a uint32_t follows
+//   int16_t  result  what the link returned
+//   uint8_t  data[len]
+// Open records the argument as 4 bytes of data, a failed recv none.
+//
+// Recording stops (and overflow is set) when the next record doesn't fit, so
+// the trace always ends with a whole record.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2LINKTRACE_H
+#define _PIXY2LINKTRACE_H
+
+#define PIXY_LINK_TRACE_VERSION 1
+#define PIXY_LINK_TRACE_HEADER_SIZE 4
+#define PIXY_LINK_RECORD_SIZE 6 // without data and long dt
+
+#define PIXY_LINK_OPEN 1
+#define PIXY_LINK_SEND 2
+#define PIXY_LINK_RECV 3
+#define PIXY_LINK_CLOSE 4
+
+struct LinkRecord
+{
+    uint8_t m_op;
+    uint8_t m_len;
+    int16_t m_result;
+    uint32_t m_dt; // us
+    const uint8_t *m_data;
+};
+
+class Pixy2LinkTrace
+{
+public:
+    // buf holds the trace, size bytes
+    Pixy2LinkTrace(uint8_t *buf, uint32_t size)
+    {
+        m_buf = buf;
+        m_size = size;
+        length = 0;
+        recording = overflow = false;
+        mismatches = 0;
+        m_pos = 0;
+    }
+
+    // Start a new trace, the previous one is dropped
+    void startRecording()
+    {
+        length = 0;
+        overflow = false;
+        if (m_size >= PIXY_LINK_TRACE_HEADER_SIZE)
+        {
+            m_buf[0] = 'P';
+            m_buf[1] = 'X';
+            m_buf[2] = 'L';
+            m_buf[3] = PIXY_LINK_TRACE_VERSION;
+            length = PIXY_LINK_TRACE_HEADER_SIZE;
+        }
+        else
+            overflow = true;
+        m_time = system_timer_current_time_us();
+        recording = !overflow;
+    }
+
+    void stopRecording()
+    {
+        recording = false;
+    }
+
+    // Append a record, if recording
+    void add(uint8_t op, const uint8_t *data, uint8_t len, int16_t result);
+
+    // Replay the len bytes of trace in the buffer from the start, returns
+    // PIXY_RESULT_ERROR if they don't start with a trace header
+    int8_t startReplay(uint32_t len);
+
+    // Read the next record without consuming it, returns false at the end of the trace
+    bool peek(LinkRecord *rec);
+
+    // Read and consume the next record
+    bool next(LinkRecord *rec)
+    {
+        uint32_t pos = m_pos;
+
+        if (!peek(rec))
+            return false;
+        m_pos = pos + PIXY_LINK_RECORD_SIZE + (rec->m_dt >= 0xffff ? 4 : 0) + rec->m_len;
+        return true;
+    }
+
+    const uint8_t *data()
+    {
+        return m_buf;
+    }
+
+    // Replay position, bytes from the start of the trace
+    uint32_t position()
+    {
+        return m_pos;
+    }
+
+    uint32_t length;     // bytes of trace
+    bool recording;
+    bool overflow;       // recording stopped because the buffer was full
+    uint16_t mismatches; // replay requests that differed from the trace
+
+private:
+    uint8_t *m_buf;
+    uint32_t m_size;
+    uint32_t m_pos;  // replay position
+    uint32_t m_time; // us, of the last record
+};
+
+inline void Pixy2LinkTrace::add(uint8_t op, const uint8_t *data, uint8_t len, int16_t result)
+{
+    uint32_t now, dt, need;
+    uint8_t *p;
+
+    if (!recording)
+        return;
+    now = system_timer_current_time_us();
+    dt = now - m_time;
+    need = PIXY_LINK_RECORD_SIZE + (dt >= 0xffff ? 4 : 0) + len;
+    if (length + need > m_size)
+    {
+        recording = false;
+        overflow = true;
+        return;
+    }
+    m_time = now;
+
+    p = m_buf + length;
+    *p++ = op;
+    *p++ = len;
+    if (dt >= 0xffff)
+    {
+        *p++ = 0xff;
+        *p++ = 0xff;
+        *p++ = dt;
+        *p++ = dt >> 8;
+        *p++ = dt >> 16;
+        *p++ = dt >> 24;
+    }
+    else
+    {
+        *p++ = dt;
+        *p++ = dt >> 8;
+    }
+    *p++ = result;
+    *p++ = (uint16_t)result >> 8;
+    if (len)
+        memcpy(p, data, len);
+    length += need;
+}
+
+inline int8_t Pixy2LinkTrace::startReplay(uint32_t len)
+{
+    recording = false;
+    mismatches = 0;
+    if (len > m_size || len < PIXY_LINK_TRACE_HEADER_SIZE || m_buf[0] != 'P' || m_buf[1] != 'X' ||
+        m_buf[2] != 'L' || m_buf[3] != PIXY_LINK_TRACE_VERSION)
+    {
+        length = m_pos = 0;
+        return PIXY_RESULT_ERROR;
+    }
+    length = len;
+    m_pos = PIXY_LINK_TRACE_HEADER_SIZE;
+    return PIXY_RESULT_OK;
+}
+
+inline bool Pixy2LinkTrace::peek(LinkRecord *rec)
+{
+    const uint8_t *p;
+    uint32_t pos;
+
+    pos = m_pos;
+    if (pos + PIXY_LINK_RECORD_SIZE > length)
+        return false;
+    p = m_buf + pos;
+    rec->m_op = p[0];
+    rec->m_len = p[1];
+    rec->m_dt = p[2] | (uint16_t)p[3] << 8;
+    p += 4;
+    pos += PIXY_LINK_RECORD_SIZE;
+    if (rec->m_dt == 0xffff)
+    {
+        if (pos + 4 > length)
+            return false;
+        rec->m_dt = p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        p += 4;
+        pos += 4;
+    }
+    rec->m_result = (int16_t)(p[0] | (uint16_t)p[1] << 8);
+    rec->m_data = p + 2;
+    return pos + rec->m_len <= length;
+}
+
+template <class LinkType>
+class Link2Record
+{
+public:
+    Link2Record()
+    {
+        trace = NULL;
+    }
+
+    int8_t open(uint32_t arg)
+    {
+        int8_t res = link.open(arg);
+        if (trace)
+            trace->add(PIXY_LINK_OPEN, (const uint8_t *)&arg, sizeof(arg), res);
+        return res;
+    }
+
+    void close()
+    {
+        link.close();
+        if (trace)
+            trace->add(PIXY_LINK_CLOSE, NULL, 0, 0);
+    }
+
+    int16_t recv(uint8_t *buf, uint8_t len, uint16_t *cs = NULL)
+    {
+        int16_t res = link.recv(buf, len, cs);
+        if (trace)
+            trace->add(PIXY_LINK_RECV, buf, res < 0 ? 0 : len, res);
+        return res;
+    }
+
+    int16_t send(uint8_t *buf, uint8_t len)
+    {
+        int16_t res = link.send(buf, len);
+        if (trace)
+            trace->add(PIXY_LINK_SEND, buf, len, res);
+        return res;
+    }
+
+    // the real link
+    LinkType link;
+    // where to record to, NULL = don't record
+    Pixy2LinkTrace *trace;
+};
+
+class Link2Replay
+{
+public:
+    Link2Replay()
+    {
+        trace = NULL;
+    }
+
+    int8_t open(uint32_t arg)
+    {
+        LinkRecord rec;
+        if (!expect(PIXY_LINK_OPEN, &rec))
+            return PIXY_RESULT_ERROR;
+        return rec.m_result;
+    }
+
+    void close()
+    {
+        LinkRecord rec;
+        // tolerate a trace that was cut before the close
+        if (trace && trace->peek(&rec) && rec.m_op == PIXY_LINK_CLOSE)
+            trace->next(&rec);
+    }
+
+    int16_t recv(uint8_t *buf, uint8_t len, uint16_t *cs = NULL)
+    {
+        LinkRecord rec;
+        uint8_t i;
+
+        if (cs)
+            *cs = 0;
+        if (!expect(PIXY_LINK_RECV, &rec))
+            return PIXY_RESULT_ERROR;
+        if (rec.m_len != len && rec.m_result >= 0)
+            trace->mismatches++;
+        for (i = 0; i < len; i++)
+        {
+            buf[i] = i < rec.m_len ? rec.m_data[i] : 0;
+            if (cs)
+                *cs += buf[i];
+        }
+        return rec.m_result;
+    }
+
+    int16_t send(uint8_t *buf, uint8_t len)
+    {
+        LinkRecord rec;
+        if (!expect(PIXY_LINK_SEND, &rec))
+            return PIXY_RESULT_ERROR;
+        if (rec.m_len != len || memcmp(rec.m_data, buf, len))
+            trace->mismatches++;
+        return rec.m_result;
+    }
+
+    // trace to answer from, see Pixy2LinkTrace::startReplay()
+    Pixy2LinkTrace *trace;
+
+private:
+    // Consume the next record, which should be an op, fails at the end of the trace
+    bool expect(uint8_t op, LinkRecord *rec)
+    {
+        if (!trace || !trace->next(rec))
+            return false;
+        if (rec->m_op != op)
+        {
+            trace->mismatches++;
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif
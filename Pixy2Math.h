@@ -0,0 +1,126 @@
+//
+// Small integer/fixed-point helpers shared by the native processing stages.
+// Everything here avoids floating point since the micro:bit has no FPU.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2MATH_H
+#define _PIXY2MATH_H
+
+// Q14 fixed point: 1.0 == 16384
+#define PIXY_Q14_SHIFT 14
+#define PIXY_Q14_ONE (1 << PIXY_Q14_SHIFT)
+
+// Angles returned by pixyAtan2() are in degrees scaled by 64 (Q6)
+#define PIXY_DEG_SHIFT 6
+#define PIXY_DEG_ONE (1 << PIXY_DEG_SHIFT)
+
+// sin() of 0..90 degrees in Q14
+static const int16_t PIXY_SIN_TABLE[91] = {
+    0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563,
+    2845, 3126, 3406, 3686, 3964, 4240, 4516, 4790, 5063, 5334,
+    5604, 5872, 6138, 6402, 6664, 6924, 7182, 7438, 7692, 7943,
+    8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087, 10311,
+    10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+    12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+    14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+    15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+    16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+    16384};
+
+// atan(i/64) for i = 0..64, in Q6 degrees
+static const int16_t PIXY_ATAN_TABLE[65] = {
+    0, 57, 115, 172, 229, 286, 343, 399, 456, 512,
+    568, 624, 680, 735, 790, 844, 898, 952, 1005, 1058,
+    1111, 1163, 1214, 1265, 1316, 1366, 1415, 1464, 1512, 1560,
+    1607, 1654, 1700, 1746, 1791, 1835, 1879, 1922, 1965, 2007,
+    2048, 2089, 2130, 2169, 2209, 2247, 2285, 2323, 2360, 2396,
+    2432, 2467, 2502, 2536, 2570, 2603, 2636, 2668, 2700, 2731,
+    2762, 2792, 2822, 2851, 2880};
+
+// Wrap an angle in degrees into -180..180
+inline int16_t pixyWrapAngle(int32_t deg)
+{
+    deg %= 360;
+    if (deg > 180)
+        deg -= 360;
+    else if (deg < -180)
+        deg += 360;
+    return (int16_t)deg;
+}
+
+// sin(deg) in Q14
+inline int16_t pixySin(int32_t deg)
+{
+    int16_t a = pixyWrapAngle(deg);
+    bool neg = a < 0;
+    if (neg)
+        a = -a;
+    if (a > 90)
+        a = 180 - a;
+    return neg ? -PIXY_SIN_TABLE[a] : PIXY_SIN_TABLE[a];
+}
+
+// cos(deg) in Q14
+inline int16_t pixyCos(int32_t deg)
+{
+    return pixySin(deg + 90);
+}
+
+// atan2(y, x) in Q6 degrees, -180..180 degrees.  Interpolates the table above,
+// which is good to well under 0.1 degree.
+inline int16_t pixyAtan2(int32_t y, int32_t x)
+{
+    uint32_t ax, ay, num, den, ratio, frac;
+    int32_t a;
+
+    if (x == 0 && y == 0)
+        return 0;
+    ax = x < 0 ? -x : x;
+    ay = y < 0 ? -y : y;
+    // reduce to the first octant, ratio in 0..1 with 16 fractional bits
+    num = ax < ay ? ax : ay;
+    den = ax < ay ? ay : ax;
+    while (den >= 0x8000) // keep the division in 32 bits
+    {
+        num >>= 1;
+        den >>= 1;
+    }
+    ratio = (num << 16) / den;
+    frac = ratio & 0x3ff;
+    ratio >>= 10; // table index 0..64
+    a = PIXY_ATAN_TABLE[ratio];
+    if (ratio < 64)
+        a += ((PIXY_ATAN_TABLE[ratio + 1] - a) * (int32_t)frac) >> 10;
+    // undo the octant reduction
+    if (ay > ax)
+        a = 90 * PIXY_DEG_ONE - a;
+    if (x < 0)
+        a = 180 * PIXY_DEG_ONE - a;
+    if (y < 0)
+        a = -a;
+    return (int16_t)a;
+}
+
+inline int32_t pixyMin(int32_t a, int32_t b)
+{
+    return a < b ? a : b;
+}
+
+inline int32_t pixyMax(int32_t a, int32_t b)
+{
+    return a > b ? a : b;
+}
+
+// Clamp v to -limit..limit
+inline int32_t pixyClamp(int32_t v, int32_t limit)
+{
+    if (v > limit)
+        return limit;
+    if (v < -limit)
+        return -limit;
+    return v;
+}
+
+#endif
@@ -0,0 +1,166 @@
+//
+// Turns the frames fetched by the acquisition fiber into MicroBit events, so
+// TS can react to detections without polling.  In CCC mode it raises
+//   PIXY_EVT_CCC_SIG_APPEARED / _DISAPPEARED  value = signature (1..7)
+// and in line mode
+//   PIXY_EVT_LINE_INTERSECTION                value = number of branches
+//   PIXY_EVT_LINE_BARCODE_SEEN                value = code + 1
+//   PIXY_EVT_LINE_VECTOR_LOST                 value = 1
+// Signatures and the vector only count as gone after holdFrames frames
+// without them, so a detection flickering for a frame doesn't raise events.
+//
+// As with Pixy2BarcodeHistory, events are queued and only raised from
+// flushEvents(), after the frame isn't needed any more.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2MONITOR_H
+#define _PIXY2MONITOR_H
+
+#define PIXY_MONITOR_OFF 0
+#define PIXY_MONITOR_CCC 1
+#define PIXY_MONITOR_LINE 2
+
+#define PIXY_MONITOR_POLL_MS 5    // how often the acquisition fiber asks for a new frame
+#define PIXY_MONITOR_RETRY_MS 100 // wait before trying to change program again
+#define PIXY_MONITOR_DEFAULT_HOLD 3
+
+class Pixy2Monitor
+{
+public:
+    Pixy2Monitor()
+    {
+        mode = PIXY_MONITOR_OFF;
+        holdFrames = PIXY_MONITOR_DEFAULT_HOLD;
+        reset();
+    }
+
+    // Forget what was in view, e.g. when the mode changes
+    void reset()
+    {
+        m_present = 0;
+        m_appeared = m_disappeared = 0;
+        memset(m_missing, 0, sizeof(m_missing));
+        m_haveVector = m_vectorLost = false;
+        m_vectorMissing = 0;
+        m_branches = 0;
+        m_lastCodes = m_codesSeen = 0;
+    }
+
+    void updateBlocks(const Block *blocks, uint8_t numBlocks);
+    void updateFeatures(uint8_t numVectors, const Intersection *intersections, uint8_t numIntersections, const Barcode *barcodes, uint8_t numBarcodes);
+    void flushEvents();
+
+    uint8_t mode;
+    uint8_t holdFrames;
+
+private:
+    uint8_t m_present;     // bit per signature 1..7 (bit 0 = signature 1)
+    uint8_t m_appeared;    // bits waiting to be raised
+    uint8_t m_disappeared; // bits waiting to be raised
+    uint8_t m_missing[CCC_MAX_SIGNATURE];
+
+    bool m_haveVector;
+    bool m_vectorLost;
+    uint8_t m_vectorMissing;
+    uint8_t m_branches;   // of the intersection waiting to be raised, 0 if none
+    uint16_t m_lastCodes; // bit per barcode in the previous frame
+    uint16_t m_codesSeen; // bits waiting to be raised
+};
+
+inline void Pixy2Monitor::updateBlocks(const Block *blocks, uint8_t numBlocks)
+{
+    uint8_t i, seen, bit;
+
+    for (i = 0, seen = 0; i < numBlocks; i++)
+    {
+        if (blocks[i].m_signature >= 1 && blocks[i].m_signature <= CCC_MAX_SIGNATURE)
+            seen |= 1 << (blocks[i].m_signature - 1);
+    }
+    for (i = 0; i < CCC_MAX_SIGNATURE; i++)
+    {
+        bit = 1 << i;
+        if (seen & bit)
+        {
+            m_missing[i] = 0;
+            if (!(m_present & bit))
+            {
+                m_present |= bit;
+                m_appeared |= bit;
+                m_disappeared &= ~bit;
+            }
+        }
+        else if ((m_present & bit) && ++m_missing[i] >= holdFrames)
+        {
+            m_present &= ~bit;
+            m_disappeared |= bit;
+            m_appeared &= ~bit;
+        }
+    }
+}
+
+inline void Pixy2Monitor::updateFeatures(uint8_t numVectors, const Intersection *intersections, uint8_t numIntersections, const Barcode *barcodes, uint8_t numBarcodes)
+{
+    uint8_t i;
+    uint16_t codes;
+
+    if (numVectors)
+    {
+        m_haveVector = true;
+        m_vectorMissing = 0;
+    }
+    else if (m_haveVector && ++m_vectorMissing >= holdFrames)
+    {
+        m_haveVector = false;
+        m_vectorLost = true;
+    }
+
+    if (numIntersections)
+        m_branches = intersections[0].m_n ? intersections[0].m_n : 1;
+
+    // only codes that weren't in the previous frame count as seen
+    for (i = 0, codes = 0; i < numBarcodes; i++)
+    {
+        if (barcodes[i].m_code <= LINE_BARCODE_MAX_CODE)
+            codes |= 1 << barcodes[i].m_code;
+    }
+    m_codesSeen |= codes & ~m_lastCodes;
+    m_lastCodes = codes;
+}
+
+inline void Pixy2Monitor::flushEvents()
+{
+    uint8_t i, appeared, disappeared, branches;
+    uint16_t codes;
+    bool vectorLost;
+
+    // clear first, a handler may run straight away and fetch more frames
+    appeared = m_appeared;
+    disappeared = m_disappeared;
+    branches = m_branches;
+    codes = m_codesSeen;
+    vectorLost = m_vectorLost;
+    m_appeared = m_disappeared = m_branches = 0;
+    m_codesSeen = 0;
+    m_vectorLost = false;
+
+    for (i = 0; i < CCC_MAX_SIGNATURE; i++)
+    {
+        if (appeared & (1 << i))
+            MicroBitEvent evt(PIXY_EVT_CCC_SIG_APPEARED, i + 1);
+        if (disappeared & (1 << i))
+            MicroBitEvent evt(PIXY_EVT_CCC_SIG_DISAPPEARED, i + 1);
+    }
+    if (branches)
+        MicroBitEvent evt(PIXY_EVT_LINE_INTERSECTION, branches);
+    for (i = 0; codes; i++, codes >>= 1)
+    {
+        if (codes & 1)
+            MicroBitEvent evt(PIXY_EVT_LINE_BARCODE_SEEN, i + 1);
+    }
+    if (vectorLost)
+        MicroBitEvent evt(PIXY_EVT_LINE_VECTOR_LOST, 1);
+}
+
+#endif
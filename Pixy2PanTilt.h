@@ -0,0 +1,171 @@
+//
+// Pan-tilt tracker: picks a target block and keeps it in the middle of the
+// frame with one PD loop per servo, the same loops as the pan_tilt_demo that
+// ships with Pixy2 (position += (P * error + D * change in error) >> 10, error
+// in pixels).  Pan is servo 0 and tilt is servo 1.
+//
+// The target is the largest block of the wanted signature (0 = any).  Once
+// locked, the block with the same tracking index is followed even if another
+// one gets bigger, until it's lost or retarget() is called.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2PANTILT_H
+#define _PIXY2PANTILT_H
+
+#define CCC_PANTILT_GAIN_SHIFT 10
+#define CCC_PANTILT_PAN_P 400
+#define CCC_PANTILT_PAN_D 400
+#define CCC_PANTILT_TILT_P 500
+#define CCC_PANTILT_TILT_D 500
+
+#define CCC_PANTILT_POLL_MS 5 // how often the tracker fiber asks for a new frame
+
+#define CCC_PANTILT_FLAG_RUNNING 0x01
+#define CCC_PANTILT_FLAG_LOCKED 0x02
+
+struct PanTiltStatus
+{
+    uint16_t m_pan;
+    uint16_t m_tilt;
+    uint16_t m_signature; // of the target
+    uint16_t m_x;
+    uint16_t m_y;
+    uint16_t m_width;
+    uint16_t m_height;
+    uint16_t m_lostFrames; // frames since the target was last seen
+    uint8_t m_index;
+    uint8_t m_flags;
+};
+
+class Pixy2PanTilt
+{
+public:
+    Pixy2PanTilt()
+    {
+        panP = CCC_PANTILT_PAN_P;
+        panD = CCC_PANTILT_PAN_D;
+        tiltP = CCC_PANTILT_TILT_P;
+        tiltD = CCC_PANTILT_TILT_D;
+        signature = 0;
+        memset(&status, 0, sizeof(status));
+        status.m_pan = status.m_tilt = PIXY_RCS_CENTER_POS;
+        m_havePrev = false;
+    }
+
+    // Drop the current target and look for the largest block of sig (0 = any)
+    void retarget(uint16_t sig)
+    {
+        signature = sig;
+        status.m_flags &= ~CCC_PANTILT_FLAG_LOCKED;
+        m_havePrev = false;
+    }
+
+    // Sigmap to request blocks with
+    uint8_t sigmap()
+    {
+        if (signature == 0)
+            return CCC_SIG_ALL;
+        return signature > CCC_MAX_SIGNATURE ? CCC_COLOR_CODES : 1 << (signature - 1);
+    }
+
+    // Feed one frame of blocks, returns true if the servo positions changed
+    bool update(const Block *blocks, uint8_t numBlocks, uint16_t frameWidth, uint16_t frameHeight);
+
+    int32_t panP;
+    int32_t panD;
+    int32_t tiltP;
+    int32_t tiltD;
+    uint16_t signature;
+    PanTiltStatus status;
+
+private:
+    int16_t select(const Block *blocks, uint8_t numBlocks);
+    static uint16_t step(uint16_t pos, int32_t error, int32_t prevError, int32_t p, int32_t d);
+
+    int32_t m_prevPanError;
+    int32_t m_prevTiltError;
+    bool m_havePrev;
+};
+
+inline int16_t Pixy2PanTilt::select(const Block *blocks, uint8_t numBlocks)
+{
+    uint8_t i;
+    int16_t best;
+    uint32_t area, bestArea;
+
+    for (i = 0, best = -1, bestArea = 0; i < numBlocks; i++)
+    {
+        if (signature && blocks[i].m_signature != signature)
+            continue;
+        if ((status.m_flags & CCC_PANTILT_FLAG_LOCKED) && blocks[i].m_index == status.m_index)
+            return i;
+        area = (uint32_t)blocks[i].m_width * blocks[i].m_height;
+        if (best < 0 || area > bestArea)
+        {
+            best = i;
+            bestArea = area;
+        }
+    }
+    return best;
+}
+
+inline uint16_t Pixy2PanTilt::step(uint16_t pos, int32_t error, int32_t prevError, int32_t p, int32_t d)
+{
+    int32_t next;
+
+    next = pos + ((error * p + (error - prevError) * d) >> CCC_PANTILT_GAIN_SHIFT);
+    if (next < PIXY_RCS_MIN_POS)
+        return PIXY_RCS_MIN_POS;
+    return next > PIXY_RCS_MAX_POS ? PIXY_RCS_MAX_POS : next;
+}
+
+inline bool Pixy2PanTilt::update(const Block *blocks, uint8_t numBlocks, uint16_t frameWidth, uint16_t frameHeight)
+{
+    int16_t i;
+    int32_t panError, tiltError;
+    uint16_t pan, tilt;
+
+    i = select(blocks, numBlocks);
+    if (i < 0)
+    {
+        // lost, start over with the largest block once something shows up again
+        if (status.m_lostFrames < 0xffff)
+            status.m_lostFrames++;
+        status.m_flags &= ~CCC_PANTILT_FLAG_LOCKED;
+        m_havePrev = false;
+        return false;
+    }
+
+    status.m_signature = blocks[i].m_signature;
+    status.m_x = blocks[i].m_x;
+    status.m_y = blocks[i].m_y;
+    status.m_width = blocks[i].m_width;
+    status.m_height = blocks[i].m_height;
+    status.m_index = blocks[i].m_index;
+    status.m_lostFrames = 0;
+    status.m_flags |= CCC_PANTILT_FLAG_LOCKED;
+
+    // servo positions grow to the left and downwards
+    panError = (int32_t)frameWidth / 2 - blocks[i].m_x;
+    tiltError = (int32_t)blocks[i].m_y - frameHeight / 2;
+    if (!m_havePrev)
+    {
+        m_prevPanError = panError;
+        m_prevTiltError = tiltError;
+        m_havePrev = true;
+    }
+    pan = step(status.m_pan, panError, m_prevPanError, panP, panD);
+    tilt = step(status.m_tilt, tiltError, m_prevTiltError, tiltP, tiltD);
+    m_prevPanError = panError;
+    m_prevTiltError = tiltError;
+
+    if (pan == status.m_pan && tilt == status.m_tilt)
+        return false;
+    status.m_pan = pan;
+    status.m_tilt = tilt;
+    return true;
+}
+
+#endif
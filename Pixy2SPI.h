@@ -2,6 +2,7 @@
 #define _PIXY2_H
 
 #include "TPixy2.h"
+#include "Pixy2LinkTrace.h"
 #include "pxt.h"
 
 namespace String_
@@ -13,19 +14,33 @@ namespace pins
 {
     void spiTransfer(Buffer command, Buffer response);
     void spiFormat(int bits, int mode);
+    void spiFrequency(int frequency);
 }
 
-#define PIXY_SPI_CLOCKRATE 2000000
+#define PIXY_SPI_CLOCKRATE 2000000 // default, see PIXY2_SPI_FREQUENCY
 
 class Link2SPI
 {
 public:
+    Link2SPI()
+    {
+        frequency = PIXY2_SPI_FREQUENCY;
+    }
+
     int8_t open(uint32_t arg)
     {
         pins::spiFormat(8, 3); // Microbit only supports 8 bits and the Pixy2 runs on SPI mode 3
+        configure();
         return 0;
     }
 
+    // Apply the clock rate, call after changing frequency
+    void configure()
+    {
+        if (frequency)
+            pins::spiFrequency(frequency);
+    }
+
     void close()
     {
         // I'm not sure if we need to delete and set to null
@@ -61,8 +76,14 @@ public:
         pins::spiTransfer(req, resp);
         return len;
     }
+
+    uint32_t frequency; // Hz, 0 = leave the bus as it is
 };
 
-typedef TPixy2<Link2SPI> Pixy2SPI;
+#if PIXY2_ENABLE_RECORD
+typedef TPixy2Sized<Link2Record<Link2SPI>, PIXY2_BUFFER_SIZE> Pixy2SPI;
+#else
+typedef TPixy2Sized<Link2SPI, PIXY2_BUFFER_SIZE> Pixy2SPI;
+#endif
 
 #endif
\ No newline at end of file
@@ -0,0 +1,263 @@
+//
+// Keeps track of the program Pixy runs and groups requests of the same
+// program together, as every program change keeps Pixy busy for a long
+// while (PIXY_RESULT_PROG_CHANGING).
+//
+// All requests go through TPixy2::useProg(), which only changes the program
+// when Pixy isn't running it already, and only when grant() lets it.
+// Without frequency targets grant() always does, so a request changes the
+// program straight away.  Once a target is set for a program, the programs
+// get time slices instead: the program Pixy runs keeps it until its slice is
+// used up (or nothing asked for it for PIXY_SCHED_IDLE_MS), then the waiting
+// program furthest behind its target gets the next one.  Requests outside
+// their program's slice wait for it, or fail with PIXY_RESULT_BUSY if they
+// don't wait.
+//
+// In a round of slices of the n programs in use, the slices share
+// (PIXY_SCHED_AMORTIZE - 1) * n times the measured cost of a program change
+// in proportion to the targets (programs without one count as 1 Hz), so
+// about 1 / PIXY_SCHED_AMORTIZE of the time goes to changing programs and
+// each program gets its share of the rest.  Where Pixy can't keep up with
+// all targets they are all met by the same fraction.
+//
+// A single loop that makes blocking requests of several programs in turn
+// can't be grouped, use requests that don't wait (wait = false) there.
+//
+// The statistics count the program changes, the time they took and the time
+// requests waited for their slice.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2SCHEDULER_H
+#define _PIXY2SCHEDULER_H
+
+#define PIXY_PROG_CCC 0
+#define PIXY_PROG_LINE 1
+#define PIXY_PROG_VIDEO 2
+#define PIXY_PROGS 3
+#define PIXY_PROG_NONE 0xff // not known, e.g. after a reconnect
+
+#define PIXY_SCHED_AMORTIZE 4             // slices last this many program changes
+#define PIXY_SCHED_MIN_SLICE_MS 20        // about a frame
+#define PIXY_SCHED_MAX_SLICE_MS 1000
+#define PIXY_SCHED_IDLE_MS 25             // a program nothing asked for this long has no demand
+#define PIXY_SCHED_ACTIVE_MS 2000         // a program asked for within this long is in use
+#define PIXY_SCHED_POLL_MS 5              // how often a waiting request checks for its slice
+#define PIXY_SCHED_DEFAULT_CHANGE_MS 50   // cost of a program change until one is measured
+
+class Pixy2Scheduler
+{
+public:
+    Pixy2Scheduler()
+    {
+        current = PIXY_PROG_NONE;
+        memset(targets, 0, sizeof(targets));
+        memset(m_lastRequest, 0, sizeof(m_lastRequest));
+        memset(m_lastSlice, 0, sizeof(m_lastSlice));
+        m_sliceStart = 0;
+        m_changeCost = PIXY_SCHED_DEFAULT_CHANGE_MS;
+        m_measured = false;
+        m_waiting = 0;
+        clearStats();
+    }
+
+    // The program a (partial) program name selects, PIXY_PROG_NONE if none or several
+    static uint8_t program(const char *name);
+
+    static const char *name(uint8_t prog)
+    {
+        static const char *const names[PIXY_PROGS] = {"color_connected_components", "line", "video"};
+
+        return prog < PIXY_PROGS ? names[prog] : "";
+    }
+
+    bool scheduling()
+    {
+        return targets[PIXY_PROG_CCC] || targets[PIXY_PROG_LINE] || targets[PIXY_PROG_VIDEO];
+    }
+
+    // May a request for prog go ahead now (changing the program if it isn't current)
+    bool grant(uint8_t prog, uint32_t now);
+
+    // Pixy runs prog now, changing to it took ms (0 if it was running already)
+    void changed(uint8_t prog, uint32_t ms, uint32_t now);
+
+    // A blocking request waited ms for its slice, or a request that doesn't wait was turned away
+    void waited(uint32_t ms)
+    {
+        waitMs += ms;
+    }
+
+    void turnedAway()
+    {
+        busy++;
+    }
+
+    // Of the program Pixy runs, ms
+    uint16_t slice(uint32_t now);
+
+    uint16_t changeCost()
+    {
+        return m_changeCost;
+    }
+
+    void clearStats()
+    {
+        changes = 0;
+        busy = 0;
+        changeMs = 0;
+        waitMs = 0;
+        statsStart = current_time_ms();
+    }
+
+    uint8_t current;               // program Pixy runs, PIXY_PROG_NONE if not known
+    uint16_t targets[PIXY_PROGS];  // Hz, 0 = no target
+
+    // since clearStats()
+    uint16_t changes;   // program changes
+    uint16_t busy;      // requests turned away
+    uint32_t changeMs;  // time lost changing programs
+    uint32_t waitMs;    // time requests waited for their slice
+    uint32_t statsStart;
+
+private:
+    // Target of a program, programs without one count as 1 Hz
+    uint16_t weight(uint8_t prog)
+    {
+        return targets[prog] ? targets[prog] : 1;
+    }
+
+    // The waiting program furthest behind its target, PIXY_PROG_NONE if none
+    uint8_t due(uint32_t now);
+
+    uint32_t m_lastRequest[PIXY_PROGS]; // ms
+    uint32_t m_lastSlice[PIXY_PROGS];   // start of the last slice
+    uint32_t m_sliceStart;              // of the current program
+    uint16_t m_changeCost;              // ms, running average
+    bool m_measured;
+    uint8_t m_waiting;                  // bit per program with a request held back
+};
+
+inline uint8_t Pixy2Scheduler::program(const char *name)
+{
+    static const char *const names[PIXY_PROGS] = {"color_connected_components", "line_tracking", "video"};
+    uint8_t i, prog;
+    size_t len;
+
+    len = strlen(name);
+    if (len == 0)
+        return PIXY_PROG_NONE;
+    // Pixy accepts any unique prefix
+    for (i = 0, prog = PIXY_PROG_NONE; i < PIXY_PROGS; i++)
+    {
+        if (strncmp(name, names[i], len) == 0)
+        {
+            if (prog != PIXY_PROG_NONE)
+                return PIXY_PROG_NONE;
+            prog = i;
+        }
+    }
+    return prog;
+}
+
+inline uint16_t Pixy2Scheduler::slice(uint32_t now)
+{
+    uint32_t slice, sum;
+    uint8_t i, n;
+
+    if (current >= PIXY_PROGS)
+        return PIXY_SCHED_MIN_SLICE_MS;
+    for (i = 0, n = 0, sum = 0; i < PIXY_PROGS; i++)
+    {
+        if (i == current || now - m_lastRequest[i] < PIXY_SCHED_ACTIVE_MS)
+        {
+            n++;
+            sum += weight(i);
+        }
+    }
+    slice = (uint32_t)m_changeCost * (PIXY_SCHED_AMORTIZE - 1) * n * weight(current) / sum;
+    if (slice > PIXY_SCHED_MAX_SLICE_MS)
+        slice = PIXY_SCHED_MAX_SLICE_MS;
+    return slice < PIXY_SCHED_MIN_SLICE_MS ? PIXY_SCHED_MIN_SLICE_MS : slice;
+}
+
+inline uint8_t Pixy2Scheduler::due(uint32_t now)
+{
+    uint32_t lag, best;
+    uint8_t i, prog;
+
+    for (i = 0, prog = PIXY_PROG_NONE, best = 0; i < PIXY_PROGS; i++)
+    {
+        // a request that was held back but not asked again is gone (a caller that doesn't wait)
+        if (!(m_waiting & (1 << i)) || now - m_lastRequest[i] >= PIXY_SCHED_IDLE_MS)
+            continue;
+        // how far behind its target
+        lag = (now - m_lastSlice[i]) * weight(i);
+        if (prog == PIXY_PROG_NONE || lag > best)
+        {
+            best = lag;
+            prog = i;
+        }
+    }
+    return prog;
+}
+
+inline bool Pixy2Scheduler::grant(uint8_t prog, uint32_t now)
+{
+    uint8_t bit = 1 << prog;
+    uint8_t next;
+
+    m_lastRequest[prog] = now;
+    if (!scheduling())
+        return true;
+
+    if (prog == current)
+    {
+        // keep the slice while it lasts, or as long as nothing else is waiting
+        next = due(now);
+        if (now - m_sliceStart < slice(now) || next == PIXY_PROG_NONE || next == prog)
+        {
+            m_waiting &= ~bit;
+            return true;
+        }
+        m_waiting |= bit;
+        return false;
+    }
+
+    m_waiting |= bit;
+    if (current != PIXY_PROG_NONE && now - m_sliceStart < slice(now) &&
+        now - m_lastRequest[current] < PIXY_SCHED_IDLE_MS)
+        return false;
+    if (due(now) != prog)
+        return false;
+    m_waiting &= ~bit;
+    return true;
+}
+
+inline void Pixy2Scheduler::changed(uint8_t prog, uint32_t ms, uint32_t now)
+{
+    if (prog != current)
+    {
+        m_sliceStart = now;
+        if (prog < PIXY_PROGS)
+        {
+            m_lastSlice[prog] = now;
+            m_lastRequest[prog] = now;
+        }
+    }
+    current = prog;
+    if (ms == 0)
+        return;
+    changes++;
+    changeMs += ms;
+    if (ms > 0xffff)
+        ms = 0xffff;
+    if (m_measured)
+        m_changeCost += ((int32_t)ms - m_changeCost) / 4;
+    else
+        m_changeCost = ms;
+    m_measured = true;
+}
+
+#endif
@@ -0,0 +1,122 @@
+//
+// Latest-wins servo channel.  Callers post target positions without waiting
+// for Pixy; TPixy2::serviceServos() (run by the servo fiber in pixy2.cpp) asks
+// due() for the value to send at most rate times per second, so targets
+// posted in between are simply overwritten.  With slew set, the positions sent move
+// towards the target by at most slew units per second (the very first
+// positions are sent as they are, there's nothing to slew from).
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2SERVOQUEUE_H
+#define _PIXY2SERVOQUEUE_H
+
+#define PIXY_SERVO_DEFAULT_RATE 50 // Hz
+#define PIXY_SERVO_MAX_RATE 200    // Hz
+#define PIXY_SERVO_MAX_DT 1000     // ms, slew steps are capped to what this allows
+
+class Pixy2ServoQueue
+{
+public:
+    Pixy2ServoQueue()
+    {
+        rate = PIXY_SERVO_DEFAULT_RATE;
+        slew = 0;
+        posts = sends = 0;
+        m_pending = m_haveCurrent = false;
+        m_lastSend = 0;
+    }
+
+    // Set a new target, clamped to PIXY_RCS_MIN_POS..PIXY_RCS_MAX_POS
+    void post(int32_t s0, int32_t s1)
+    {
+        m_target[0] = clamp(s0);
+        m_target[1] = clamp(s1);
+        m_pending = !m_haveCurrent || m_target[0] != m_current[0] || m_target[1] != m_current[1];
+        posts++;
+    }
+
+    void setRate(int32_t hz)
+    {
+        rate = hz < 1 ? 1 : (hz > PIXY_SERVO_MAX_RATE ? PIXY_SERVO_MAX_RATE : hz);
+    }
+
+    // ms between requests
+    uint16_t interval()
+    {
+        return 1000 / rate;
+    }
+
+    // true if positions should be sent at now, s0 and s1 get the slew limited positions
+    bool due(uint32_t now, uint16_t *s0, uint16_t *s1);
+    // Report the result of sending s0, s1 as returned by due()
+    void sent(int8_t result, uint16_t s0, uint16_t s1, uint32_t now);
+
+    uint16_t rate;  // Hz
+    uint16_t slew;  // units per second, 0 = jump straight to the target
+    uint16_t posts; // targets posted
+    uint16_t sends; // requests sent
+
+private:
+    static uint16_t clamp(int32_t s)
+    {
+        if (s < PIXY_RCS_MIN_POS)
+            return PIXY_RCS_MIN_POS;
+        return s > PIXY_RCS_MAX_POS ? PIXY_RCS_MAX_POS : s;
+    }
+
+    uint16_t step(uint16_t current, uint16_t target, uint16_t maxStep)
+    {
+        if (target > current)
+            return target - current > maxStep ? current + maxStep : target;
+        return current - target > maxStep ? current - maxStep : target;
+    }
+
+    uint16_t m_target[2];
+    uint16_t m_current[2]; // last positions Pixy acknowledged
+    bool m_pending;
+    bool m_haveCurrent;
+    uint32_t m_lastSend;
+};
+
+inline bool Pixy2ServoQueue::due(uint32_t now, uint16_t *s0, uint16_t *s1)
+{
+    uint32_t dt, maxStep;
+
+    if (!m_pending)
+        return false;
+    dt = now - m_lastSend;
+    if (m_haveCurrent && dt < interval())
+        return false;
+
+    if (slew == 0 || !m_haveCurrent)
+    {
+        *s0 = m_target[0];
+        *s1 = m_target[1];
+        return true;
+    }
+    if (dt > PIXY_SERVO_MAX_DT)
+        dt = PIXY_SERVO_MAX_DT;
+    maxStep = (uint32_t)slew * dt / 1000;
+    if (maxStep == 0)
+        maxStep = 1;
+    *s0 = step(m_current[0], m_target[0], maxStep);
+    *s1 = step(m_current[1], m_target[1], maxStep);
+    return true;
+}
+
+inline void Pixy2ServoQueue::sent(int8_t result, uint16_t s0, uint16_t s1, uint32_t now)
+{
+    // failures are retried after the next interval
+    m_lastSend = now;
+    sends++;
+    if (result < 0)
+        return;
+    m_current[0] = s0;
+    m_current[1] = s1;
+    m_haveCurrent = true;
+    m_pending = m_target[0] != s0 || m_target[1] != s1;
+}
+
+#endif
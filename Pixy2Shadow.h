@@ -0,0 +1,82 @@
+//
+// Shadow copy of the actuator state Pixy last acknowledged (servos, LED, lamp
+// and camera brightness).  TPixy2 skips a set request when the value is the
+// same as the shadow, unless it's forced.  An entry is only valid after Pixy
+// accepted it; it's dropped again when a request for it fails, when any
+// packet can't be received (Pixy may have been reset) and on init().  The
+// value itself is kept so TPixy2::refreshActuators() can send it again.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2SHADOW_H
+#define _PIXY2SHADOW_H
+
+#define PIXY_SHADOW_SERVOS 0x01
+#define PIXY_SHADOW_LED 0x02
+#define PIXY_SHADOW_LAMP 0x04
+#define PIXY_SHADOW_BRIGHTNESS 0x08
+#define PIXY_SHADOW_ALL 0x0f
+
+#define PIXY_SHADOW_ENTRIES 4
+
+class Pixy2Shadow
+{
+public:
+    Pixy2Shadow()
+    {
+        valid = 0;
+        known = 0;
+        skipped = 0;
+    }
+
+    void invalidate(uint8_t which = PIXY_SHADOW_ALL)
+    {
+        valid &= ~which;
+    }
+
+    // true if Pixy already has value for which, counts the request as skipped
+    bool matches(uint8_t which, uint32_t value)
+    {
+        if ((valid & which) && m_values[index(which)] == value)
+        {
+            skipped++;
+            return true;
+        }
+        return false;
+    }
+
+    // Record the result of a set request
+    void update(uint8_t which, uint32_t value, int8_t result)
+    {
+        m_values[index(which)] = value;
+        known |= which;
+        if (result < 0)
+            invalidate(which);
+        else
+            valid |= which;
+    }
+
+    uint32_t value(uint8_t which)
+    {
+        return m_values[index(which)];
+    }
+
+    uint8_t valid;    // PIXY_SHADOW_* bits of the entries that hold Pixy's state
+    uint8_t known;    // PIXY_SHADOW_* bits of the entries that were ever set
+    uint16_t skipped; // number of requests that weren't sent
+
+private:
+    static uint8_t index(uint8_t which)
+    {
+        uint8_t i;
+
+        for (i = 0; which > 1; i++, which >>= 1)
+            ;
+        return i;
+    }
+
+    uint32_t m_values[PIXY_SHADOW_ENTRIES];
+};
+
+#endif
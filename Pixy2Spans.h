@@ -0,0 +1,180 @@
+//
+// Span tracing of requests, to see where the time of a slow frame goes.
+// With PIXY2_ENABLE_SPANS every phase of a request is timed into a ring of
+// the last PIXY2_SPAN_COUNT spans:
+//   PIXY_SPAN_SHIM      a pixy2.cpp shim that fetches blocks, line features or
+//                       RGB samples, up to handing its result to TS
+//   PIXY_SPAN_MARSHAL   building the shim's string or buffer
+//   PIXY_SPAN_REQUEST   a request/response exchange, retries included
+//   PIXY_SPAN_BUILD     putting the request together
+//   PIXY_SPAN_SEND      sending it
+//   PIXY_SPAN_SYNC      waiting for the response to start
+//   PIXY_SPAN_HEADER    receiving the response header
+//   PIXY_SPAN_PAYLOAD   receiving the response payload
+//   PIXY_SPAN_PARSE     parsing it in getBlocks()/getFeatures()
+//   PIXY_SPAN_RESYNC    throwing away a broken response
+//   PIXY_SPAN_RECONNECT see TPixy2::reconnect()
+// Spans nest, depth says how deep, and the tag is the packet type (of the
+// request, or of the response for a payload).
+//
+// The nesting is kept once for all fibers, so no span may be open while a
+// fiber sleeps.  Shims open their span after TPixy2::useProg(), which can
+// wait for the program's slice: a program change shows as a request span of
+// its own.
+//
+// The PIXY_SPAN_* macros compile to nothing without PIXY2_ENABLE_SPANS, and
+// TPixy2 has no spans member then.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2SPANS_H
+#define _PIXY2SPANS_H
+
+#define PIXY_SPAN_SHIM 1
+#define PIXY_SPAN_MARSHAL 2
+#define PIXY_SPAN_REQUEST 3
+#define PIXY_SPAN_BUILD 4
+#define PIXY_SPAN_SEND 5
+#define PIXY_SPAN_SYNC 6
+#define PIXY_SPAN_HEADER 7
+#define PIXY_SPAN_PAYLOAD 8
+#define PIXY_SPAN_PARSE 9
+#define PIXY_SPAN_RESYNC 10
+#define PIXY_SPAN_RECONNECT 11
+
+#define PIXY_SPAN_MAX_DEPTH 8
+#define PIXY_SPAN_OPEN 0xffffffff // duration of a span that hasn't ended yet
+#define PIXY_SPAN_NONE 0xffffffff // span number of a span begun while not running
+
+#if PIXY2_ENABLE_SPANS
+#define PIXY_SPAN_BEGIN(spans, phase, tag) (spans).begin(phase, tag)
+#define PIXY_SPAN_END(spans) (spans).end()
+#define PIXY_SPAN_CONCAT2(a, b) a##b
+#define PIXY_SPAN_CONCAT(a, b) PIXY_SPAN_CONCAT2(a, b)
+#define PIXY_SPAN_SCOPE(spans, phase, tag) Pixy2SpanScope PIXY_SPAN_CONCAT(pixySpanScope, __LINE__)(&(spans), phase, tag)
+#else
+#define PIXY_SPAN_BEGIN(spans, phase, tag)
+#define PIXY_SPAN_END(spans)
+#define PIXY_SPAN_SCOPE(spans, phase, tag)
+#endif
+
+struct Span
+{
+    uint32_t m_start;    // us
+    uint32_t m_duration; // us, PIXY_SPAN_OPEN if still running
+    uint8_t m_phase;
+    uint8_t m_tag;
+    uint8_t m_depth;
+    uint8_t m_reserved;
+};
+
+class Pixy2Spans
+{
+public:
+    Pixy2Spans()
+    {
+        running = false;
+        m_depth = 0;
+        clear();
+    }
+
+    // Forget the spans, the ones running now end without a trace
+    void clear()
+    {
+        m_total = 0;
+    }
+
+    void begin(uint8_t phase, uint8_t tag);
+    void end();
+
+    // Number of spans kept
+    uint16_t count()
+    {
+        return m_total < PIXY2_SPAN_COUNT ? m_total : PIXY2_SPAN_COUNT;
+    }
+
+    // The i-th of the last n spans, oldest first
+    const Span *get(uint16_t n, uint16_t i)
+    {
+        return &m_spans[(m_total - n + i) % PIXY2_SPAN_COUNT];
+    }
+
+    static const char *phaseName(uint8_t phase);
+
+    bool running;
+
+private:
+    Span m_spans[PIXY2_SPAN_COUNT];
+    uint32_t m_total;                     // spans begun since clear()
+    uint32_t m_open[PIXY_SPAN_MAX_DEPTH]; // span numbers of the spans still running
+    uint8_t m_depth;
+};
+
+inline void Pixy2Spans::begin(uint8_t phase, uint8_t tag)
+{
+    Span *span;
+
+    // keep the nesting even while not running, so end() knows what it ends
+    if (m_depth < PIXY_SPAN_MAX_DEPTH)
+        m_open[m_depth] = running ? m_total : PIXY_SPAN_NONE;
+    m_depth++;
+    if (!running)
+        return;
+    span = &m_spans[m_total % PIXY2_SPAN_COUNT];
+    span->m_phase = phase;
+    span->m_tag = tag;
+    span->m_depth = m_depth - 1;
+    span->m_duration = PIXY_SPAN_OPEN;
+    span->m_start = system_timer_current_time_us();
+    m_total++;
+}
+
+inline void Pixy2Spans::end()
+{
+    Span *span;
+    uint32_t n;
+
+    if (m_depth == 0)
+        return;
+    m_depth--;
+    if (m_depth >= PIXY_SPAN_MAX_DEPTH)
+        return;
+    n = m_open[m_depth];
+    if (n == PIXY_SPAN_NONE)
+        return;
+    // begun before clear(), or overwritten already because the ring went all the way round
+    if (n >= m_total || m_total - n > PIXY2_SPAN_COUNT)
+        return;
+    span = &m_spans[n % PIXY2_SPAN_COUNT];
+    span->m_duration = system_timer_current_time_us() - span->m_start;
+}
+
+inline const char *Pixy2Spans::phaseName(uint8_t phase)
+{
+    static const char *const names[] = {"?", "shim", "marshal", "request", "build", "send", "sync",
+                                        "header", "payload", "parse", "resync", "reconnect"};
+
+    return phase < sizeof(names) / sizeof(names[0]) ? names[phase] : names[0];
+}
+
+// Times the rest of the enclosing block
+class Pixy2SpanScope
+{
+public:
+    Pixy2SpanScope(Pixy2Spans *spans, uint8_t phase, uint8_t tag)
+    {
+        m_spans = spans;
+        m_spans->begin(phase, tag);
+    }
+
+    ~Pixy2SpanScope()
+    {
+        m_spans->end();
+    }
+
+private:
+    Pixy2Spans *m_spans;
+};
+
+#endif
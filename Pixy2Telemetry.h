@@ -0,0 +1,299 @@
+//
+// Binary telemetry of the frames fetched from Pixy.  While running, every
+// frame of blocks, line vectors or barcodes is encoded into a record and
+// queued; the telemetry fiber in pixy2.cpp drains the queue to the serial
+// port without waiting for it.  tools/pixy2telemetry.cpp turns the stream
+// back into CSV or JSON.
+//
+// A record, multi-byte values little endian:
+//   uint8_t  sync[2]  0xaa 0x55
+//   uint8_t  type     PIXY_TELEMETRY_BLOCKS/VECTORS/BARCODES
+//   uint8_t  flags    PIXY_TELEMETRY_FLAG_*
+//   uint16_t seq      counts the records of all types
+//   uint16_t len      payload bytes
+//   uint8_t  payload[len]
+//   uint16_t crc      CRC-16/CCITT-FALSE of type..payload
+// The payload is the number of items, then per item its key (tracking index
+// for blocks and vectors, position for barcodes), a mask and, for each bit
+// set in the low 7 bits of the mask, the change of that field against the
+// item with the same key in the previous record of the type, zigzag-encoded
+// as a LEB128 varint.  PIXY_TELEMETRY_NEW in the mask means there's no such
+// item and the fields are relative to 0; a key record has it set for every
+// item.  Items of the previous record that aren't in the payload are gone.
+//
+// Fields, in order:
+//   blocks    signature, x, y, width, height, angle, age
+//   vectors   x0, y0, x1, y1, flags
+//   barcodes  x, y, flags, code
+//
+// A record that doesn't fit in the queue is dropped and the next record of
+// every type is a key record.  Key records are also sent every keyInterval
+// records of a type, so a decoder that missed a record (seq gap, bad CRC)
+// picks up again.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2TELEMETRY_H
+#define _PIXY2TELEMETRY_H
+
+#define PIXY_TELEMETRY_SYNC0 0xaa
+#define PIXY_TELEMETRY_SYNC1 0x55
+#define PIXY_TELEMETRY_HEADER_SIZE 8
+#define PIXY_TELEMETRY_CRC_SIZE 2
+
+#define PIXY_TELEMETRY_BLOCKS 0
+#define PIXY_TELEMETRY_VECTORS 1
+#define PIXY_TELEMETRY_BARCODES 2
+#define PIXY_TELEMETRY_TYPES 3
+
+#define PIXY_TELEMETRY_FLAG_KEY 0x01
+#define PIXY_TELEMETRY_FLAG_TRUNCATED 0x02 // the frame had more than PIXY_TELEMETRY_MAX_ITEMS items
+
+#define PIXY_TELEMETRY_NEW 0x80
+
+#define PIXY_TELEMETRY_MAX_ITEMS 12
+#define PIXY_TELEMETRY_MAX_FIELDS 7
+// longest payload: every field changes by 17 bits of zigzag, 3 varint bytes
+#define PIXY_TELEMETRY_MAX_PAYLOAD (1 + PIXY_TELEMETRY_MAX_ITEMS * (2 + 3 * PIXY_TELEMETRY_MAX_FIELDS))
+#define PIXY_TELEMETRY_KEY_INTERVAL 30
+#define PIXY_TELEMETRY_PUMP_MS 5 // how often the telemetry fiber feeds the serial port
+
+static const uint8_t s_telemetryFields[PIXY_TELEMETRY_TYPES] = {7, 5, 4};
+
+class Pixy2Telemetry
+{
+public:
+    Pixy2Telemetry()
+    {
+        running = false;
+        keyInterval = PIXY_TELEMETRY_KEY_INTERVAL;
+        reset();
+    }
+
+    // Empty the queue and start over with key records
+    void reset()
+    {
+        m_head = m_tail = 0;
+        m_seq = 0;
+        records = dropped = 0;
+        m_keyDue = (1 << PIXY_TELEMETRY_TYPES) - 1;
+        memset(m_sinceKey, 0, sizeof(m_sinceKey));
+        memset(m_count, 0, sizeof(m_count));
+    }
+
+    void addBlocks(const Block *blocks, uint8_t numBlocks);
+    void addVectors(const Vector *vectors, uint8_t numVectors);
+    void addBarcodes(const Barcode *barcodes, uint8_t numBarcodes);
+
+    // Queued bytes that can be sent in one go, returns how many
+    uint16_t pending(const uint8_t **data)
+    {
+        *data = m_buf + m_tail;
+        return m_head >= m_tail ? m_head - m_tail : PIXY2_TELEMETRY_SIZE - m_tail;
+    }
+
+    // Drop n bytes from the queue once they're sent
+    void consume(uint16_t n)
+    {
+        m_tail = (m_tail + n) % PIXY2_TELEMETRY_SIZE;
+    }
+
+    static uint16_t crc16(uint16_t crc, uint8_t c)
+    {
+        uint8_t i;
+
+        crc ^= (uint16_t)c << 8;
+        for (i = 0; i < 8; i++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        return crc;
+    }
+
+    bool running;
+    uint8_t keyInterval; // records of a type between key records
+    uint16_t records;    // queued
+    uint16_t dropped;    // didn't fit in the queue
+
+private:
+    void encode(uint8_t type, const uint16_t *items, uint8_t numItems, uint8_t flags);
+
+    uint16_t space()
+    {
+        return (m_tail + PIXY2_TELEMETRY_SIZE - m_head - 1) % PIXY2_TELEMETRY_SIZE;
+    }
+
+    void put(uint8_t c)
+    {
+        m_buf[m_head] = c;
+        m_head = (m_head + 1) % PIXY2_TELEMETRY_SIZE;
+    }
+
+    void putVarint(int32_t delta)
+    {
+        uint32_t v = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+
+        while (v >= 0x80)
+        {
+            put(v | 0x80);
+            v >>= 7;
+        }
+        put(v);
+    }
+
+    static uint16_t stateOffset(uint8_t type)
+    {
+        uint16_t offset;
+        uint8_t t;
+
+        for (t = 0, offset = 0; t < type; t++)
+            offset += PIXY_TELEMETRY_MAX_ITEMS * (s_telemetryFields[t] + 1);
+        return offset;
+    }
+
+    uint8_t m_buf[PIXY2_TELEMETRY_SIZE];
+    uint16_t m_head;
+    uint16_t m_tail;
+    uint16_t m_seq;
+    uint8_t m_keyDue; // bit per type
+    uint8_t m_sinceKey[PIXY_TELEMETRY_TYPES];
+    // items of the last record of each type, key followed by the fields
+    uint16_t m_state[PIXY_TELEMETRY_MAX_ITEMS * (7 + 1 + 5 + 1 + 4 + 1)];
+    uint8_t m_count[PIXY_TELEMETRY_TYPES];
+};
+
+inline void Pixy2Telemetry::addBlocks(const Block *blocks, uint8_t numBlocks)
+{
+    uint16_t items[PIXY_TELEMETRY_MAX_ITEMS * (7 + 1)], *p;
+    uint8_t i, n;
+
+    n = numBlocks < PIXY_TELEMETRY_MAX_ITEMS ? numBlocks : PIXY_TELEMETRY_MAX_ITEMS;
+    for (i = 0, p = items; i < n; i++)
+    {
+        *p++ = blocks[i].m_index;
+        *p++ = blocks[i].m_signature;
+        *p++ = blocks[i].m_x;
+        *p++ = blocks[i].m_y;
+        *p++ = blocks[i].m_width;
+        *p++ = blocks[i].m_height;
+        *p++ = blocks[i].m_angle;
+        *p++ = blocks[i].m_age;
+    }
+    encode(PIXY_TELEMETRY_BLOCKS, items, n, n < numBlocks ? PIXY_TELEMETRY_FLAG_TRUNCATED : 0);
+}
+
+inline void Pixy2Telemetry::addVectors(const Vector *vectors, uint8_t numVectors)
+{
+    uint16_t items[PIXY_TELEMETRY_MAX_ITEMS * (5 + 1)], *p;
+    uint8_t i, n;
+
+    n = numVectors < PIXY_TELEMETRY_MAX_ITEMS ? numVectors : PIXY_TELEMETRY_MAX_ITEMS;
+    for (i = 0, p = items; i < n; i++)
+    {
+        *p++ = vectors[i].m_index;
+        *p++ = vectors[i].m_x0;
+        *p++ = vectors[i].m_y0;
+        *p++ = vectors[i].m_x1;
+        *p++ = vectors[i].m_y1;
+        *p++ = vectors[i].m_flags;
+    }
+    encode(PIXY_TELEMETRY_VECTORS, items, n, n < numVectors ? PIXY_TELEMETRY_FLAG_TRUNCATED : 0);
+}
+
+inline void Pixy2Telemetry::addBarcodes(const Barcode *barcodes, uint8_t numBarcodes)
+{
+    uint16_t items[PIXY_TELEMETRY_MAX_ITEMS * (4 + 1)], *p;
+    uint8_t i, n;
+
+    n = numBarcodes < PIXY_TELEMETRY_MAX_ITEMS ? numBarcodes : PIXY_TELEMETRY_MAX_ITEMS;
+    for (i = 0, p = items; i < n; i++)
+    {
+        *p++ = i;
+        *p++ = barcodes[i].m_x;
+        *p++ = barcodes[i].m_y;
+        *p++ = barcodes[i].m_flags;
+        *p++ = barcodes[i].m_code;
+    }
+    encode(PIXY_TELEMETRY_BARCODES, items, n, n < numBarcodes ? PIXY_TELEMETRY_FLAG_TRUNCATED : 0);
+}
+
+inline void Pixy2Telemetry::encode(uint8_t type, const uint16_t *items, uint8_t numItems, uint8_t flags)
+{
+    uint8_t numFields, stride, i, j, f, mask;
+    uint16_t *state, start, lenPos, len, pos, crc;
+    const uint16_t *item, *ref;
+    bool key;
+
+    numFields = s_telemetryFields[type];
+    stride = numFields + 1;
+    state = m_state + stateOffset(type);
+    key = (m_keyDue & (1 << type)) || m_sinceKey[type] + 1 >= keyInterval;
+
+    // worst case: every field changes by 17 bits of zigzag, 3 varint bytes
+    if (space() < PIXY_TELEMETRY_HEADER_SIZE + 1 + numItems * (2 + numFields * 3) + PIXY_TELEMETRY_CRC_SIZE)
+    {
+        // the decoder won't get this one, so it can't take deltas against it
+        dropped++;
+        m_keyDue = (1 << PIXY_TELEMETRY_TYPES) - 1;
+        return;
+    }
+
+    start = m_head;
+    put(PIXY_TELEMETRY_SYNC0);
+    put(PIXY_TELEMETRY_SYNC1);
+    put(type);
+    put(flags | (key ? PIXY_TELEMETRY_FLAG_KEY : 0));
+    put(m_seq);
+    put(m_seq >> 8);
+    lenPos = m_head;
+    put(0);
+    put(0);
+
+    put(numItems);
+    for (i = 0, item = items; i < numItems; i++, item += stride)
+    {
+        // the item with the same key in the previous record
+        for (j = 0, ref = NULL; !key && j < m_count[type]; j++)
+        {
+            if (state[j * stride] == item[0])
+            {
+                ref = state + j * stride;
+                break;
+            }
+        }
+        mask = ref ? 0 : PIXY_TELEMETRY_NEW;
+        for (f = 0; f < numFields; f++)
+        {
+            if (item[f + 1] != (ref ? ref[f + 1] : 0))
+                mask |= 1 << f;
+        }
+        put(item[0]);
+        put(mask);
+        for (f = 0; f < numFields; f++)
+        {
+            if (mask & (1 << f))
+                putVarint((int32_t)item[f + 1] - (ref ? ref[f + 1] : 0));
+        }
+    }
+
+    len = (m_head + PIXY2_TELEMETRY_SIZE - lenPos - 2) % PIXY2_TELEMETRY_SIZE;
+    m_buf[lenPos] = len;
+    m_buf[(lenPos + 1) % PIXY2_TELEMETRY_SIZE] = len >> 8;
+    for (pos = (start + 2) % PIXY2_TELEMETRY_SIZE, crc = 0xffff; pos != m_head; pos = (pos + 1) % PIXY2_TELEMETRY_SIZE)
+        crc = crc16(crc, m_buf[pos]);
+    put(crc);
+    put(crc >> 8);
+
+    memcpy(state, items, numItems * stride * sizeof(uint16_t));
+    m_count[type] = numItems;
+    m_seq++;
+    records++;
+    if (key)
+    {
+        m_keyDue &= ~(1 << type);
+        m_sinceKey[type] = 0;
+    }
+    else
+        m_sinceKey[type]++;
+}
+
+#endif
@@ -0,0 +1,128 @@
+//
+// Low resolution thumbnail built from getRGB samples, one sample per cell at
+// the cell center.  Pixels are stored as RGB565 (little endian) or RGB332.
+//
+// With VIDEO_THUMB_INTERLACED the cells are sampled coarse to fine: the first
+// pass samples every step-th cell and fills the whole step x step block with
+// it, every following pass halves the step and fills in between.  A scan that
+// is stopped part way therefore still gives a usable (blocky) image.
+//
+
+#include "pxt.h"
+
+#ifndef _PIXY2THUMBNAIL_H
+#define _PIXY2THUMBNAIL_H
+
+#define VIDEO_THUMB_RGB565 0
+#define VIDEO_THUMB_RGB332 1
+
+#define VIDEO_THUMB_ROWS 0
+#define VIDEO_THUMB_INTERLACED 1
+
+#define VIDEO_THUMB_MAX_BYTES 384 // e.g. 16x12 RGB565 or 24x16 RGB332
+
+class Pixy2Thumbnail
+{
+public:
+    Pixy2Thumbnail()
+    {
+        begin(0, 0, VIDEO_THUMB_RGB565, VIDEO_THUMB_ROWS);
+    }
+
+    int8_t begin(uint8_t w, uint8_t h, uint8_t fmt, uint8_t order);
+    // Find the next cell to sample, returns false once the thumbnail is complete
+    bool next(uint8_t *cx, uint8_t *cy);
+    // Store the sample for the cell returned by next() and move on
+    void store(uint8_t cx, uint8_t cy, const uint8_t *rgb);
+
+    uint16_t size()
+    {
+        return (uint16_t)width * height * (format == VIDEO_THUMB_RGB565 ? 2 : 1);
+    }
+
+    uint8_t width;
+    uint8_t height;
+    uint8_t format;
+    uint16_t samples; // taken so far
+    uint8_t pixels[VIDEO_THUMB_MAX_BYTES];
+
+private:
+    // 16 bits, so stepping past a width or height above 128 doesn't wrap
+    uint16_t m_firstStep;
+    uint16_t m_step;
+    uint16_t m_x;
+    uint16_t m_y;
+};
+
+inline int8_t Pixy2Thumbnail::begin(uint8_t w, uint8_t h, uint8_t fmt, uint8_t order)
+{
+    width = w;
+    height = h;
+    format = fmt;
+    if (size() > VIDEO_THUMB_MAX_BYTES)
+    {
+        width = height = 0;
+        return PIXY_RESULT_ERROR;
+    }
+    // largest power of 2 below the larger dimension
+    m_firstStep = 1;
+    if (order == VIDEO_THUMB_INTERLACED)
+    {
+        while ((m_firstStep << 1) < (w > h ? w : h))
+            m_firstStep <<= 1;
+    }
+    m_step = m_firstStep;
+    m_x = m_y = 0;
+    samples = 0;
+    memset(pixels, 0, sizeof(pixels));
+    return PIXY_RESULT_OK;
+}
+
+inline bool Pixy2Thumbnail::next(uint8_t *cx, uint8_t *cy)
+{
+    for (; m_step; m_step >>= 1, m_y = 0)
+    {
+        for (; m_y < height; m_y += m_step, m_x = 0)
+        {
+            for (; m_x < width; m_x += m_step)
+            {
+                // cells on the grid of the previous pass were sampled already
+                if (m_step < m_firstStep && m_x % (2 * m_step) == 0 && m_y % (2 * m_step) == 0)
+                    continue;
+                *cx = m_x;
+                *cy = m_y;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+inline void Pixy2Thumbnail::store(uint8_t cx, uint8_t cy, const uint8_t *rgb)
+{
+    uint16_t x, y, pixel;
+
+    if (format == VIDEO_THUMB_RGB565)
+        pixel = ((rgb[0] & 0xf8) << 8) | ((rgb[1] & 0xfc) << 3) | (rgb[2] >> 3);
+    else
+        pixel = (rgb[0] & 0xe0) | ((rgb[1] & 0xe0) >> 3) | (rgb[2] >> 6);
+
+    // fill the block this sample stands for until a later pass refines it
+    for (y = cy; y < cy + m_step && y < height; y++)
+    {
+        for (x = cx; x < cx + m_step && x < width; x++)
+        {
+            if (format == VIDEO_THUMB_RGB565)
+            {
+                pixels[2 * (y * width + x)] = pixel & 0xff;
+                pixels[2 * (y * width + x) + 1] = pixel >> 8;
+            }
+            else
+                pixels[y * width + x] = pixel;
+        }
+    }
+    samples++;
+    m_x += m_step;
+}
+
+#endif
@@ -24,6 +24,11 @@
 
 #define VIDEO_REQUEST_GET_RGB 0x70
 
+#define VIDEO_MAX_SAMPLES 255 // per batch
+
+#include "Pixy2Thumbnail.h"
+#include "Pixy2ColorHistogram.h"
+
 struct RGB
 {
     uint8_t r;
@@ -45,7 +50,20 @@ public:
 
     int8_t getRGB(uint16_t x, uint16_t y, uint8_t *r, uint8_t *g, uint8_t *b, bool saturate = true);
 
+    // Batched sampling, rgb receives 3 bytes (r, g, b) per sample.  Both return the number
+    // of samples taken, which is less than asked for if a request failed.
+    // points holds n (x, y) pairs as little endian uint16s, it doesn't need to be aligned.
+    int16_t getRGBPoints(const uint8_t *points, uint8_t n, uint8_t *rgb, bool saturate = true);
+    int16_t getRGBGrid(uint16_t x0, uint16_t y0, uint16_t dx, uint16_t dy, uint8_t cols, uint8_t rows, uint8_t *rgb, bool saturate = true);
+    // Take up to maxSamples more samples for thumb, returns the number taken
+    int16_t scanThumbnail(Pixy2Thumbnail *thumb, uint16_t maxSamples, bool saturate = false);
+    // Add a cols x rows grid of samples, spread over the w x h region at (x0, y0), to hist.
+    // Returns the number of samples added.
+    int16_t sampleHistogram(Pixy2ColorHistogram *hist, uint16_t x0, uint16_t y0, uint16_t w, uint16_t h, uint8_t cols, uint8_t rows, bool saturate = false);
+
 private:
+    int8_t sampleBatch(uint16_t x, uint16_t y, uint8_t *rgb, bool saturate);
+
     TPixy2<LinkType> *m_pixy;
 };
 
@@ -59,8 +77,7 @@ int8_t Pixy2Video<LinkType>::getRGB(uint16_t x, uint16_t y, uint8_t *r, uint8_t
         *(m_pixy->m_bufPayload + 4) = saturate;
         m_pixy->m_length = 5;
         m_pixy->m_type = VIDEO_REQUEST_GET_RGB;
-        m_pixy->sendPacket();
-        if (m_pixy->recvPacket() == 0)
+        if (m_pixy->exchange() == 0)
         {
             if (m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
             {
@@ -80,4 +97,101 @@ int8_t Pixy2Video<LinkType>::getRGB(uint16_t x, uint16_t y, uint8_t *r, uint8_t
     }
 }
 
+// One sample of a batch.  The whole request is filled in every time, as a
+// resync or reconnect between two samples overwrites the buffer.
+template <class LinkType>
+int8_t Pixy2Video<LinkType>::sampleBatch(uint16_t x, uint16_t y, uint8_t *rgb, bool saturate)
+{
+    while (1)
+    {
+        *(int16_t *)(m_pixy->m_bufPayload + 0) = x;
+        *(int16_t *)(m_pixy->m_bufPayload + 2) = y;
+        *(m_pixy->m_bufPayload + 4) = saturate;
+        m_pixy->m_length = 5;
+        m_pixy->m_type = VIDEO_REQUEST_GET_RGB;
+        if (m_pixy->exchange() == 0)
+        {
+            if (m_pixy->m_type == PIXY_TYPE_RESPONSE_RESULT && m_pixy->m_length == 4)
+            {
+                rgb[0] = *(m_pixy->m_buf + 2);
+                rgb[1] = *(m_pixy->m_buf + 1);
+                rgb[2] = *(m_pixy->m_buf + 0);
+                return 0;
+            }
+            else if (m_pixy->m_type == PIXY_TYPE_RESPONSE_ERROR && (int8_t)m_pixy->m_buf[0] == PIXY_RESULT_PROG_CHANGING)
+            {
+                sleep_us(500); // don't be a drag
+                continue;
+            }
+        }
+        return PIXY_RESULT_ERROR;
+    }
+}
+
+template <class LinkType>
+int16_t Pixy2Video<LinkType>::getRGBPoints(const uint8_t *points, uint8_t n, uint8_t *rgb, bool saturate)
+{
+    uint8_t i;
+
+    for (i = 0; i < n; i++, points += 4, rgb += 3)
+    {
+        if (sampleBatch(points[0] | (points[1] << 8), points[2] | (points[3] << 8), rgb, saturate) < 0)
+            break;
+    }
+    return i;
+}
+
+template <class LinkType>
+int16_t Pixy2Video<LinkType>::getRGBGrid(uint16_t x0, uint16_t y0, uint16_t dx, uint16_t dy, uint8_t cols, uint8_t rows, uint8_t *rgb, bool saturate)
+{
+    uint8_t i, j;
+    int16_t n;
+
+    for (j = 0, n = 0; j < rows; j++)
+    {
+        for (i = 0; i < cols; i++, n++, rgb += 3)
+        {
+            if (sampleBatch(x0 + i * dx, y0 + j * dy, rgb, saturate) < 0)
+                return n;
+        }
+    }
+    return n;
+}
+
+template <class LinkType>
+int16_t Pixy2Video<LinkType>::scanThumbnail(Pixy2Thumbnail *thumb, uint16_t maxSamples, bool saturate)
+{
+    uint16_t n;
+    uint8_t cx, cy, rgb[3];
+
+    for (n = 0; n < maxSamples && thumb->next(&cx, &cy); n++)
+    {
+        // sample at the center of the cell
+        if (sampleBatch((2 * cx + 1) * m_pixy->frameWidth / (2 * thumb->width),
+                        (2 * cy + 1) * m_pixy->frameHeight / (2 * thumb->height), rgb, saturate) < 0)
+            break;
+        thumb->store(cx, cy, rgb);
+    }
+    return n;
+}
+
+template <class LinkType>
+int16_t Pixy2Video<LinkType>::sampleHistogram(Pixy2ColorHistogram *hist, uint16_t x0, uint16_t y0, uint16_t w, uint16_t h, uint8_t cols, uint8_t rows, bool saturate)
+{
+    uint8_t i, j, rgb[3];
+    int16_t n;
+
+    for (j = 0, n = 0; j < rows; j++)
+    {
+        for (i = 0; i < cols; i++, n++)
+        {
+            // sample at the center of each cell of the region
+            if (sampleBatch(x0 + (uint32_t)(2 * i + 1) * w / (2 * cols), y0 + (uint32_t)(2 * j + 1) * h / (2 * rows), rgb, saturate) < 0)
+                return n;
+            hist->add(rgb);
+        }
+    }
+    return n;
+}
+
 #endif
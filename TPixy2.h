@@ -52,14 +52,37 @@
 #define PIXY_RESULT_BUTTON_OVERRIDE -5
 #define PIXY_RESULT_PROG_CHANGING -6
 
+// MicroBit message bus ids of the events raised by this library
+#define PIXY_EVT_LINE_BARCODE 4201
+#define PIXY_EVT_CCC_SIG_APPEARED 4202
+#define PIXY_EVT_CCC_SIG_DISAPPEARED 4203
+#define PIXY_EVT_LINE_INTERSECTION 4204
+#define PIXY_EVT_LINE_BARCODE_SEEN 4205
+#define PIXY_EVT_LINE_VECTOR_LOST 4206
+
+// Link fault recovery, see exchange()
+#define PIXY_DEFAULT_RETRIES 2           // resends of a request after a fault
+#define PIXY_FAULT_LIMIT 3               // requests failed in a row before reconnecting
+#define PIXY_RECONNECT_INTERVAL_MS 250   // between reconnect attempts, requests fail straight away meanwhile
+#define PIXY_RESYNC_DRAIN 64             // bytes thrown away to resync
+#define PIXY_RESYNC_DELAY_US 1000
+
 // RC-servo values
 #define PIXY_RCS_MIN_POS 0
 #define PIXY_RCS_MAX_POS 1000L
 #define PIXY_RCS_CENTER_POS ((PIXY_RCS_MAX_POS - PIXY_RCS_MIN_POS) / 2)
 
+#include "Pixy2Config.h"
+#include "Pixy2Spans.h"
 #include "Pixy2CCC.h"
 #include "Pixy2Line.h"
 #include "Pixy2Video.h"
+#include "Pixy2Shadow.h"
+#include "Pixy2ServoQueue.h"
+#include "Pixy2Monitor.h"
+#include "Pixy2AutoExposure.h"
+#include "Pixy2Scheduler.h"
+#include "Pixy2Telemetry.h"
 
 class Version
 {
@@ -94,35 +117,88 @@ template <class LinkType>
 class TPixy2
 {
 public:
-    TPixy2();
+    // buf is the send/receive buffer of bufSize bytes, it has to be 4 byte aligned
+    TPixy2(uint8_t *buf, uint16_t bufSize);
     ~TPixy2();
 
     int8_t init(uint32_t arg = PIXY_DEFAULT_ARGVAL);
 
     int8_t getVersion();
     int8_t changeProg(const char *prog);
-    int8_t setServos(uint16_t s0, uint16_t s1);
-    int8_t setCameraBrightness(uint8_t brightness);
-    int8_t setLED(uint8_t r, uint8_t g, uint8_t b);
-    int8_t setLamp(uint8_t upper, uint8_t lower);
+    // Make sure Pixy runs prog (PIXY_PROG_*) for a request, changing the program only if it
+    // doesn't and once scheduler grants it, returns PIXY_RESULT_BUSY if !wait and the
+    // program has to wait for its slice.  Waiting lets other fibers run, so no span
+    // may be open around it (the span nesting is shared by all fibers).
+    int8_t useProg(uint8_t prog, bool wait = true);
+    // The actuator setters skip the request if Pixy already has the value, see Pixy2Shadow.h
+    int8_t setServos(uint16_t s0, uint16_t s1, bool force = false);
+    int8_t setCameraBrightness(uint8_t brightness, bool force = false);
+    int8_t setLED(uint8_t r, uint8_t g, uint8_t b, bool force = false);
+    int8_t setLamp(uint8_t upper, uint8_t lower, bool force = false);
+    // Send the cached actuator state again, e.g. after Pixy was power cycled
+    int8_t refreshActuators();
+    // Send the servo positions posted to servoQueue if they are due, returns 1 if a request
+    // was sent, 0 if not, or an error
+    int8_t serviceServos();
+    // Fetch a frame for monitor (if there's a new one) and raise its events, returns the
+    // number of blocks or features, PIXY_RESULT_BUSY if there's no new frame, or an error
+    int8_t monitorFrame();
+    // Run one auto-exposure update, returns the result of setCameraBrightness(), 0 if the
+    // brightness stays, or an error
+    int8_t serviceExposure();
     int8_t getResolution();
     int8_t getFPS();
+    // Open the link again and check Pixy is back, redoing the program and actuator state
+    // if it was power cycled
+    int8_t reconnect();
 
     Version *version;
     uint16_t frameWidth;
     uint16_t frameHeight;
 
+    uint8_t retries;     // resends of a request after a fault
+    uint16_t faults;     // requests that failed even after the resends
+    uint16_t reconnects; // successful reconnect()s
+    bool probing;        // trying out bus settings: failed requests don't lead to a reconnect
+
+    // Last acknowledged actuator state
+    Pixy2Shadow shadow;
+    // Servo targets waiting for serviceServos()
+    Pixy2ServoQueue servoQueue;
+    // Detection events raised by monitorFrame()
+    Pixy2Monitor monitor;
+    // Brightness control of serviceExposure()
+    Pixy2AutoExposure exposure;
+    // Program changes and time slices of useProg()
+    Pixy2Scheduler scheduler;
+
+#if PIXY2_ENABLE_TELEMETRY
+    // Frames streamed to the serial port
+    Pixy2Telemetry telemetry;
+#endif
+
+#if PIXY2_ENABLE_SPANS
+    // Timing of the request phases
+    Pixy2Spans spans;
+#endif
+
+#if PIXY2_ENABLE_CCC
     // Color connected components, color codes
     Pixy2CCC<LinkType> ccc;
     friend class Pixy2CCC<LinkType>;
+#endif
 
+#if PIXY2_ENABLE_LINE
     // Line following
     Pixy2Line<LinkType> line;
     friend class Pixy2Line<LinkType>;
+#endif
 
+#if PIXY2_ENABLE_VIDEO
     // Video
     Pixy2Video<LinkType> video;
     friend class Pixy2Video<LinkType>;
+#endif
 
     LinkType m_link;
 
@@ -130,30 +206,76 @@ private:
     int16_t getSync();
     int16_t recvPacket();
     int16_t sendPacket();
+    // Send the request in the buffer and receive the response, with recovery
+    int16_t exchange(bool idempotent = true);
+    void resync();
 
     uint8_t *m_buf;
     uint8_t *m_bufPayload;
+    uint16_t m_bufSize;
     uint8_t m_type;
     uint8_t m_length;
     bool m_cs;
+
+    uint32_t m_arg;                        // of init()
+    char m_prog[PIXY_MAX_PROGNAME];        // last program set, empty if none
+    uint8_t m_failed;                      // requests failed in a row
+    uint32_t m_lastReconnect;              // ms
+    bool m_reconnecting;                   // no retries or reconnects while set
+};
+
+// TPixy2 with its packet buffer embedded, BufferSize bytes.  Pixy's
+// responses are at most PIXY_BUFFERSIZE bytes, a smaller buffer only works
+// for requests with short responses (e.g. few blocks, see maxBlocks, or RGB
+// samples); longer responses fail with PIXY_RESULT_ERROR.
+template <class LinkType, uint16_t BufferSize = PIXY_BUFFERSIZE>
+class TPixy2Sized : public TPixy2<LinkType>
+{
+public:
+    TPixy2Sized() : TPixy2<LinkType>((uint8_t *)m_storage, BufferSize)
+    {
+    }
+
+private:
+    // the largest request is changeProg()
+    static_assert(BufferSize >= PIXY_SEND_HEADER_SIZE + PIXY_MAX_PROGNAME, "Pixy2 buffer too small");
+
+    // uint32_t for the alignment, responses are read as 16 and 32 bit values
+    uint32_t m_storage[(BufferSize + 3) / 4];
 };
 
 template <class LinkType>
-TPixy2<LinkType>::TPixy2() : ccc(this), line(this), video(this)
+TPixy2<LinkType>::TPixy2(uint8_t *buf, uint16_t bufSize) : version(NULL)
+#if PIXY2_ENABLE_CCC
+    , ccc(this)
+#endif
+#if PIXY2_ENABLE_LINE
+    , line(this)
+#endif
+#if PIXY2_ENABLE_VIDEO
+    , video(this)
+#endif
 {
-    // allocate buffer space for send/receive
-    m_buf = (uint8_t *)malloc(PIXY_BUFFERSIZE);
+    // buffer space for send/receive
+    m_buf = buf;
+    m_bufSize = bufSize;
     // shifted buffer is used for sending, so we have space to write header information
     m_bufPayload = m_buf + PIXY_SEND_HEADER_SIZE;
     frameWidth = frameHeight = 0;
-    version = NULL;
+    retries = PIXY_DEFAULT_RETRIES;
+    faults = reconnects = 0;
+    probing = false;
+    m_arg = PIXY_DEFAULT_ARGVAL;
+    m_prog[0] = '\0';
+    m_failed = 0;
+    m_lastReconnect = 0;
+    m_reconnecting = false;
 }
 
 template <class LinkType>
 TPixy2<LinkType>::~TPixy2()
 {
     m_link.close();
-    free(m_buf);
 }
 
 template <class LinkType>
@@ -162,21 +284,28 @@ int8_t TPixy2<LinkType>::init(uint32_t arg)
     uint32_t t0;
     int8_t res;
 
+    m_arg = arg;
     res = m_link.open(arg);
     if (res < 0)
         return res;
+    // whatever Pixy had before may be gone
+    shadow.invalidate();
 
     // wait for pixy to be ready -- that is, Pixy takes a second or 2 boot up
     // getVersion is an effective "ping".  We timeout after 5s.
+    m_reconnecting = true;
     for (t0 = current_time_ms(); current_time_ms() - t0 < 5000;)
     {
         if (getVersion() >= 0) // successful version get -> pixy is ready
         {
             getResolution(); // get resolution so we have it
+            m_reconnecting = false;
+            m_failed = 0;
             return PIXY_RESULT_OK;
         }
         sleep_us(5000); // delay for sync
     }
+    m_reconnecting = false;
     // timeout
     return PIXY_RESULT_TIMEOUT;
 }
@@ -235,45 +364,82 @@ int16_t TPixy2<LinkType>::recvPacket()
     uint16_t csCalc, csSerial;
     int16_t res;
 
+    PIXY_SPAN_BEGIN(spans, PIXY_SPAN_SYNC, 0);
     res = getSync();
+    PIXY_SPAN_END(spans);
     if (res < 0)
+    {
+        // no way to tell if Pixy is still in the state we think it is
+        shadow.invalidate();
         return res;
+    }
 
     if (m_cs)
     {
+        PIXY_SPAN_BEGIN(spans, PIXY_SPAN_HEADER, 0);
         res = m_link.recv(m_buf, 4);
+        PIXY_SPAN_END(spans);
         if (res < 0)
+        {
+            shadow.invalidate();
             return res;
+        }
 
         m_type = m_buf[0];
         m_length = m_buf[1];
 
         csSerial = *(uint16_t *)&m_buf[2];
 
+        if (m_length > m_bufSize)
+        {
+            shadow.invalidate();
+            return PIXY_RESULT_ERROR;
+        }
+        PIXY_SPAN_BEGIN(spans, PIXY_SPAN_PAYLOAD, m_type);
         res = m_link.recv(m_buf, m_length, &csCalc);
+        PIXY_SPAN_END(spans);
         if (res < 0)
+        {
+            shadow.invalidate();
             return res;
+        }
 
         if (csSerial != csCalc)
         {
             // #ifdef PIXY_DEBUG
             //             std::printf("error: checksum\n");
             // #endif
+            shadow.invalidate();
             return PIXY_RESULT_CHECKSUM_ERROR;
         }
     }
     else
     {
+        PIXY_SPAN_BEGIN(spans, PIXY_SPAN_HEADER, 0);
         res = m_link.recv(m_buf, 2);
+        PIXY_SPAN_END(spans);
         if (res < 0)
+        {
+            shadow.invalidate();
             return res;
+        }
 
         m_type = m_buf[0];
         m_length = m_buf[1];
 
+        if (m_length > m_bufSize)
+        {
+            shadow.invalidate();
+            return PIXY_RESULT_ERROR;
+        }
+        PIXY_SPAN_BEGIN(spans, PIXY_SPAN_PAYLOAD, m_type);
         res = m_link.recv(m_buf, m_length);
+        PIXY_SPAN_END(spans);
         if (res < 0)
+        {
+            shadow.invalidate();
             return res;
+        }
     }
     return PIXY_RESULT_OK;
 }
@@ -290,40 +456,200 @@ int16_t TPixy2<LinkType>::sendPacket()
     return m_link.send(m_buf, m_length + PIXY_SEND_HEADER_SIZE);
 }
 
+// Requests fail because of a glitch on the bus (garbage, a checksum error, no
+// response) or because Pixy is gone, e.g. rebooting.  A failed request is
+// sent again, after throwing away what's left of the response, up to retries
+// times, unless it isn't idempotent.  Once PIXY_FAULT_LIMIT requests have
+// failed in a row, the next request first reconnects, and fails straight away
+// if that doesn't work either, trying again every PIXY_RECONNECT_INTERVAL_MS.
+template <class LinkType>
+int16_t TPixy2<LinkType>::exchange(bool idempotent)
+{
+    // the largest request is changeProg()
+    uint8_t req[PIXY_SEND_HEADER_SIZE + PIXY_MAX_PROGNAME];
+    uint8_t len, attempt;
+    int16_t res;
+
+    PIXY_SPAN_SCOPE(spans, PIXY_SPAN_REQUEST, m_type);
+    if (m_reconnecting)
+    {
+        PIXY_SPAN_BEGIN(spans, PIXY_SPAN_SEND, m_type);
+        sendPacket();
+        PIXY_SPAN_END(spans);
+        return recvPacket();
+    }
+
+    // keep the request, the response and reconnect() overwrite the buffer
+    PIXY_SPAN_BEGIN(spans, PIXY_SPAN_BUILD, m_type);
+    m_buf[0] = PIXY_NO_CHECKSUM_SYNC & 0xff;
+    m_buf[1] = PIXY_NO_CHECKSUM_SYNC >> 8;
+    m_buf[2] = m_type;
+    m_buf[3] = m_length;
+    len = m_length + PIXY_SEND_HEADER_SIZE;
+    if (len <= sizeof(req))
+        memcpy(req, m_buf, len);
+    PIXY_SPAN_END(spans);
+    if (len > sizeof(req))
+        return PIXY_RESULT_ERROR;
+
+    if (m_failed >= PIXY_FAULT_LIMIT && !probing)
+    {
+        if (current_time_ms() - m_lastReconnect < PIXY_RECONNECT_INTERVAL_MS)
+            return PIXY_RESULT_ERROR;
+        if (reconnect() < 0)
+            return PIXY_RESULT_ERROR;
+    }
+
+    for (attempt = 0;; attempt++)
+    {
+        // links report a failed send as an error or as fewer bytes sent
+        PIXY_SPAN_BEGIN(spans, PIXY_SPAN_SEND, req[2]);
+        res = m_link.send(req, len);
+        PIXY_SPAN_END(spans);
+        if (res == len)
+            res = recvPacket();
+        else if (res >= 0)
+            res = PIXY_RESULT_ERROR;
+        if (res == PIXY_RESULT_OK)
+        {
+            m_failed = 0;
+            return res;
+        }
+        if (!idempotent || attempt >= retries)
+            break;
+        resync();
+    }
+    faults++;
+    if (m_failed < 0xff && !probing)
+        m_failed++;
+    return res;
+}
+
+template <class LinkType>
+void TPixy2<LinkType>::resync()
+{
+    uint8_t i;
+
+    PIXY_SPAN_SCOPE(spans, PIXY_SPAN_RESYNC, 0);
+    // throw away the rest of the response, then give Pixy time to settle
+    for (i = 0; i < PIXY_RESYNC_DRAIN; i += 16)
+    {
+        if (m_link.recv(m_buf, 16) < 0)
+            break;
+    }
+    sleep_us(PIXY_RESYNC_DELAY_US);
+}
+
+template <class LinkType>
+int8_t TPixy2<LinkType>::reconnect()
+{
+    int8_t res;
+
+    PIXY_SPAN_SCOPE(spans, PIXY_SPAN_RECONNECT, 0);
+    m_lastReconnect = current_time_ms();
+    m_reconnecting = true;
+    // until the program is set again below
+    scheduler.current = PIXY_PROG_NONE;
+
+    m_link.close();
+    res = m_link.open(m_arg);
+    if (res >= 0)
+    {
+        resync();
+        res = getVersion();
+    }
+    if (res >= 0)
+        res = getResolution();
+    // a power cycled Pixy is back in its default program, which can't be told
+    // from the resolution (CCC and video both run at 316x208), so set it again
+    if (res >= 0 && m_prog[0])
+        res = changeProg(m_prog);
+    // and has its servos, LEDs and brightness reset, which can't be told from here
+    if (res >= 0)
+        res = refreshActuators();
+
+    m_reconnecting = false;
+    if (res < 0)
+        return res;
+    m_failed = 0;
+    reconnects++;
+    return PIXY_RESULT_OK;
+}
+
 template <class LinkType>
 int8_t TPixy2<LinkType>::changeProg(const char *prog)
 {
     int32_t res;
+    uint32_t start, elapsed;
+    uint8_t id;
 
+    id = Pixy2Scheduler::program(prog);
+    start = current_time_ms();
     // poll for program to change
     while (1)
     {
         strncpy((char *)m_bufPayload, prog, PIXY_MAX_PROGNAME);
         m_length = PIXY_MAX_PROGNAME;
         m_type = PIXY_TYPE_REQUEST_CHANGE_PROG;
-        sendPacket();
-        if (recvPacket() == 0)
+        if (exchange() == 0)
         {
             res = *(uint32_t *)m_buf;
             if (res > 0)
             {
+                // so reconnect() can set it again
+                if (prog != m_prog)
+                {
+                    strncpy(m_prog, prog, PIXY_MAX_PROGNAME - 1);
+                    m_prog[PIXY_MAX_PROGNAME - 1] = '\0';
+                }
                 getResolution();       // get resolution so we have it
+                // nothing is lost if Pixy ran the program already
+                elapsed = current_time_ms() - start;
+                if (id != PIXY_PROG_NONE && id == scheduler.current)
+                    elapsed = 0;
+                else if (elapsed == 0)
+                    elapsed = 1;
+                scheduler.changed(id, elapsed, current_time_ms());
                 return PIXY_RESULT_OK; // success
             }
         }
         else
+        {
+            // Pixy may or may not have changed programs
+            scheduler.current = PIXY_PROG_NONE;
             return PIXY_RESULT_ERROR; // some kind of bitstream error
+        }
         sleep_us(1000);
     }
 }
 
+template <class LinkType>
+int8_t TPixy2<LinkType>::useProg(uint8_t prog, bool wait)
+{
+    uint32_t start;
+
+    start = current_time_ms();
+    while (!scheduler.grant(prog, current_time_ms()))
+    {
+        if (!wait)
+        {
+            scheduler.turnedAway();
+            return PIXY_RESULT_BUSY;
+        }
+        fiber_sleep(PIXY_SCHED_POLL_MS);
+    }
+    scheduler.waited(current_time_ms() - start);
+    if (scheduler.current == prog)
+        return PIXY_RESULT_OK;
+    return changeProg(Pixy2Scheduler::name(prog));
+}
+
 template <class LinkType>
 int8_t TPixy2<LinkType>::getVersion()
 {
     m_length = 0;
     m_type = PIXY_TYPE_REQUEST_VERSION;
-    sendPacket();
-    if (recvPacket() == 0)
+    if (exchange() == 0)
     {
         if (m_type == PIXY_TYPE_RESPONSE_VERSION)
         {
@@ -342,8 +668,7 @@ int8_t TPixy2<LinkType>::getResolution()
     m_length = 1;
     m_bufPayload[0] = 0; // for future types of queries
     m_type = PIXY_TYPE_REQUEST_RESOLUTION;
-    sendPacket();
-    if (recvPacket() == 0)
+    if (exchange() == 0)
     {
         if (m_type == PIXY_TYPE_RESPONSE_RESOLUTION)
         {
@@ -359,79 +684,211 @@ int8_t TPixy2<LinkType>::getResolution()
 }
 
 template <class LinkType>
-int8_t TPixy2<LinkType>::setCameraBrightness(uint8_t brightness)
+int8_t TPixy2<LinkType>::setCameraBrightness(uint8_t brightness, bool force)
 {
     uint32_t res;
 
+    if (!force && shadow.matches(PIXY_SHADOW_BRIGHTNESS, brightness))
+        return PIXY_RESULT_OK;
+
     m_bufPayload[0] = brightness;
     m_length = 1;
     m_type = PIXY_TYPE_REQUEST_BRIGHTNESS;
-    sendPacket();
-    if (recvPacket() == 0) // && m_type==PIXY_TYPE_RESPONSE_RESULT && m_length==4)
+    if (exchange() == 0) // && m_type==PIXY_TYPE_RESPONSE_RESULT && m_length==4)
     {
         res = *(uint32_t *)m_buf;
+        shadow.update(PIXY_SHADOW_BRIGHTNESS, brightness, (int8_t)res);
         return (int8_t)res;
     }
     else
+    {
+        shadow.update(PIXY_SHADOW_BRIGHTNESS, brightness, PIXY_RESULT_ERROR);
         return PIXY_RESULT_ERROR; // some kind of bitstream error
+    }
 }
 
 template <class LinkType>
-int8_t TPixy2<LinkType>::setServos(uint16_t s0, uint16_t s1)
+int8_t TPixy2<LinkType>::setServos(uint16_t s0, uint16_t s1, bool force)
 {
     uint32_t res;
 
+    if (!force && shadow.matches(PIXY_SHADOW_SERVOS, ((uint32_t)s0 << 16) | s1))
+        return PIXY_RESULT_OK;
+
     *(int16_t *)(m_bufPayload + 0) = s0;
     *(int16_t *)(m_bufPayload + 2) = s1;
     m_length = 4;
     m_type = PIXY_TYPE_REQUEST_SERVO;
-    sendPacket();
-    if (recvPacket() == 0 && m_type == PIXY_TYPE_RESPONSE_RESULT && m_length == 4)
+    if (exchange() == 0 && m_type == PIXY_TYPE_RESPONSE_RESULT && m_length == 4)
     {
         res = *(uint32_t *)m_buf;
+        shadow.update(PIXY_SHADOW_SERVOS, ((uint32_t)s0 << 16) | s1, (int8_t)res);
         return (int8_t)res;
     }
     else
+    {
+        shadow.update(PIXY_SHADOW_SERVOS, ((uint32_t)s0 << 16) | s1, PIXY_RESULT_ERROR);
         return PIXY_RESULT_ERROR; // some kind of bitstream error
+    }
 }
 
 template <class LinkType>
-int8_t TPixy2<LinkType>::setLED(uint8_t r, uint8_t g, uint8_t b)
+int8_t TPixy2<LinkType>::setLED(uint8_t r, uint8_t g, uint8_t b, bool force)
 {
     uint32_t res;
 
+    if (!force && shadow.matches(PIXY_SHADOW_LED, ((uint32_t)r << 16) | (g << 8) | b))
+        return PIXY_RESULT_OK;
+
     m_bufPayload[0] = r;
     m_bufPayload[1] = g;
     m_bufPayload[2] = b;
     m_length = 3;
     m_type = PIXY_TYPE_REQUEST_LED;
-    sendPacket();
-    if (recvPacket() == 0 && m_type == PIXY_TYPE_RESPONSE_RESULT && m_length == 4)
+    if (exchange() == 0 && m_type == PIXY_TYPE_RESPONSE_RESULT && m_length == 4)
     {
         res = *(uint32_t *)m_buf;
+        shadow.update(PIXY_SHADOW_LED, ((uint32_t)r << 16) | (g << 8) | b, (int8_t)res);
         return (int8_t)res;
     }
     else
+    {
+        shadow.update(PIXY_SHADOW_LED, ((uint32_t)r << 16) | (g << 8) | b, PIXY_RESULT_ERROR);
         return PIXY_RESULT_ERROR; // some kind of bitstream error
+    }
 }
 
 template <class LinkType>
-int8_t TPixy2<LinkType>::setLamp(uint8_t upper, uint8_t lower)
+int8_t TPixy2<LinkType>::setLamp(uint8_t upper, uint8_t lower, bool force)
 {
     uint32_t res;
 
+    if (!force && shadow.matches(PIXY_SHADOW_LAMP, (upper << 8) | lower))
+        return PIXY_RESULT_OK;
+
     m_bufPayload[0] = upper;
     m_bufPayload[1] = lower;
     m_length = 2;
     m_type = PIXY_TYPE_REQUEST_LAMP;
-    sendPacket();
-    if (recvPacket() == 0 && m_type == PIXY_TYPE_RESPONSE_RESULT && m_length == 4)
+    if (exchange() == 0 && m_type == PIXY_TYPE_RESPONSE_RESULT && m_length == 4)
     {
         res = *(uint32_t *)m_buf;
+        shadow.update(PIXY_SHADOW_LAMP, (upper << 8) | lower, (int8_t)res);
         return (int8_t)res;
     }
     else
+    {
+        shadow.update(PIXY_SHADOW_LAMP, (upper << 8) | lower, PIXY_RESULT_ERROR);
         return PIXY_RESULT_ERROR; // some kind of bitstream error
+    }
+}
+
+template <class LinkType>
+int8_t TPixy2<LinkType>::refreshActuators()
+{
+    uint8_t valid;
+    uint32_t v;
+    int8_t res, result;
+
+    // the setters update the shadow, so work from a copy of the bits
+    valid = shadow.known;
+    result = PIXY_RESULT_OK;
+    if (valid & PIXY_SHADOW_SERVOS)
+    {
+        v = shadow.value(PIXY_SHADOW_SERVOS);
+        if ((res = setServos(v >> 16, v & 0xffff, true)) < 0)
+            result = res;
+    }
+    if (valid & PIXY_SHADOW_LED)
+    {
+        v = shadow.value(PIXY_SHADOW_LED);
+        if ((res = setLED(v >> 16, (v >> 8) & 0xff, v & 0xff, true)) < 0)
+            result = res;
+    }
+    if (valid & PIXY_SHADOW_LAMP)
+    {
+        v = shadow.value(PIXY_SHADOW_LAMP);
+        if ((res = setLamp(v >> 8, v & 0xff, true)) < 0)
+            result = res;
+    }
+    if (valid & PIXY_SHADOW_BRIGHTNESS)
+    {
+        v = shadow.value(PIXY_SHADOW_BRIGHTNESS);
+        if ((res = setCameraBrightness(v, true)) < 0)
+            result = res;
+    }
+    return result;
+}
+
+template <class LinkType>
+int8_t TPixy2<LinkType>::serviceServos()
+{
+    uint16_t s0, s1;
+    int8_t res;
+
+    if (!servoQueue.due(current_time_ms(), &s0, &s1))
+        return 0;
+    res = setServos(s0, s1);
+    servoQueue.sent(res, s0, s1, current_time_ms());
+    return res < 0 ? res : 1;
+}
+
+template <class LinkType>
+int8_t TPixy2<LinkType>::monitorFrame()
+{
+    int8_t res;
+
+#if PIXY2_ENABLE_CCC
+    if (monitor.mode == PIXY_MONITOR_CCC)
+    {
+        res = ccc.getBlocks(false);
+        if (res >= 0)
+            monitor.updateBlocks(ccc.blocks, ccc.numBlocks);
+    }
+    else
+#endif
+#if PIXY2_ENABLE_LINE
+    if (monitor.mode == PIXY_MONITOR_LINE)
+    {
+        res = line.getMainFeatures(LINE_ALL_FEATURES, false);
+        if (res >= 0)
+            monitor.updateFeatures(line.numVectors, line.intersections, line.numIntersections, line.barcodes, line.numBarcodes);
+        line.flushEvents();
+    }
+    else
+#endif
+        return PIXY_RESULT_ERROR;
+    monitor.flushEvents();
+    return res;
+}
+
+template <class LinkType>
+int8_t TPixy2<LinkType>::serviceExposure()
+{
+    int8_t fps;
+    int16_t luma, next;
+
+    fps = getFPS();
+    if (fps < 0)
+        return fps;
+    luma = -1;
+#if PIXY2_ENABLE_VIDEO
+    // getRGB would make Pixy switch to video on its own, behind the back of useProg()
+    if (exposure.lumaTarget && scheduler.current == PIXY_PROG_VIDEO)
+    {
+        Pixy2ColorHistogram hist;
+        ColorSummary summary;
+        if (video.sampleHistogram(&hist, 0, 0, frameWidth, frameHeight, PIXY_EXPOSURE_GRID_COLS, PIXY_EXPOSURE_GRID_ROWS) > 0)
+        {
+            hist.summarize(&summary);
+            luma = Pixy2AutoExposure::lumaOf(summary.m_r, summary.m_g, summary.m_b);
+        }
+    }
+#endif
+    next = exposure.update(fps, luma);
+    if (next < 0)
+        return 0;
+    return setCameraBrightness(next);
 }
 
 template <class LinkType>
@@ -441,8 +898,7 @@ int8_t TPixy2<LinkType>::getFPS()
 
     m_length = 0; // no args
     m_type = PIXY_TYPE_REQUEST_FPS;
-    sendPacket();
-    if (recvPacket() == 0 && m_type == PIXY_TYPE_RESPONSE_RESULT && m_length == 4)
+    if (exchange() == 0 && m_type == PIXY_TYPE_RESPONSE_RESULT && m_length == 4)
     {
         res = *(uint32_t *)m_buf;
         return (int8_t)res;
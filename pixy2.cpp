@@ -7,19 +7,38 @@ namespace pixy2
 {
     // TODO: Set complicated/unneeded functions to advanced=true so they don't show up in the toolbox
     // -------------- General APIs --------------
-    Pixy2I2C *pixy = nullptr;
+    // statically allocated, buffer included, so nothing is allocated at runtime
+    Pixy2I2C pixy;
+    bool pixyInitialized = false;
+#if PIXY2_ENABLE_RECORD
+    uint32_t traceStorage[(PIXY2_RECORD_SIZE + 3) / 4];
+    Pixy2LinkTrace linkTrace((uint8_t *)traceStorage, sizeof(traceStorage));
+#endif
     ManagedString COMMA = ManagedString(",");
     ManagedString SEMICOLON = ManagedString(";");
     ManagedString PIPE = ManagedString("|");
     ManagedString NEWLINE = ManagedString("\n");
     Pixy2I2C *getPixy()
     {
-        if (pixy == nullptr)
+        if (!pixyInitialized)
         {
-            pixy = new Pixy2I2C();
-            pixy->init();
+            pixyInitialized = true;
+#if PIXY2_ENABLE_RECORD
+            pixy.m_link.trace = &linkTrace;
+#endif
+            pixy.init();
         }
-        return pixy;
+        return &pixy;
+    }
+
+    // The bus underneath a recording link
+    Link2I2C *getLink()
+    {
+#if PIXY2_ENABLE_RECORD
+        return &getPixy()->m_link.link;
+#else
+        return &getPixy()->m_link;
+#endif
     }
 
     String convertResolutionToString()
@@ -35,6 +54,7 @@ namespace pixy2
         return PSTR(res);
     }
 
+#if PIXY2_ENABLE_LINE
     String convertFeaturesToString(uint8_t features, int8_t result, Vector *vectors, Intersection *intersections, Barcode *barcodes)
     {
         ManagedString vectorsString = ManagedString();
@@ -73,6 +93,7 @@ namespace pixy2
         }
         return PSTR(vectorsString + NEWLINE + intersectionsString + NEWLINE + barcodesString);
     }
+#endif
 
     /**
      * getVersion() queries and receives the firmware and hardware version of Pixy2. and then returns the version member variable. It is called automatically as part of init().
@@ -117,7 +138,7 @@ namespace pixy2
     }
 
     /**
-     * setServos() sets the servo positions of servos plugged into Pixy2's two RC servo connectors.
+     * setServos() sets the servo positions of servos plugged into Pixy2's two RC servo connectors. Nothing is sent if Pixy2 already has these positions.
      * @param s0 The servo value ranges between PIXY_RCS_MIN_POS (0) and PIXY_RCS_MAX_POS (1000).
      * @param s1 The servo value ranges between PIXY_RCS_MIN_POS (0) and PIXY_RCS_MAX_POS (1000).
      * @returns It returns an error value (<0) if it fails and 0 (PIXY_RESULT_OK) if it succeeds.
@@ -134,7 +155,7 @@ namespace pixy2
     }
 
     /**
-     * setCameraBrightness() sets the relative exposure level of Pixy2's image sensor.
+     * setCameraBrightness() sets the relative exposure level of Pixy2's image sensor. Nothing is sent if Pixy2 already has this brightness.
      * @param brightness Higher values result in a brighter (more exposed) image.
      * @returns It returns an error value (<0) if it fails and 0 (PIXY_RESULT_OK) if it succeeds.
      */
@@ -150,7 +171,7 @@ namespace pixy2
     }
 
     /**
-     * setLED() sets Pixy2's RGB LED value. It will override Pixy2's own setting of the RGB LED
+     * setLED() sets Pixy2's RGB LED value. It will override Pixy2's own setting of the RGB LED. Nothing is sent if Pixy2 already has this value.
      * @param r Sets the brightness of the red section of the LED
      * @param g Sets the brightness of the green section of the LED
      * @param b Sets the brightness of the blue section of the LED
@@ -168,7 +189,7 @@ namespace pixy2
     }
 
     /**
-     * setLamp() turns on/off Pixy2's integrated light source. Both arguments are binary, zero or non-zero. It returns an error value (<0) if it fails and 0 (PIXY_RESULT_OK) if it succeeds.
+     * setLamp() turns on/off Pixy2's integrated light source. Both arguments are binary, zero or non-zero. Nothing is sent if the lamp is already in this state. It returns an error value (<0) if it fails and 0 (PIXY_RESULT_OK) if it succeeds.
      * @param upper The upper argument controls the two white LEDs along the top edge of Pixy2's PCB.
      * @param lower The lower argument sets the RGB LED, causing it to turn on all three color channels at full brightness, resulting in white light.
      */
@@ -183,7 +204,86 @@ namespace pixy2
         return getPixy()->setLamp((uint8_t)upper, (uint8_t)lower);
     }
 
-    // TODO: Pixy2 will automatically change programs if, for example, you call getBlocks() from the color connected components program followed by getMainFeatures() from the line tracking program. These "automatic program changes" will not update frameWidth and frameHeight member variables. This cpp file changes the behaviour by calling changeProg for any function called in a separate program. Should this behaviour be kept?
+    /**
+     * refreshActuators() sends the last servo positions, LED value, lamp state and camera brightness set through this library to Pixy2 again, even if they haven't changed. Use it if Pixy2 was reset or power cycled behind the library's back.
+     * @returns It returns an error value (<0) if any of them fails and 0 (PIXY_RESULT_OK) if they all succeed.
+     */
+    //% help=pixy2/refresh-actuators
+    //% weight=91 blockGap=8
+    //% block="refresh actuators"
+    //% blockId=pixy2_refresh_actuators
+    //% parts="pixy2"
+    //% group="General"
+    int8_t refreshActuators()
+    {
+        return getPixy()->refreshActuators();
+    }
+
+    bool servoFiberRunning = false;
+
+    // Sends posted servo positions in the background.  Pixy requests don't yield, so a
+    // request from here never lands in the middle of one made by another fiber.
+    void servoFiber()
+    {
+        while (1)
+        {
+            getPixy()->serviceServos();
+            fiber_sleep(getPixy()->servoQueue.interval());
+        }
+    }
+
+    /**
+     * setServosAsync() sets new target positions for the servos without waiting for Pixy2. The positions are sent in the background at most at the rate set with setServoRate(), and only the latest target is sent, so it's safe to call it from a fast loop.
+     * @param s0 The servo value, clamped to PIXY_RCS_MIN_POS (0)..PIXY_RCS_MAX_POS (1000).
+     * @param s1 The servo value, clamped to PIXY_RCS_MIN_POS (0)..PIXY_RCS_MAX_POS (1000).
+     */
+    //% help=pixy2/set-servos-async
+    //% weight=90 blockGap=8
+    //% block="set servos async %s0 %s1"
+    //% blockId=pixy2_set_servos_async
+    //% parts="pixy2"
+    //% group="General"
+    void setServosAsync(int s0, int s1)
+    {
+        getPixy()->servoQueue.post(s0, s1);
+        if (!servoFiberRunning)
+        {
+            servoFiberRunning = true;
+            create_fiber(servoFiber);
+        }
+    }
+
+    /**
+     * setServoRate() sets how often positions posted with setServosAsync() may be sent to Pixy2.
+     * @param hz The maximum number of servo requests per second, from 1 to 200. Default is 50.
+     */
+    //% help=pixy2/set-servo-rate
+    //% weight=89 blockGap=8
+    //% block="set servo rate %hz"
+    //% blockId=pixy2_set_servo_rate
+    //% parts="pixy2"
+    //% group="General"
+    void setServoRate(int hz)
+    {
+        getPixy()->servoQueue.setRate(hz);
+    }
+
+    /**
+     * setServoSlew() limits how fast the positions sent for setServosAsync() move towards the target.
+     * @param unitsPerSecond The maximum change in servo position per second, or 0 (default) to go straight to the target.
+     */
+    //% help=pixy2/set-servo-slew
+    //% weight=88 blockGap=8
+    //% block="set servo slew %unitsPerSecond"
+    //% blockId=pixy2_set_servo_slew
+    //% parts="pixy2"
+    //% group="General"
+    void setServoSlew(int unitsPerSecond)
+    {
+        getPixy()->servoQueue.slew = unitsPerSecond < 0 ? 0 : (unitsPerSecond > 0xffff ? 0xffff : unitsPerSecond);
+    }
+
+    // TODO: Pixy2 will automatically change programs if, for example, you call getBlocks() from the color connected components program followed by getMainFeatures() from the line tracking program. These "automatic program changes" will not update frameWidth and frameHeight member variables. This cpp file changes the behaviour by changing to the program of every function first (TPixy2::useProg(), which skips it if Pixy2 runs the program already). Should this behaviour be kept?
     /**
      * getResolution() gets the width and height of the frames used by the current program.
      * @returns It returns the resolution of the new program containing frameWidth, frameHeight as a string. If it fails, it returns an null.
@@ -219,203 +319,1882 @@ namespace pixy2
         return getPixy()->getFPS();
     }
 
-    // ------------------------ Color Connected Components APIs ------------------------
+    /**
+     * getEnabledFeatures() tells which program modules this build was compiled with, see Pixy2Config.h for how to select them.
+     * @returns It returns a bit mask: 1 for color connected components, 2 for line tracking and 4 for video.
+     */
+    //% help=pixy2/get-enabled-features
+    //% weight=81 blockGap=8
+    //% block="get enabled features"
+    //% blockId=pixy2_get_enabled_features
+    //% parts="pixy2"
+    //% group="General"
+    int getEnabledFeatures()
+    {
+        return PIXY2_FEATURES;
+    }
 
     /**
-     * Internal use only. This function will be used in pixy2.ts to return the blocks of color connected components as a string.
+     * getRamFootprint() gets the number of bytes of RAM this library takes for the selected modules and buffer size: the Pixy2 object, which includes the packet buffer, and the static state of the shims.
+     * @returns It returns the size in bytes.
      */
-    //%
-    String cccGetBlocksAsString(bool wait, uint8_t sigmap, uint8_t maxBlocks)
+    //% help=pixy2/get-ram-footprint
+    //% weight=80 blockGap=8
+    //% block="get ram footprint"
+    //% blockId=pixy2_get_ram_footprint
+    //% parts="pixy2"
+    //% group="General"
+    int getRamFootprint()
     {
-        String resolution = changeProg(mkString("color_connected_components"));
-        if (resolution == NULL)
-        {
-            return NULL;
-        }
-        int8_t result = getPixy()->ccc.getBlocks(wait, sigmap, maxBlocks);
-        if (result < 0)
-        {
-            return NULL;
-        }
-        Block *blocks = getPixy()->ccc.blocks;
-        ManagedString blocksString;
-        for (int i = 0; i < result; i++)
-        {
-            ManagedString blockString = ManagedString(blocks[i].m_signature) + COMMA + ManagedString(blocks[i].m_x) + COMMA + ManagedString(blocks[i].m_y) + COMMA + ManagedString(blocks[i].m_width) + COMMA + ManagedString(blocks[i].m_height) + COMMA + ManagedString(blocks[i].m_angle) + COMMA + ManagedString(blocks[i].m_index) + COMMA + ManagedString(blocks[i].m_age);
-            if (i != result - 1)
-                blockString = blockString + SEMICOLON;
-            blocksString = blocksString + blockString;
-        }
-        return PSTR(blocksString);
+        int bytes = sizeof(Pixy2I2C);
+#if PIXY2_ENABLE_VIDEO
+        bytes += sizeof(Pixy2Thumbnail);
+#endif
+#if PIXY2_ENABLE_RECORD
+        bytes += sizeof(traceStorage) + sizeof(linkTrace);
+#endif
+        return bytes;
     }
 
-    // ------------------------ Line Tracking APIs ------------------------
+    /**
+     * startRecording() starts capturing the traffic with Pixy2 (every request and response, with timestamps) into the trace returned by getRecording(), dropping the previous one. Capturing stops when the trace buffer is full. Only works in builds with PIXY2_ENABLE_RECORD, see Pixy2Config.h.
+     * @returns It returns 0 if recording started, or -1 if this build can't record.
+     */
+    //% help=pixy2/start-recording
+    //% weight=79 blockGap=8
+    //% block="start recording"
+    //% blockId=pixy2_start_recording
+    //% parts="pixy2"
+    //% group="General"
+    int8_t startRecording()
+    {
+#if PIXY2_ENABLE_RECORD
+        getPixy();
+        linkTrace.startRecording();
+        return PIXY_RESULT_OK;
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
 
     /**
-     * Internal use only. This function will be used in pixy2.ts to return the main features of line tracking as a string.
+     * stopRecording() stops capturing the traffic with Pixy2. The trace is kept until the next startRecording().
      */
-    //%
-    String lineGetMainFeaturesAsString(uint8_t features = 0x07, bool wait = true)
+    //% help=pixy2/stop-recording
+    //% weight=78 blockGap=8
+    //% block="stop recording"
+    //% blockId=pixy2_stop_recording
+    //% parts="pixy2"
+    //% group="General"
+    void stopRecording()
     {
-        String resolution = changeProg(mkString("line"));
-        if (resolution == NULL)
-        {
-            return NULL;
-        }
-        int8_t result = getPixy()->line.getMainFeatures(features, wait);
-        if (result < 0)
-        {
-            return NULL;
-        }
-        return convertFeaturesToString(features, result, getPixy()->line.vectors, getPixy()->line.intersections, getPixy()->line.barcodes);
+#if PIXY2_ENABLE_RECORD
+        linkTrace.stopRecording();
+#endif
     }
 
     /**
-     * Internal use only. This function will be used in pixy2.ts to return all features of line tracking as a string.
+     * getRecording() gets the trace captured since startRecording(), e.g. to write it to the serial port and replay it on a computer with tools/pixy2replay.
+     * @returns It returns the trace as a buffer, empty if nothing was recorded.
      */
-    //%
-    String lineGetAllFeaturesAsString(uint8_t features = 0x07, bool wait = true)
+    //% help=pixy2/get-recording
+    //% weight=77 blockGap=8
+    //% block="get recording"
+    //% blockId=pixy2_get_recording
+    //% parts="pixy2"
+    //% group="General"
+    Buffer getRecording()
     {
-        String resolution = changeProg(mkString("line"));
-        if (resolution == NULL)
-        {
-            return NULL;
-        }
-        int8_t result = getPixy()->line.getAllFeatures(features, wait);
-        if (result < 0)
+#if PIXY2_ENABLE_RECORD
+        return pxt::mkBuffer(linkTrace.data(), linkTrace.length);
+#else
+        return pxt::mkBuffer(NULL, 0);
+#endif
+    }
+
+#if PIXY2_ENABLE_TELEMETRY
+    bool telemetryFiberRunning = false;
+
+    // Feeds the queued telemetry to the serial port, as much as its transmit buffer takes
+    void telemetryFiber()
+    {
+        Pixy2Telemetry *telemetry = &getPixy()->telemetry;
+        const uint8_t *data;
+        uint16_t len;
+        int sent;
+
+        while (telemetry->running)
         {
-            return NULL;
+            while ((len = telemetry->pending(&data)) > 0)
+            {
+                sent = uBit.serial.send((uint8_t *)data, len, ASYNC);
+                if (sent <= 0)
+                    break;
+                telemetry->consume(sent);
+                if (sent < len)
+                    break;
+            }
+            fiber_sleep(PIXY_TELEMETRY_PUMP_MS);
         }
-        return convertFeaturesToString(features, result, getPixy()->line.vectors, getPixy()->line.intersections, getPixy()->line.barcodes);
+        telemetryFiberRunning = false;
     }
+#endif
 
     /**
-     * lineSetMode() function sets various modes in the line tracking algorithm
-     * @param mode The mode argument consists of a bitwise-ORing of the following bits:
-        LINE_MODE_TURN_DELAYED
-            Normally, the line tracking algorithm will choose the straightest path (branch) when encountering an intersection. 2) Setting LINE_MODE_TURN_DELAYED will prevent the line tracking algorithm from choosing the path automatically. This is useful if your program doesn't know beforehand which path it wants to take at the next intersection.
-        LINE_MODE_MANUAL_SELECT_VECTOR
-            Normally, the line tracking algorithm will choose what it thinks is the best Vector line automatically. Setting LINE_MODE_MANUAL_SELECT_VECTOR will prevent the line tracking algorithm from choosing the Vector automatically. Instead, your program will need to set the Vector by calling setVector().
-        LINE_MODE_WHITE_LINE
-            Normally, the line tracking algorithm will try to find dark lines on a light background (black lines). Setting LINE_MODE_WHITE_LINE will instruct the line tracking algorithm to look for light lines on a dark background (white lines).
-     * @returns It returns 0 if it succeeds, otherwise it returns -1.
+     * startTelemetry() starts streaming every frame of blocks, line vectors and barcodes that is fetched from Pixy2 to the serial port, as compact binary records that tools/pixy2telemetry on a computer turns into CSV or JSON. Frames are queued and sent in the background; when the serial port can't keep up, frames are dropped instead of slowing the program down. Don't write anything else to the serial port while streaming. Only works in builds with PIXY2_ENABLE_TELEMETRY, see Pixy2Config.h.
+     * @returns It returns 0 if streaming started, or -1 if this build has no telemetry.
      */
-    //% help=pixy2/set-line-mode
-    //% weight=88 blockGap=8
-    //% block="set line mode %mode"
-    //% blockId=pixy2_set_line_mode
+    //% help=pixy2/start-telemetry
+    //% weight=76 blockGap=8
+    //% block="start telemetry"
+    //% blockId=pixy2_start_telemetry
     //% parts="pixy2"
-    //% group="Line Tracking"
-    int8_t lineSetMode(uint8_t mode)
+    //% group="General"
+    int8_t startTelemetry()
     {
-        String resolution = changeProg(mkString("line"));
-        if (resolution == NULL)
+#if PIXY2_ENABLE_TELEMETRY
+        Pixy2Telemetry *telemetry = &getPixy()->telemetry;
+        telemetry->reset();
+        telemetry->running = true;
+        if (!telemetryFiberRunning)
         {
-            return -1;
+            telemetryFiberRunning = true;
+            create_fiber(telemetryFiber);
         }
-        return getPixy()->line.setMode(mode);
+        return PIXY_RESULT_OK;
+#else
+        return PIXY_RESULT_ERROR;
+#endif
     }
 
     /**
-     * lineSetNextTurn() function tells the line tracking algorithm which path it should take at the next intersection. lineSetNextTurn() will remember the turn angle you give it, and execute it at the next intersection. The line tracking algorithm will then go back to the default turn angle for subsequent intersections. Upon encountering an intersection, the line tracking algorithm will find the path in the intersection that matches the turn angle most closely.
-     * @param angle Turn angles are specified in degrees, with 0 being straight ahead, left being 90 and right being -90 (for example), although any valid angle value can be used. Valid angles are between -180 and 180.
-     * @returns It returns 0 if it succeeds, otherwise it returns -1.
+     * stopTelemetry() stops streaming frames to the serial port.
      */
-    //% help=pixy2/set-next-turn
-    //% weight=87 blockGap=8
-    //% block="set next turn %angle"
-    //% blockId=pixy2_set_next_turn
+    //% help=pixy2/stop-telemetry
+    //% weight=75 blockGap=8
+    //% block="stop telemetry"
+    //% blockId=pixy2_stop_telemetry
     //% parts="pixy2"
-    //% group="Line Tracking"
-    int8_t lineSetNextTurn(int16_t angle)
+    //% group="General"
+    void stopTelemetry()
     {
-        String resolution = changeProg(mkString("line"));
-        if (resolution == NULL)
-        {
-            return -1;
-        }
-        return getPixy()->line.setNextTurn(angle);
+#if PIXY2_ENABLE_TELEMETRY
+        getPixy()->telemetry.running = false;
+#endif
     }
 
     /**
-     * lineSetDefaultTurn() function tells the line tracking algorithm which path to choose by default upon encountering an intersection. The line tracking algorithm will find the path in the intersection that matches the default turn angle most closely. A call to setNextTurn() will supercede the default turn angle for the next intersection.
-     * @param angle Turn angles are specified in degrees, with 0 being straight ahead, left being 90 and right being -90 (for example), although any valid angle value can be used. Valid angles are between -180 and 180.
-     * @returns It returns 0 if it succeeds, otherwise it returns -1.
+     * getTelemetryDropped() gets the number of frames that weren't streamed since startTelemetry() because the serial port couldn't keep up.
+     * @returns It returns the number of dropped frames.
      */
-    //% help=pixy2/set-default-turn
-    //% weight=86 blockGap=8
-    //% block="set default turn %angle"
-    //% blockId=pixy2_set_default_turn
+    //% help=pixy2/get-telemetry-dropped
+    //% weight=74 blockGap=8
+    //% block="get telemetry dropped"
+    //% blockId=pixy2_get_telemetry_dropped
     //% parts="pixy2"
-    //% group="Line Tracking"
-    int8_t lineSetDefaultTurn(int16_t angle)
+    //% group="General"
+    int getTelemetryDropped()
+    {
+#if PIXY2_ENABLE_TELEMETRY
+        return getPixy()->telemetry.dropped;
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * setLinkRetries() sets how many times a request is sent again when the response from Pixy2 is garbled or missing, before it fails. Requests that failed a few times in a row make the next request reconnect to Pixy2 first, which also sets the program and the servos, LEDs and brightness again in case Pixy2 was restarted.
+     * @param retries The number of retries, 0 to 10. Default is 2.
+     */
+    //% help=pixy2/set-link-retries
+    //% weight=73 blockGap=8
+    //% block="set link retries %retries"
+    //% blockId=pixy2_set_link_retries
+    //% parts="pixy2"
+    //% group="General"
+    void setLinkRetries(int retries)
+    {
+        getPixy()->retries = retries < 0 ? 0 : (retries > 10 ? 10 : retries);
+    }
+
+    /**
+     * getReconnectCount() gets how many times the connection to Pixy2 was lost and recovered, see setLinkRetries().
+     * @returns It returns the number of reconnects.
+     */
+    //% help=pixy2/get-reconnect-count
+    //% weight=72 blockGap=8
+    //% block="get reconnect count"
+    //% blockId=pixy2_get_reconnect_count
+    //% parts="pixy2"
+    //% group="General"
+    int getReconnectCount()
+    {
+        return getPixy()->reconnects;
+    }
+
+    /**
+     * setProgramRate() sets how often a program (0 color connected components, 1 line, 2 video) should get its turn. Every program change keeps Pixy2 busy for a while, so once a rate is set, requests are grouped into time slices per program: a request for another program than the one Pixy2 runs waits until the current slice is over (or returns null/busy if it doesn't wait), then the program furthest behind its rate gets the next slice. The slices are sized so that about a quarter of the time goes to changing programs and the rest is shared between the programs in use in proportion to their rates (1 for programs without one). Setting all rates to 0 (default) changes the program for every request straight away.
+     * @param program The program, 0 color connected components, 1 line, 2 video.
+     * @param hz How many requests of the program should be served per second, 0 for no target.
+     * @returns It returns 0, or an error value (<0) if the program is invalid.
+     */
+    //% help=pixy2/set-program-rate
+    //% weight=63 blockGap=8
+    //% block="set program %program rate %hz Hz"
+    //% blockId=pixy2_set_program_rate
+    //% parts="pixy2"
+    //% group="General"
+    int8_t setProgramRate(int program, int hz)
     {
-        String resolution = changeProg(mkString("line"));
-        if (resolution == NULL)
+        if (program < 0 || program >= PIXY_PROGS)
         {
-            return -1;
+            return PIXY_RESULT_ERROR;
         }
-        return getPixy()->line.setDefaultTurn(angle);
+        getPixy()->scheduler.targets[program] = hz < 0 ? 0 : (hz > 1000 ? 1000 : hz);
+        return PIXY_RESULT_OK;
     }
 
     /**
-     * If the LINE_MODE_MANUAL_SELECT_VECTOR mode bit is set, the line tracking algorithm will no longer choose the Vector automatically. Instead, lineSetVector() will set the Vector by providing the index of the line.
-     * @param index The index of the line to set as the Vector.
-     * @returns It returns 0 if it succeeds, otherwise it returns -1.
+     * getProgramChangeStats() gets how much time went to changing programs since clearProgramChangeStats().
+     * @returns It returns the number of program changes, the time they took (ms), that time as a percentage of the time since the statistics were cleared, the time requests waited for their slice (ms), the number of requests turned away because they didn't wait, and the current slice length (ms) as a comma separated string (in that order).
      */
-    //% help=pixy2/set-vector
-    //% weight=85 blockGap=8
-    //% block="set vector %index"
-    //% blockId=pixy2_set_vector
+    //% help=pixy2/get-program-change-stats
+    //% weight=62 blockGap=8
+    //% block="get program change stats"
+    //% blockId=pixy2_get_program_change_stats
     //% parts="pixy2"
-    //% group="Line Tracking"
-    int8_t lineSetVector(uint8_t index)
+    //% group="General"
+    String getProgramChangeStats()
+    {
+        Pixy2Scheduler *scheduler = &getPixy()->scheduler;
+        uint32_t elapsed = current_time_ms() - scheduler->statsStart;
+        int percent = elapsed ? (uint64_t)scheduler->changeMs * 100 / elapsed : 0;
+
+        ManagedString res = ManagedString((int)scheduler->changes) + COMMA + ManagedString((int)scheduler->changeMs) + COMMA +
+                            ManagedString(percent) + COMMA + ManagedString((int)scheduler->waitMs) + COMMA +
+                            ManagedString((int)scheduler->busy) + COMMA + ManagedString((int)scheduler->slice(current_time_ms()));
+        return PSTR(res);
+    }
+
+    /**
+     * clearProgramChangeStats() starts the statistics of getProgramChangeStats() over.
+     */
+    //% help=pixy2/clear-program-change-stats
+    //% weight=61 blockGap=8
+    //% block="clear program change stats"
+    //% blockId=pixy2_clear_program_change_stats
+    //% parts="pixy2"
+    //% group="General"
+    void clearProgramChangeStats()
     {
-        String resolution = changeProg(mkString("line"));
-        if (resolution == NULL)
+        getPixy()->scheduler.clearStats();
+    }
+
+    /**
+     * setI2CFrequency() sets the I2C bus frequency. Pixy2 supports up to 400000 Hz; see probeLink() to find the fastest that works with your wiring.
+     * @param hz The frequency in Hz, e.g. 100000, 250000 or 400000.
+     */
+    //% help=pixy2/set-i2c-frequency
+    //% weight=71 blockGap=8
+    //% block="set i2c frequency %hz"
+    //% blockId=pixy2_set_i2c_frequency
+    //% parts="pixy2"
+    //% group="General"
+    void setI2CFrequency(int hz)
+    {
+        Link2I2C *link = getLink();
+        link->frequency = hz < 0 ? 0 : hz;
+        link->configure();
+    }
+
+    /**
+     * setI2CMaxWrite() sets how many bytes of a request are written to Pixy2 at a time. Only changing the program takes requests of more than 16 bytes.
+     * @param bytes The number of bytes, 1 to 255. Default is 16.
+     */
+    //% help=pixy2/set-i2c-max-write
+    //% weight=70 blockGap=8
+    //% block="set i2c max write %bytes"
+    //% blockId=pixy2_set_i2c_max_write
+    //% parts="pixy2"
+    //% group="General"
+    void setI2CMaxWrite(int bytes)
+    {
+        getLink()->maxSend = bytes < 1 ? 1 : (bytes > 255 ? 255 : bytes);
+    }
+
+    /**
+     * setI2CRepeatedStart() sets whether the response of Pixy2 is read with a repeated start right after the request, without releasing the bus in between.
+     * @param on True to use a repeated start, false (default) for a separate write and read.
+     */
+    //% help=pixy2/set-i2c-repeated-start
+    //% weight=69 blockGap=8
+    //% block="set i2c repeated start %on"
+    //% blockId=pixy2_set_i2c_repeated_start
+    //% parts="pixy2"
+    //% group="General"
+    void setI2CRepeatedStart(bool on)
+    {
+        getLink()->repeatedStart = on;
+    }
+
+    // Time PIXY_I2C_PROBE_ROUNDS version and resolution requests with the current bus
+    // settings, returns the time in us or -1 if any of them failed or came back different
+    int32_t timeProbeRounds(uint16_t hardware, uint16_t width, uint16_t height)
+    {
+        Pixy2I2C *p = getPixy();
+        uint32_t t0;
+        uint8_t i;
+
+        t0 = system_timer_current_time_us();
+        for (i = 0; i < PIXY_I2C_PROBE_ROUNDS; i++)
         {
-            return -1;
+            if (p->getVersion() < 0 || p->version->hardware != hardware)
+                return -1;
+            if (p->getResolution() < 0 || p->frameWidth != width || p->frameHeight != height)
+                return -1;
         }
-        return getPixy()->line.setVector(index);
+        return system_timer_current_time_us() - t0;
     }
 
     /**
-     * The Vector has a direction. It normally points up, from the bottom of the camera frame to the top of the camera frame for a forward-moving robot. Calling lineReverseVector() will invert the vector. This will typically cause your robot to back-up and change directions.
-     * @returns It returns 0 if it succeeds, otherwise it returns -1.
+     * probeLink() tries the I2C bus at 100, 250 and 400 kHz, with and without repeated start, and keeps the fastest setting under which a series of requests to Pixy2 all come back intact. Requests aren't retried while probing, so a setting that only works with retries is rejected. Each setting is timed over 10 pairs of requests.
+     * @returns It returns the chosen frequency in Hz, or -1 if Pixy2 doesn't respond and the settings are left as they were.
      */
-    //% help=pixy2/reverse-vector
-    //% weight=84 blockGap=8
-    //% block="reverse vector"
-    //% blockId=pixy2_reverse_vector
+    //% help=pixy2/probe-link
+    //% weight=68 blockGap=8
+    //% block="probe link"
+    //% blockId=pixy2_probe_link
     //% parts="pixy2"
-    //% group="Line Tracking"
-    int8_t lineReverseVector()
+    //% group="General"
+    int probeLink()
     {
-        String resolution = changeProg(mkString("line"));
-        if (resolution == NULL)
-        {
+        static const uint32_t frequencies[] = {100000, 250000, 400000};
+        Pixy2I2C *p = getPixy();
+        Link2I2C *link = getLink();
+        uint32_t oldFrequency, bestFrequency;
+        bool oldRepeatedStart, bestRepeatedStart;
+        uint16_t hardware, width, height;
+        uint8_t oldRetries, f, r;
+        int32_t t, best;
+
+        // 0 leaves the bus as the runtime set it up, which configure() can't go back to
+        oldFrequency = link->frequency ? link->frequency : PIXY_I2C_RUNTIME_FREQUENCY;
+        oldRepeatedStart = link->repeatedStart;
+        oldRetries = p->retries;
+
+        // the reference answers, with the settings as they are
+        if (p->getVersion() < 0)
+            return -1;
+        hardware = p->version->hardware;
+        if (p->getResolution() < 0)
             return -1;
+        width = p->frameWidth;
+        height = p->frameHeight;
+
+        // every setting gets a fair try, without the faults of the one before it leading to a reconnect
+        p->retries = 0;
+        p->probing = true;
+        best = -1;
+        bestFrequency = oldFrequency;
+        bestRepeatedStart = oldRepeatedStart;
+        for (f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); f++)
+        {
+            for (r = 0; r < 2; r++)
+            {
+                link->frequency = frequencies[f];
+                link->repeatedStart = r;
+                link->configure();
+                t = timeProbeRounds(hardware, width, height);
+                if (t >= 0 && (best < 0 || t < best))
+                {
+                    best = t;
+                    bestFrequency = frequencies[f];
+                    bestRepeatedStart = r;
+                }
+            }
         }
-        return getPixy()->line.reverseVector();
+
+        link->frequency = bestFrequency;
+        link->repeatedStart = bestRepeatedStart;
+        link->configure();
+        p->retries = oldRetries;
+        p->probing = false;
+        // a good request on the restored setting clears any faults from before the probe
+        p->getVersion();
+        return best < 0 ? -1 : (int)bestFrequency;
     }
 
-    // --------------- Video APIs ---------------
+    /**
+     * startSpans() starts timing every phase of the requests to Pixy2 (building and sending the request, waiting for and receiving the response, parsing it and turning it into the result of the block) into a ring of the most recent spans, see getSpansAsText(). The spans kept so far are dropped.
+     * @returns It returns 0, or an error value (<0) if span tracing isn't compiled in (PIXY2_ENABLE_SPANS).
+     */
+    //% help=pixy2/start-spans
+    //% weight=67 blockGap=8
+    //% block="start spans"
+    //% blockId=pixy2_start_spans
+    //% parts="pixy2"
+    //% group="General"
+    int startSpans()
+    {
+#if PIXY2_ENABLE_SPANS
+        getPixy()->spans.clear();
+        getPixy()->spans.running = true;
+        return PIXY_RESULT_OK;
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
 
     /**
-     * Internal use only. This function will be used in pixy2.ts to return the RGB values as an object
+     * stopSpans() stops timing requests, the spans kept so far can still be read.
+     */
+    //% help=pixy2/stop-spans
+    //% weight=66 blockGap=8
+    //% block="stop spans"
+    //% blockId=pixy2_stop_spans
+    //% parts="pixy2"
+    //% group="General"
+    void stopSpans()
+    {
+#if PIXY2_ENABLE_SPANS
+        getPixy()->spans.running = false;
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the last count spans, oldest first, as a buffer of packed Span records (12 bytes each: start and duration in us as UInt32LE, then phase, tag, depth and a reserved byte).
      */
     //%
-    String videoGetRGBAsString(uint16_t x, uint16_t y, bool saturate = true)
+    Buffer getSpans(int count)
     {
-        String resolution = changeProg(mkString("video"));
-        if (resolution == NULL)
+#if PIXY2_ENABLE_SPANS
+        Pixy2Spans *spans = &getPixy()->spans;
+        uint16_t n, i;
+
+        n = spans->count();
+        if (count >= 0 && count < n)
+            n = count;
+        Buffer buf = pxt::mkBuffer(NULL, n * sizeof(Span));
+        for (i = 0; i < n; i++)
+            memcpy(buf->data + i * sizeof(Span), spans->get(n, i), sizeof(Span));
+        return buf;
+#else
+        return pxt::mkBuffer(NULL, 0);
+#endif
+    }
+
+    /**
+     * getSpansAsText() gets the last spans, oldest first, one per line: the phase, the request type, the nesting depth, the start and the duration in microseconds (-1 if the span hasn't ended). The shim span ends when its result is handed to the program.
+     * @param count The number of spans, e.g. 16.
+     * @returns It returns the spans as text, or an empty string if there are none.
+     */
+    //% help=pixy2/get-spans-as-text
+    //% weight=65 blockGap=8
+    //% block="get spans as text %count"
+    //% blockId=pixy2_get_spans_as_text
+    //% parts="pixy2"
+    //% group="General"
+    String getSpansAsText(int count)
+    {
+#if PIXY2_ENABLE_SPANS
+        Pixy2Spans *spans = &getPixy()->spans;
+        const Span *span;
+        uint16_t n, i;
+
+        n = spans->count();
+        if (count >= 0 && count < n)
+            n = count;
+        ManagedString text;
+        for (i = 0; i < n; i++)
+        {
+            span = spans->get(n, i);
+            text = text + Pixy2Spans::phaseName(span->m_phase) + " " + ManagedString((int)span->m_tag) + " " + ManagedString((int)span->m_depth) + " " + ManagedString((int)span->m_start) + " " + ManagedString(span->m_duration == PIXY_SPAN_OPEN ? -1 : (int)span->m_duration) + "\n";
+        }
+        return PSTR(text);
+#else
+        return PSTR(ManagedString());
+#endif
+    }
+
+#if PIXY2_ENABLE_CCC
+    // Time PIXY_GEOMETRY_BENCH_ROUNDS frames of all four geometry kernels, returns us per frame
+    uint32_t timeGeometry(bool packed, const Block *blocks, uint8_t n)
+    {
+        uint32_t areas[PIXY_GEOMETRY_BENCH_MAX_BLOCKS], dist2[PIXY_GEOMETRY_BENCH_MAX_BLOCKS], mask[1];
+        uint16_t iou[PIXY_GEOMETRY_BENCH_MAX_BLOCKS];
+        volatile uint32_t sink = 0;
+        uint32_t t0;
+        uint8_t r;
+
+        t0 = system_timer_current_time_us();
+        for (r = 0; r < PIXY_GEOMETRY_BENCH_ROUNDS; r++)
+        {
+            if (packed)
+            {
+                pixyBlockAreasPacked(blocks, n, areas);
+                pixyBlockDistancesPacked(blocks, n, 158, 104, dist2);
+                pixyBlockIoUsPacked(blocks, n, 158, 104, 80, 60, iou);
+                pixyBlockInRegionPacked(blocks, n, 40, 30, 275, 177, mask);
+            }
+            else
+            {
+                pixyBlockAreasScalar(blocks, n, areas);
+                pixyBlockDistancesScalar(blocks, n, 158, 104, dist2);
+                pixyBlockIoUsScalar(blocks, n, 158, 104, 80, 60, iou);
+                pixyBlockInRegionScalar(blocks, n, 40, 30, 275, 177, mask);
+            }
+            // keep the results alive
+            sink = sink + areas[r % n] + dist2[r % n] + iou[r % n] + mask[0];
+        }
+        return (system_timer_current_time_us() - t0) / PIXY_GEOMETRY_BENCH_ROUNDS;
+    }
+#endif
+
+    /**
+     * benchmarkBlockGeometry() times the block geometry of cccGetBlockGeometry() on a made-up frame of blocks, once with the packed 16-bit DSP instructions and once in plain C. The DSP instructions are only there on the micro:bit v2, on the micro:bit v1 the packed version is emulated and slower.
+     * @param blocks The number of blocks in the frame, 1 to 32, e.g. 32.
+     * @returns It returns the time per frame in microseconds of the packed and the plain version, as "packed,plain".
+     */
+    //% help=pixy2/benchmark-block-geometry
+    //% weight=64 blockGap=8
+    //% block="benchmark block geometry %blocks"
+    //% blockId=pixy2_benchmark_block_geometry
+    //% parts="pixy2"
+    //% group="General"
+    String benchmarkBlockGeometry(int blocks)
+    {
+#if PIXY2_ENABLE_CCC
+        Block frame[PIXY_GEOMETRY_BENCH_MAX_BLOCKS];
+        uint32_t seed, packed, plain;
+        uint8_t i, n;
+
+        n = blocks < 1 ? 1 : (blocks > PIXY_GEOMETRY_BENCH_MAX_BLOCKS ? PIXY_GEOMETRY_BENCH_MAX_BLOCKS : blocks);
+        for (i = 0, seed = 1; i < n; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            frame[i].m_signature = 1 + (seed >> 8) % 7;
+            frame[i].m_x = (seed >> 12) % 316;
+            frame[i].m_y = (seed >> 4) % 208;
+            frame[i].m_width = 1 + (seed >> 20) % 120;
+            frame[i].m_height = 1 + (seed >> 24) % 100;
+            frame[i].m_angle = 0;
+            frame[i].m_index = i;
+            frame[i].m_age = 0;
+        }
+        packed = timeGeometry(true, frame, n);
+        plain = timeGeometry(false, frame, n);
+        ManagedString res = ManagedString((int)packed) + COMMA + ManagedString((int)plain);
+        return PSTR(res);
+#else
+        return NULL;
+#endif
+    }
+
+    bool monitorFiberRunning = false;
+
+    // Acquisition fiber, fetches frames in the monitor's program and raises their events
+    void monitorFiber()
+    {
+        Pixy2Monitor *monitor = &getPixy()->monitor;
+        uint8_t mode = PIXY_MONITOR_OFF;
+        int8_t res;
+
+        while (monitor->mode != PIXY_MONITOR_OFF)
+        {
+            if (monitor->mode != mode)
+            {
+                mode = monitor->mode;
+                monitor->reset();
+            }
+            // the program is shared with the other requests, this one doesn't wait for its slice
+            res = getPixy()->useProg(mode == PIXY_MONITOR_CCC ? PIXY_PROG_CCC : PIXY_PROG_LINE, false);
+            if (res < 0 && res != PIXY_RESULT_BUSY)
+            {
+                fiber_sleep(PIXY_MONITOR_RETRY_MS);
+                continue;
+            }
+            if (res == PIXY_RESULT_OK)
+            {
+                getPixy()->monitorFrame();
+            }
+            fiber_sleep(PIXY_MONITOR_POLL_MS);
+        }
+        monitorFiberRunning = false;
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to start the acquisition fiber that raises the detection events, mode 1 watches color connected components and mode 2 line features.
+     */
+    //%
+    void startEvents(uint8_t mode)
+    {
+        if (!(mode == PIXY_MONITOR_CCC && PIXY2_ENABLE_CCC) && !(mode == PIXY_MONITOR_LINE && PIXY2_ENABLE_LINE))
+        {
+            return;
+        }
+        getPixy()->monitor.mode = mode;
+        if (!monitorFiberRunning)
+        {
+            monitorFiberRunning = true;
+            create_fiber(monitorFiber);
+        }
+    }
+
+    /**
+     * stopEvents() stops watching for the detections that raise the on signature appeared/disappeared, on intersection, on barcode seen and on vector lost events. Registering a handler for one of them starts watching again.
+     */
+    //% help=pixy2/stop-events
+    //% weight=87 blockGap=8
+    //% block="stop events"
+    //% blockId=pixy2_stop_events
+    //% parts="pixy2"
+    //% group="General"
+    void stopEvents()
+    {
+        getPixy()->monitor.mode = PIXY_MONITOR_OFF;
+    }
+
+    /**
+     * setEventHoldFrames() sets for how many frames in a row a signature or the line vector has to be missing before it counts as gone (disappeared or lost). Higher values ignore flickering detections but report real losses later.
+     * @param frames The number of frames, 1 or more. Default is 3.
+     */
+    //% help=pixy2/set-event-hold-frames
+    //% weight=86 blockGap=8
+    //% block="set event hold frames %frames"
+    //% blockId=pixy2_set_event_hold_frames
+    //% parts="pixy2"
+    //% group="General"
+    void setEventHoldFrames(int frames)
+    {
+        getPixy()->monitor.holdFrames = frames < 1 ? 1 : (frames > 255 ? 255 : frames);
+    }
+
+    bool exposureFiberRunning = false;
+
+    void exposureFiber()
+    {
+        Pixy2AutoExposure *exposure = &getPixy()->exposure;
+
+        while (exposure->running)
+        {
+            getPixy()->serviceExposure();
+            fiber_sleep(exposure->period);
+        }
+        exposureFiberRunning = false;
+    }
+
+    /**
+     * startAutoExposure() starts adjusting the camera brightness in the background: it is lowered whenever the frame rate drops below the target, and raised again slowly while the frame rate has headroom. The frame rate is read every half second.
+     * @param targetFps The lowest acceptable frame rate, e.g. 50.
+     */
+    //% help=pixy2/start-auto-exposure
+    //% weight=85 blockGap=8
+    //% block="start auto exposure target fps %targetFps"
+    //% blockId=pixy2_start_auto_exposure
+    //% parts="pixy2"
+    //% group="General"
+    void startAutoExposure(int targetFps)
+    {
+        Pixy2I2C *p = getPixy();
+        p->exposure.targetFps = targetFps < 1 ? 1 : (targetFps > 62 ? 62 : targetFps);
+        // carry on from the brightness last set, if any
+        p->exposure.reset(p->shadow.known & PIXY_SHADOW_BRIGHTNESS ? p->shadow.value(PIXY_SHADOW_BRIGHTNESS) : PIXY_EXPOSURE_DEFAULT_BRIGHTNESS);
+        p->exposure.running = true;
+        if (!exposureFiberRunning)
+        {
+            exposureFiberRunning = true;
+            create_fiber(exposureFiber);
+        }
+    }
+
+    /**
+     * stopAutoExposure() stops the brightness control started with startAutoExposure(). The brightness stays where it is.
+     */
+    //% help=pixy2/stop-auto-exposure
+    //% weight=84 blockGap=8
+    //% block="stop auto exposure"
+    //% blockId=pixy2_stop_auto_exposure
+    //% parts="pixy2"
+    //% group="General"
+    void stopAutoExposure()
+    {
+        getPixy()->exposure.running = false;
+    }
+
+    /**
+     * setAutoExposureLuma() makes the auto exposure also keep the image brightness near a target, measured with a few getRGB samples. getRGB is a video program function, so the samples are only taken while Pixy2 runs the video program for other requests; other programs aren't interrupted for them, and meanwhile only the frame rate is used.
+     * @param target The target luminance, 1 to 255, or 0 (default) to only use the frame rate.
+     */
+    //% help=pixy2/set-auto-exposure-luma
+    //% weight=83 blockGap=8
+    //% block="set auto exposure luma %target"
+    //% blockId=pixy2_set_auto_exposure_luma
+    //% parts="pixy2"
+    //% group="General"
+    void setAutoExposureLuma(int target)
+    {
+        getPixy()->exposure.lumaTarget = target < 0 ? 0 : (target > 255 ? 255 : target);
+    }
+
+    /**
+     * getAutoExposureBrightness() gets the camera brightness chosen by the auto exposure.
+     * @returns It returns the current brightness setting.
+     */
+    //% help=pixy2/get-auto-exposure-brightness
+    //% weight=82 blockGap=8
+    //% block="get auto exposure brightness"
+    //% blockId=pixy2_get_auto_exposure_brightness
+    //% parts="pixy2"
+    //% group="General"
+    int getAutoExposureBrightness()
+    {
+        return getPixy()->exposure.brightness;
+    }
+
+    // ------------------------ Color Connected Components APIs ------------------------
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the blocks of color connected components as a string.
+     */
+    //%
+    String cccGetBlocksAsString(bool wait, uint8_t sigmap, uint8_t maxBlocks)
+    {
+#if PIXY2_ENABLE_CCC
+        if (getPixy()->useProg(PIXY_PROG_CCC, wait) < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, CCC_REQUEST_BLOCKS);
+        int8_t result = getPixy()->ccc.getBlocks(wait, sigmap, maxBlocks);
+        if (result < 0)
+        {
+            return NULL;
+        }
+        Block *blocks = getPixy()->ccc.blocks;
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_MARSHAL, CCC_REQUEST_BLOCKS);
+        ManagedString blocksString;
+        for (int i = 0; i < result; i++)
+        {
+            ManagedString blockString = ManagedString(blocks[i].m_signature) + COMMA + ManagedString(blocks[i].m_x) + COMMA + ManagedString(blocks[i].m_y) + COMMA + ManagedString(blocks[i].m_width) + COMMA + ManagedString(blocks[i].m_height) + COMMA + ManagedString(blocks[i].m_angle) + COMMA + ManagedString(blocks[i].m_index) + COMMA + ManagedString(blocks[i].m_age);
+            if (i != result - 1)
+                blockString = blockString + SEMICOLON;
+            blocksString = blocksString + blockString;
+        }
+        return PSTR(blocksString);
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the decoded color codes of the most recent frame as a buffer of packed ColorCode records.
+     */
+    //%
+    Buffer cccGetColorCodesAsBuffer(bool wait, uint8_t maxBlocks)
+    {
+#if PIXY2_ENABLE_CCC
+        if (getPixy()->useProg(PIXY_PROG_CCC, wait) < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, CCC_REQUEST_BLOCKS);
+        int8_t result = getPixy()->ccc.getColorCodes(wait, maxBlocks);
+        if (result < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_MARSHAL, CCC_REQUEST_BLOCKS);
+        return pxt::mkBuffer((uint8_t *)getPixy()->ccc.codes.codes, result * sizeof(ColorCode));
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the blocks of the most recent frame with their geometry against a reference box as a buffer of packed records: the Block, the area and the squared distance of its center to the center of the box (UInt32LE), the intersection over union with the box in Q14 (UInt16LE), 1 if its center is inside the box, and a reserved byte.
+     */
+    //%
+    Buffer cccGetBlockGeometryAsBuffer(bool wait, uint8_t sigmap, uint8_t maxBlocks, int x, int y, int width, int height)
+    {
+#if PIXY2_ENABLE_CCC
+        uint32_t areas[PIXY_GEOMETRY_CHUNK], dist2[PIXY_GEOMETRY_CHUNK], mask[1];
+        uint16_t iou[PIXY_GEOMETRY_CHUNK];
+        int16_t left, top;
+        uint8_t i, j, n, *p;
+
+        if (getPixy()->useProg(PIXY_PROG_CCC, wait) < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, CCC_REQUEST_BLOCKS);
+        int8_t result = getPixy()->ccc.getBlocks(wait, sigmap, maxBlocks);
+        if (result < 0)
+        {
+            return NULL;
+        }
+        Block *blocks = getPixy()->ccc.blocks;
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_MARSHAL, CCC_REQUEST_BLOCKS);
+        x = pixyClampCoord(x);
+        y = pixyClampCoord(y);
+        width = width < 0 ? 0 : (width > 2 * PIXY_GEOMETRY_COORD_LIMIT ? 2 * PIXY_GEOMETRY_COORD_LIMIT : width);
+        height = height < 0 ? 0 : (height > 2 * PIXY_GEOMETRY_COORD_LIMIT ? 2 * PIXY_GEOMETRY_COORD_LIMIT : height);
+        left = x - (width >> 1);
+        top = y - (height >> 1);
+
+        Buffer buf = pxt::mkBuffer(NULL, result * PIXY_GEOMETRY_RECORD_SIZE);
+        p = buf->data;
+        for (i = 0; i < result; i += n)
+        {
+            n = result - i < PIXY_GEOMETRY_CHUNK ? result - i : PIXY_GEOMETRY_CHUNK;
+            pixyBlockAreas(blocks + i, n, areas);
+            pixyBlockDistances(blocks + i, n, x, y, dist2);
+            pixyBlockIoUs(blocks + i, n, x, y, width, height, iou);
+            pixyBlockInRegion(blocks + i, n, left, top, left + width - 1, top + height - 1, mask);
+            for (j = 0; j < n; j++, p += PIXY_GEOMETRY_RECORD_SIZE)
+            {
+                memcpy(p, &blocks[i + j], sizeof(Block));
+                memcpy(p + sizeof(Block), &areas[j], 4);
+                memcpy(p + sizeof(Block) + 4, &dist2[j], 4);
+                memcpy(p + sizeof(Block) + 8, &iou[j], 2);
+                p[sizeof(Block) + 10] = (mask[0] >> j) & 1;
+                p[sizeof(Block) + 11] = 0;
+            }
+        }
+        return buf;
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * cccStartHeatmap() starts keeping track of where in the frame each signature shows up, in a grid of 12 x 8 cells per signature (color codes share one grid). Every frame of blocks fetched adds to it, older frames fade out. The heatmap is cleared.
+     * @param frames How many frames the heatmap remembers, the time constant of the fade, rounded to a power of two between 2 and 4096, e.g. 256.
+     * @returns It returns 0, or an error value (<0) if the heatmap isn't compiled in (PIXY2_ENABLE_HEATMAP).
+     */
+    //% help=pixy2/ccc-start-heatmap
+    //% weight=70 blockGap=8
+    //% block="ccc start heatmap remembering %frames frames"
+    //% blockId=pixy2_ccc_start_heatmap
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    int cccStartHeatmap(int frames)
+    {
+#if PIXY2_ENABLE_CCC && PIXY2_ENABLE_HEATMAP
+        Pixy2Heatmap *heatmap = &getPixy()->ccc.heatmap;
+        uint8_t shift;
+
+        for (shift = CCC_HEATMAP_MIN_SHIFT; shift < CCC_HEATMAP_MAX_SHIFT && (1 << shift) + (1 << (shift - 1)) <= frames; shift++)
+            ;
+        heatmap->setShift(shift);
+        heatmap->running = true;
+        return PIXY_RESULT_OK;
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+    /**
+     * cccStopHeatmap() stops adding frames to the heatmap, it can still be read.
+     */
+    //% help=pixy2/ccc-stop-heatmap
+    //% weight=69 blockGap=8
+    //% block="ccc stop heatmap"
+    //% blockId=pixy2_ccc_stop_heatmap
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    void cccStopHeatmap()
+    {
+#if PIXY2_ENABLE_CCC && PIXY2_ENABLE_HEATMAP
+        getPixy()->ccc.heatmap.running = false;
+#endif
+    }
+
+    /**
+     * cccResetHeatmap() clears the heatmap, it keeps running if it was.
+     */
+    //% help=pixy2/ccc-reset-heatmap
+    //% weight=68 blockGap=8
+    //% block="ccc reset heatmap"
+    //% blockId=pixy2_ccc_reset_heatmap
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    void cccResetHeatmap()
+    {
+#if PIXY2_ENABLE_CCC && PIXY2_ENABLE_HEATMAP
+        getPixy()->ccc.heatmap.reset();
+#endif
+    }
+
+    /**
+     * cccGetHeatmap() gets the heatmap of a signature: the number of columns, the number of rows, then a byte per cell, row by row from the top left. A cell is 255 if a block of the signature was in it in every frame (or more than one block on average), less the less often it was.
+     * @param signature The signature, 1 to 7, or 8 for the color codes.
+     * @param normalize [Optional] Scale the cells so that the hottest one is 255, default false.
+     * @returns It returns the heatmap as a buffer, empty if the signature is invalid or the heatmap isn't compiled in.
+     */
+    //% help=pixy2/ccc-get-heatmap
+    //% weight=67 blockGap=8
+    //% block="ccc get heatmap of signature %signature"
+    //% blockId=pixy2_ccc_get_heatmap
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    Buffer cccGetHeatmap(int signature, bool normalize = false)
+    {
+#if PIXY2_ENABLE_CCC && PIXY2_ENABLE_HEATMAP
+        Pixy2Heatmap *heatmap = &getPixy()->ccc.heatmap;
+        uint32_t v, max;
+        uint16_t i;
+        uint8_t layer;
+
+        if (signature < 1 || signature > CCC_HEATMAP_LAYERS)
+        {
+            return pxt::mkBuffer(NULL, 0);
+        }
+        layer = signature - 1;
+        max = CCC_HEATMAP_ONE;
+        if (normalize)
+        {
+            for (i = 0, max = 1; i < CCC_HEATMAP_CELLS; i++)
+            {
+                v = heatmap->occupancy(layer, i);
+                max = v > max ? v : max;
+            }
+        }
+        Buffer buf = pxt::mkBuffer(NULL, 2 + CCC_HEATMAP_CELLS);
+        buf->data[0] = PIXY2_HEATMAP_COLS;
+        buf->data[1] = PIXY2_HEATMAP_ROWS;
+        for (i = 0; i < CCC_HEATMAP_CELLS; i++)
+        {
+            v = heatmap->occupancy(layer, i) * 255 / max;
+            buf->data[2 + i] = v > 255 ? 255 : v;
+        }
+        return buf;
+#else
+        return pxt::mkBuffer(NULL, 0);
+#endif
+    }
+
+    /**
+     * cccRegisterColorCode() adds a color code to the set that cccGetColorCodes() matches each decoded color code against. Up to 8 codes can be registered.
+     * @param code The color code written as its digits, for example 123 for the color code made of signatures 1, 2 and 3.
+     * @returns It returns the index of the code in the registered set (this is the m_match value reported for it), or an error value (<0) if the code is invalid or the set is full.
+     */
+    //% help=pixy2/ccc-register-color-code
+    //% weight=80 blockGap=8
+    //% block="ccc register color code %code"
+    //% blockId=pixy2_ccc_register_color_code
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    int8_t cccRegisterColorCode(int code)
+    {
+#if PIXY2_ENABLE_CCC
+        return getPixy()->ccc.codes.registerCode(Pixy2ColorCodes::encodeDigits(code));
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+    /**
+     * cccClearColorCodes() removes all registered color codes.
+     */
+    //% help=pixy2/ccc-clear-color-codes
+    //% weight=79 blockGap=8
+    //% block="ccc clear color codes"
+    //% blockId=pixy2_ccc_clear_color_codes
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    void cccClearColorCodes()
+    {
+#if PIXY2_ENABLE_CCC
+        getPixy()->ccc.codes.clearCodes();
+#endif
+    }
+
+    /**
+     * cccRetarget() makes the tracker drop the block it follows and pick the largest block of a signature instead.
+     * @param signature The signature to track, 1 to 7, or a color code written as its digits (e.g. 123). 0 tracks the largest block of any signature.
+     * @returns It returns 0 (PIXY_RESULT_OK) if it succeeds, or -1 (PIXY_RESULT_ERROR) if the signature is invalid.
+     */
+    //% help=pixy2/ccc-retarget
+    //% weight=76 blockGap=8
+    //% block="ccc retarget signature %signature"
+    //% blockId=pixy2_ccc_retarget
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    int8_t cccRetarget(int signature)
+    {
+#if PIXY2_ENABLE_CCC
+        uint16_t sig = Pixy2ColorCodes::encodeDigits(signature < 0 ? 0 : signature);
+        if (sig == 0 && signature != 0)
+        {
+            return PIXY_RESULT_ERROR;
+        }
+        getPixy()->ccc.panTilt.retarget(sig);
+        return PIXY_RESULT_OK;
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+#if PIXY2_ENABLE_CCC
+    bool trackerFiberRunning = false;
+
+    // Runs the pan-tilt tracker at the camera frame rate until cccStopTracking()
+    void trackerFiber()
+    {
+        Pixy2PanTilt *panTilt = &getPixy()->ccc.panTilt;
+
+        if (getPixy()->useProg(PIXY_PROG_CCC) < 0)
+            panTilt->status.m_flags &= ~CCC_PANTILT_FLAG_RUNNING;
+        while (panTilt->status.m_flags & CCC_PANTILT_FLAG_RUNNING)
+        {
+            // don't wait for the frame or the slice here, that would busy wait without yielding
+            if (getPixy()->useProg(PIXY_PROG_CCC, false) == PIXY_RESULT_OK)
+                getPixy()->ccc.trackPanTilt(false);
+            fiber_sleep(CCC_PANTILT_POLL_MS);
+        }
+        trackerFiberRunning = false;
+    }
+#endif
+
+    /**
+     * cccStartTracking() starts a background tracker that moves the pan-tilt servos (pan on servo 0, tilt on servo 1) to keep a block in the middle of the frame. It runs on its own at the camera frame rate, nothing has to be called in a loop.
+     * @param signature The signature to track, 1 to 7, or a color code written as its digits (e.g. 123). 0 tracks the largest block of any signature.
+     * @returns It returns 0 (PIXY_RESULT_OK) if it succeeds, or -1 (PIXY_RESULT_ERROR) if the signature is invalid.
+     */
+    //% help=pixy2/ccc-start-tracking
+    //% weight=78 blockGap=8
+    //% block="ccc start tracking signature %signature"
+    //% blockId=pixy2_ccc_start_tracking
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    int8_t cccStartTracking(int signature)
+    {
+#if PIXY2_ENABLE_CCC
+        if (cccRetarget(signature) < 0)
+        {
+            return PIXY_RESULT_ERROR;
+        }
+        getPixy()->ccc.panTilt.status.m_flags |= CCC_PANTILT_FLAG_RUNNING;
+        if (!trackerFiberRunning)
+        {
+            trackerFiberRunning = true;
+            create_fiber(trackerFiber);
+        }
+        return PIXY_RESULT_OK;
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+    /**
+     * cccStopTracking() stops the tracker started with cccStartTracking(). The servos stay where they are.
+     */
+    //% help=pixy2/ccc-stop-tracking
+    //% weight=77 blockGap=8
+    //% block="ccc stop tracking"
+    //% blockId=pixy2_ccc_stop_tracking
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    void cccStopTracking()
+    {
+#if PIXY2_ENABLE_CCC
+        getPixy()->ccc.panTilt.status.m_flags &= ~CCC_PANTILT_FLAG_RUNNING;
+#endif
+    }
+
+    /**
+     * cccSetTrackingGains() sets the gains of the tracker's servo loops. Each loop adds (p * error + d * change of error) / 1024 to the servo position every frame, with the error in pixels. The defaults are 400, 400 for pan and 500, 500 for tilt. Use negative gains if a servo is mounted the other way round.
+     * @param panP Proportional gain of the pan loop.
+     * @param panD Derivative gain of the pan loop.
+     * @param tiltP Proportional gain of the tilt loop.
+     * @param tiltD Derivative gain of the tilt loop.
+     */
+    //% help=pixy2/ccc-set-tracking-gains
+    //% weight=75 blockGap=8
+    //% block="ccc set tracking gains pan p %panP d %panD tilt p %tiltP d %tiltD"
+    //% blockId=pixy2_ccc_set_tracking_gains
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    void cccSetTrackingGains(int panP, int panD, int tiltP, int tiltD)
+    {
+#if PIXY2_ENABLE_CCC
+        Pixy2PanTilt *panTilt = &getPixy()->ccc.panTilt;
+        panTilt->panP = panP;
+        panTilt->panD = panD;
+        panTilt->tiltP = tiltP;
+        panTilt->tiltD = tiltD;
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the state of the tracker as an object
+     */
+    //%
+    Buffer cccGetTrackingStatusAsBuffer()
+    {
+#if PIXY2_ENABLE_CCC
+        return pxt::mkBuffer((uint8_t *)&getPixy()->ccc.panTilt.status, sizeof(PanTiltStatus));
+#else
+        return pxt::mkBuffer(NULL, 0);
+#endif
+    }
+
+    // ------------------------ Line Tracking APIs ------------------------
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the main features of line tracking as a string.
+     */
+    //%
+    String lineGetMainFeaturesAsString(uint8_t features = 0x07, bool wait = true)
+    {
+#if PIXY2_ENABLE_LINE
+        if (getPixy()->useProg(PIXY_PROG_LINE, wait) < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, LINE_REQUEST_GET_FEATURES);
+        int8_t result = getPixy()->line.getMainFeatures(features, wait);
+        if (result < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_BEGIN(getPixy()->spans, PIXY_SPAN_MARSHAL, LINE_REQUEST_GET_FEATURES);
+        String featuresString = convertFeaturesToString(features, result, getPixy()->line.vectors, getPixy()->line.intersections, getPixy()->line.barcodes);
+        PIXY_SPAN_END(getPixy()->spans);
+        getPixy()->line.flushEvents();
+        return featuresString;
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return all features of line tracking as a string.
+     */
+    //%
+    String lineGetAllFeaturesAsString(uint8_t features = 0x07, bool wait = true)
+    {
+#if PIXY2_ENABLE_LINE
+        if (getPixy()->useProg(PIXY_PROG_LINE, wait) < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, LINE_REQUEST_GET_FEATURES);
+        int8_t result = getPixy()->line.getAllFeatures(features, wait);
+        if (result < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_BEGIN(getPixy()->spans, PIXY_SPAN_MARSHAL, LINE_REQUEST_GET_FEATURES);
+        String featuresString = convertFeaturesToString(features, result, getPixy()->line.vectors, getPixy()->line.intersections, getPixy()->line.barcodes);
+        PIXY_SPAN_END(getPixy()->spans);
+        getPixy()->line.flushEvents();
+        return featuresString;
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the line features that were added, removed or moved since the previous call as a buffer of change records.
+     */
+    //%
+    Buffer lineGetFeatureChangesAsBuffer(uint8_t features = 0x07, bool wait = true)
+    {
+#if PIXY2_ENABLE_LINE
+        if (getPixy()->useProg(PIXY_PROG_LINE, wait) < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, LINE_REQUEST_GET_FEATURES);
+        int8_t result = getPixy()->line.getFeatureChanges(LINE_GET_ALL_FEATURES, features, wait);
+        if (result < 0)
+        {
+            return NULL;
+        }
+        Pixy2LineDelta *delta = &getPixy()->line.delta;
+        PIXY_SPAN_BEGIN(getPixy()->spans, PIXY_SPAN_MARSHAL, LINE_REQUEST_GET_FEATURES);
+        Buffer changes = pxt::mkBuffer(NULL, delta->serializedSize());
+        delta->serialize(changes->data);
+        PIXY_SPAN_END(getPixy()->spans);
+        delta->commit();
+        getPixy()->line.flushEvents();
+        return changes;
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * lineSetChangeThreshold() sets how far (in pixels) a line feature has to move before lineGetFeatureChanges() reports it as moved.
+     * @param threshold The movement threshold in pixels. The default is 2.
+     */
+    //% help=pixy2/line-set-change-threshold
+    //% weight=82 blockGap=8
+    //% block="line set change threshold %threshold"
+    //% blockId=pixy2_line_set_change_threshold
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    void lineSetChangeThreshold(uint8_t threshold)
+    {
+#if PIXY2_ENABLE_LINE
+        getPixy()->line.delta.threshold = threshold;
+#endif
+    }
+
+    /**
+     * lineResetChanges() forgets the previous frame, so that the next call to lineGetFeatureChanges() reports every feature as added.
+     */
+    //% help=pixy2/line-reset-changes
+    //% weight=81 blockGap=8
+    //% block="line reset changes"
+    //% blockId=pixy2_line_reset_changes
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    void lineResetChanges()
+    {
+#if PIXY2_ENABLE_LINE
+        getPixy()->line.delta.reset();
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the steering computed from the main vector as a buffer: heading error, offset error and output (int16 each), followed by a valid flag.
+     */
+    //%
+    Buffer lineGetSteeringAsBuffer(bool wait = true)
+    {
+#if PIXY2_ENABLE_LINE
+        if (getPixy()->useProg(PIXY_PROG_LINE, wait) < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, LINE_REQUEST_GET_FEATURES);
+        Pixy2LineSteering *steering = &getPixy()->line.steering;
+        int8_t result = getPixy()->line.getSteering(wait);
+        if (result < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_BEGIN(getPixy()->spans, PIXY_SPAN_MARSHAL, LINE_REQUEST_GET_FEATURES);
+        int16_t values[3] = {steering->headingError, steering->offsetError, steering->output};
+        Buffer buf = pxt::mkBuffer(NULL, sizeof(values) + 1);
+        memcpy(buf->data, values, sizeof(values));
+        buf->data[sizeof(values)] = result > 0;
+        PIXY_SPAN_END(getPixy()->spans);
+        getPixy()->line.flushEvents();
+        return buf;
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the estimate of the line ahead as a buffer holding a packed LineLookahead record.
+     */
+    //%
+    Buffer lineGetLookaheadAsBuffer(bool wait = true)
+    {
+#if PIXY2_ENABLE_LINE
+        LineLookahead est;
+
+        if (getPixy()->useProg(PIXY_PROG_LINE, wait) < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, LINE_REQUEST_GET_FEATURES);
+        int8_t result = getPixy()->line.getLookahead(&est, wait);
+        if (result < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_BEGIN(getPixy()->spans, PIXY_SPAN_MARSHAL, LINE_REQUEST_GET_FEATURES);
+        Buffer buf = pxt::mkBuffer((uint8_t *)&est, sizeof(est));
+        PIXY_SPAN_END(getPixy()->spans);
+        getPixy()->line.flushEvents();
+        return buf;
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * lineSetLookahead() sets how far ahead lineGetLookahead() predicts the line, and the speed of the robot it works out the curvature with.
+     * @param ms How far ahead to predict, in milliseconds, 0 to 2000. Default is 200.
+     * @param speed [Optional] The speed of the robot in mm/s, 0 (default) if it isn't known, the curvature is 0 then.
+     */
+    //% help=pixy2/line-set-lookahead
+    //% weight=66 blockGap=8
+    //% block="line set lookahead %ms ms speed %speed mm/s"
+    //% blockId=pixy2_line_set_lookahead
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    void lineSetLookahead(int ms, int speed = 0)
+    {
+#if PIXY2_ENABLE_LINE
+        Pixy2LineLookahead *lookahead = &getPixy()->line.lookahead;
+        lookahead->lookahead = ms < 0 ? 0 : (ms > LINE_LOOKAHEAD_MAX_MS ? LINE_LOOKAHEAD_MAX_MS : ms);
+        lookahead->speed = speed < 0 ? 0 : (speed > 0xffff ? 0xffff : speed);
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to set the steering PID gains, scaled by 256.
+     */
+    //%
+    void lineSetSteeringGainsQ8(int kp, int ki, int kd)
+    {
+#if PIXY2_ENABLE_LINE
+        Pixy2LineSteering *steering = &getPixy()->line.steering;
+        steering->kp = kp;
+        steering->ki = ki;
+        steering->kd = kd;
+        steering->reset();
+#endif
+    }
+
+    /**
+     * lineSetSteeringMix() sets how the steering error is made up from the offset of the line from the frame center and the heading of the line.
+     * @param headingPercent 0 (default) steers on the offset of the vector head only, 100 steers on the heading of the vector only, values in between blend the two.
+     */
+    //% help=pixy2/line-set-steering-mix
+    //% weight=79 blockGap=8
+    //% block="line set steering mix %headingPercent"
+    //% blockId=pixy2_line_set_steering_mix
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    void lineSetSteeringMix(uint8_t headingPercent)
+    {
+#if PIXY2_ENABLE_LINE
+        if (headingPercent > 100)
+            headingPercent = 100;
+        getPixy()->line.steering.mix = (uint16_t)headingPercent * LINE_STEER_MIX_ONE / 100;
+#endif
+    }
+
+    /**
+     * lineSetSteeringLimit() sets the largest motor differential the steering PID will output.
+     * @param limit The output is clamped to -limit..limit. The default is 255.
+     */
+    //% help=pixy2/line-set-steering-limit
+    //% weight=78 blockGap=8
+    //% block="line set steering limit %limit"
+    //% blockId=pixy2_line_set_steering_limit
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    void lineSetSteeringLimit(int16_t limit)
+    {
+#if PIXY2_ENABLE_LINE
+        getPixy()->line.steering.outputLimit = pixyClamp(limit < 0 ? -(int32_t)limit : limit, 0x7fff);
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the recent barcode sightings, oldest first, as a buffer of packed BarcodeSighting records.
+     */
+    //%
+    Buffer lineGetBarcodeHistoryAsBuffer()
+    {
+#if PIXY2_ENABLE_LINE
+        Pixy2BarcodeHistory *history = &getPixy()->line.barcodeHistory;
+        Buffer buf = pxt::mkBuffer(NULL, history->count * sizeof(BarcodeSighting));
+        history->copy((BarcodeSighting *)buf->data);
+        return buf;
+#else
+        return pxt::mkBuffer(NULL, 0);
+#endif
+    }
+
+    /**
+     * lineSetBarcodeVoting() sets how many times a barcode has to be seen before it is confirmed and the barcode event is raised. Barcodes are only seen repeatedly when features are fetched with getAllFeatures().
+     * @param votes The number of sightings needed, from 1 to 16. The default is 3.
+     * @param window The sightings have to happen within this many milliseconds. A confirmed barcode is confirmed again only after it has been out of sight for this long. The default is 500.
+     */
+    //% help=pixy2/line-set-barcode-voting
+    //% weight=74 blockGap=8
+    //% block="line set barcode voting %votes|within %window ms"
+    //% blockId=pixy2_line_set_barcode_voting
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    void lineSetBarcodeVoting(uint8_t votes, uint16_t window)
+    {
+#if PIXY2_ENABLE_LINE
+        Pixy2BarcodeHistory *history = &getPixy()->line.barcodeHistory;
+        // more votes than the history holds could never confirm
+        if (votes < 1)
+            votes = 1;
+        else if (votes > LINE_BARCODE_HISTORY_SIZE)
+            votes = LINE_BARCODE_HISTORY_SIZE;
+        history->votesRequired = votes;
+        history->window = window;
+#endif
+    }
+
+    /**
+     * lineClearBarcodeHistory() forgets all barcode sightings and confirmations.
+     */
+    //% help=pixy2/line-clear-barcode-history
+    //% weight=73 blockGap=8
+    //% block="line clear barcode history"
+    //% blockId=pixy2_line_clear_barcode_history
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    void lineClearBarcodeHistory()
+    {
+#if PIXY2_ENABLE_LINE
+        getPixy()->line.barcodeHistory.clear();
+#endif
+    }
+
+    /**
+     * lineSetMode() function sets various modes in the line tracking algorithm
+     * @param mode The mode argument consists of a bitwise-ORing of the following bits:
+        LINE_MODE_TURN_DELAYED
+            Normally, the line tracking algorithm will choose the straightest path (branch) when encountering an intersection. 2) Setting LINE_MODE_TURN_DELAYED will prevent the line tracking algorithm from choosing the path automatically. This is useful if your program doesn't know beforehand which path it wants to take at the next intersection.
+        LINE_MODE_MANUAL_SELECT_VECTOR
+            Normally, the line tracking algorithm will choose what it thinks is the best Vector line automatically. Setting LINE_MODE_MANUAL_SELECT_VECTOR will prevent the line tracking algorithm from choosing the Vector automatically. Instead, your program will need to set the Vector by calling setVector().
+        LINE_MODE_WHITE_LINE
+            Normally, the line tracking algorithm will try to find dark lines on a light background (black lines). Setting LINE_MODE_WHITE_LINE will instruct the line tracking algorithm to look for light lines on a dark background (white lines).
+     * @returns It returns 0 if it succeeds, otherwise it returns -1.
+     */
+    //% help=pixy2/set-line-mode
+    //% weight=88 blockGap=8
+    //% block="set line mode %mode"
+    //% blockId=pixy2_set_line_mode
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    int8_t lineSetMode(uint8_t mode)
+    {
+#if PIXY2_ENABLE_LINE
+        if (getPixy()->useProg(PIXY_PROG_LINE, true) < 0)
+        {
+            return -1;
+        }
+        return getPixy()->line.setMode(mode);
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+    /**
+     * lineSetNextTurn() function tells the line tracking algorithm which path it should take at the next intersection. lineSetNextTurn() will remember the turn angle you give it, and execute it at the next intersection. The line tracking algorithm will then go back to the default turn angle for subsequent intersections. Upon encountering an intersection, the line tracking algorithm will find the path in the intersection that matches the turn angle most closely.
+     * @param angle Turn angles are specified in degrees, with 0 being straight ahead, left being 90 and right being -90 (for example), although any valid angle value can be used. Valid angles are between -180 and 180.
+     * @returns It returns 0 if it succeeds, otherwise it returns -1.
+     */
+    //% help=pixy2/set-next-turn
+    //% weight=87 blockGap=8
+    //% block="set next turn %angle"
+    //% blockId=pixy2_set_next_turn
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    int8_t lineSetNextTurn(int16_t angle)
+    {
+#if PIXY2_ENABLE_LINE
+        if (getPixy()->useProg(PIXY_PROG_LINE, true) < 0)
+        {
+            return -1;
+        }
+        return getPixy()->line.setNextTurn(angle);
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+    /**
+     * lineSetDefaultTurn() function tells the line tracking algorithm which path to choose by default upon encountering an intersection. The line tracking algorithm will find the path in the intersection that matches the default turn angle most closely. A call to setNextTurn() will supercede the default turn angle for the next intersection.
+     * @param angle Turn angles are specified in degrees, with 0 being straight ahead, left being 90 and right being -90 (for example), although any valid angle value can be used. Valid angles are between -180 and 180.
+     * @returns It returns 0 if it succeeds, otherwise it returns -1.
+     */
+    //% help=pixy2/set-default-turn
+    //% weight=86 blockGap=8
+    //% block="set default turn %angle"
+    //% blockId=pixy2_set_default_turn
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    int8_t lineSetDefaultTurn(int16_t angle)
+    {
+#if PIXY2_ENABLE_LINE
+        if (getPixy()->useProg(PIXY_PROG_LINE, true) < 0)
+        {
+            return -1;
+        }
+        return getPixy()->line.setDefaultTurn(angle);
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+    /**
+     * linePlanTurn() appends a turn angle to the route plan. The planned turns are sent to Pixy2 natively, one per intersection and in order, as the main line features are fetched (getMainFeatures(), intersections seen by getAllFeatures() don't count), so the next turn is always set well before the robot reaches the intersection and no TS code has to react to it.
+     * @param angle Turn angle in degrees, with 0 being straight ahead, left being 90 and right being -90. Valid angles are between -180 and 180.
+     * @returns It returns 0 if it succeeds, or -1 if the plan is full (16 turns).
+     */
+    //% help=pixy2/line-plan-turn
+    //% weight=77 blockGap=8
+    //% block="line plan turn %angle"
+    //% blockId=pixy2_line_plan_turn
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    int8_t linePlanTurn(int16_t angle)
+    {
+#if PIXY2_ENABLE_LINE
+        return getPixy()->line.route.push(angle);
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+    /**
+     * lineClearPlan() removes all planned turns. A turn that was already sent to Pixy2 will still be taken at the next intersection unless lineSetNextTurn() overrides it.
+     */
+    //% help=pixy2/line-clear-plan
+    //% weight=76 blockGap=8
+    //% block="line clear plan"
+    //% blockId=pixy2_line_clear_plan
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    void lineClearPlan()
+    {
+#if PIXY2_ENABLE_LINE
+        getPixy()->line.route.clear();
+#endif
+    }
+
+    /**
+     * linePlannedTurns() gets the number of planned turns that haven't been taken yet, including the one armed for the next intersection.
+     */
+    //% help=pixy2/line-planned-turns
+    //% weight=75 blockGap=8
+    //% block="line planned turns"
+    //% blockId=pixy2_line_planned_turns
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    uint8_t linePlannedTurns()
+    {
+#if PIXY2_ENABLE_LINE
+        return getPixy()->line.route.remaining();
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * lineMapSetGoal() sets the intersection the line map plans the way to, by the barcode in front of it. While the robot drives the intersections it passes are mapped natively, and once the way from the intersection ahead to the goal is known the turn there is sent to Pixy2 before the robot gets to it. Planned turns (linePlanTurn()) come first.
+     * @param barcode The barcode of the goal, 0 to 15, or -1 for no goal.
+     * @returns It returns 0, or an error value (<0) if the barcode is invalid or the map isn't compiled in (PIXY2_ENABLE_LINE_MAP).
+     */
+    //% help=pixy2/line-map-set-goal
+    //% weight=65 blockGap=8
+    //% block="line map set goal %barcode"
+    //% blockId=pixy2_line_map_set_goal
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    int8_t lineMapSetGoal(int barcode)
+    {
+#if PIXY2_ENABLE_LINE && PIXY2_ENABLE_LINE_MAP
+        if (barcode < 0)
+        {
+            return getPixy()->line.map.setGoal(LINE_MAP_NONE);
+        }
+        if (barcode >= LINE_MAP_BARCODES)
+        {
+            return PIXY_RESULT_ERROR;
+        }
+        return getPixy()->line.map.setGoal(barcode);
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+    /**
+     * lineMapReset() forgets all mapped intersections, for example when the robot is put down somewhere else. The goal stays.
+     */
+    //% help=pixy2/line-map-reset
+    //% weight=64 blockGap=8
+    //% block="line map reset"
+    //% blockId=pixy2_line_map_reset
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    void lineMapReset()
+    {
+#if PIXY2_ENABLE_LINE && PIXY2_ENABLE_LINE_MAP
+        getPixy()->line.map.reset();
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the state of the line map as a buffer holding a packed LineMapStatus record.
+     */
+    //%
+    Buffer lineMapGetStatusAsBuffer()
+    {
+#if PIXY2_ENABLE_LINE && PIXY2_ENABLE_LINE_MAP
+        LineMapStatus status;
+
+        getPixy()->line.map.getStatus(&status);
+        return pxt::mkBuffer((uint8_t *)&status, sizeof(status));
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the mapped intersections as a buffer of packed LineMapNode records.
+     */
+    //%
+    Buffer lineMapGetNodesAsBuffer()
+    {
+#if PIXY2_ENABLE_LINE && PIXY2_ENABLE_LINE_MAP
+        Pixy2LineMap *map = &getPixy()->line.map;
+        uint8_t i;
+
+        Buffer buf = pxt::mkBuffer(NULL, map->numNodes() * sizeof(LineMapNode));
+        for (i = 0; i < map->numNodes(); i++)
+        {
+            memcpy(buf->data + i * sizeof(LineMapNode), map->node(i), sizeof(LineMapNode));
+        }
+        return buf;
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * If the LINE_MODE_MANUAL_SELECT_VECTOR mode bit is set, the line tracking algorithm will no longer choose the Vector automatically. Instead, lineSetVector() will set the Vector by providing the index of the line.
+     * @param index The index of the line to set as the Vector.
+     * @returns It returns 0 if it succeeds, otherwise it returns -1.
+     */
+    //% help=pixy2/set-vector
+    //% weight=85 blockGap=8
+    //% block="set vector %index"
+    //% blockId=pixy2_set_vector
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    int8_t lineSetVector(uint8_t index)
+    {
+#if PIXY2_ENABLE_LINE
+        if (getPixy()->useProg(PIXY_PROG_LINE, true) < 0)
+        {
+            return -1;
+        }
+        return getPixy()->line.setVector(index);
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+    /**
+     * The Vector has a direction. It normally points up, from the bottom of the camera frame to the top of the camera frame for a forward-moving robot. Calling lineReverseVector() will invert the vector. This will typically cause your robot to back-up and change directions.
+     * @returns It returns 0 if it succeeds, otherwise it returns -1.
+     */
+    //% help=pixy2/reverse-vector
+    //% weight=84 blockGap=8
+    //% block="reverse vector"
+    //% blockId=pixy2_reverse_vector
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    int8_t lineReverseVector()
+    {
+#if PIXY2_ENABLE_LINE
+        if (getPixy()->useProg(PIXY_PROG_LINE, true) < 0)
+        {
+            return -1;
+        }
+        return getPixy()->line.reverseVector();
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+    // --------------- Video APIs ---------------
+
+#if PIXY2_ENABLE_VIDEO
+    Pixy2Thumbnail thumbnail;
+#endif
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the RGB values as an object
+     */
+    //%
+    String videoGetRGBAsString(uint16_t x, uint16_t y, bool saturate = true)
+    {
+#if PIXY2_ENABLE_VIDEO
+        if (getPixy()->useProg(PIXY_PROG_VIDEO, true) < 0)
         {
             return NULL;
         }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, VIDEO_REQUEST_GET_RGB);
         uint8_t r = 0, g = 0, b = 0;
         getPixy()->video.getRGB(x, y, &r, &g, &b, saturate);
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_MARSHAL, VIDEO_REQUEST_GET_RGB);
         ManagedString rgb = ManagedString(r) + COMMA + ManagedString(g) + COMMA + ManagedString(b);
         return PSTR(rgb);
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * videoGetRGBPoints() samples many pixels in one call. It switches to the video program once and sends the getRGB requests back to back, reusing one request buffer, which is much faster than calling videoGetRGB() for every point.
+     * @param points A buffer of points, each an x and a y value stored as UInt16LE (4 bytes per point). At most 255 points are sampled.
+     * @param saturate [Optional] Scale each sample so that its greatest component is 255 (default), see videoGetRGB().
+     * @returns It returns a buffer with 3 bytes (r, g, b) per sample, in the order of the points. It is shorter than that if a request failed, and null if the video program couldn't be started.
+     */
+    //%
+    Buffer videoGetRGBPoints(Buffer points, bool saturate = true)
+    {
+#if PIXY2_ENABLE_VIDEO
+        if (getPixy()->useProg(PIXY_PROG_VIDEO, true) < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, VIDEO_REQUEST_GET_RGB);
+        int n = points->length / (2 * sizeof(uint16_t));
+        if (n > VIDEO_MAX_SAMPLES)
+            n = VIDEO_MAX_SAMPLES;
+        Buffer rgb = pxt::mkBuffer(NULL, 3 * n);
+        int16_t result = getPixy()->video.getRGBPoints(points->data, n, rgb->data, saturate);
+        if (result < n)
+        {
+            PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_MARSHAL, VIDEO_REQUEST_GET_RGB);
+            return pxt::mkBuffer(rgb->data, 3 * result);
+        }
+        return rgb;
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * videoGetRGBGrid() samples a grid of pixels in one call, row by row starting at the top left. It is much faster than calling videoGetRGB() for every point.
+     * @param x The x location of the first (top left) sample.
+     * @param y The y location of the first (top left) sample.
+     * @param dx The horizontal distance between samples.
+     * @param dy The vertical distance between samples.
+     * @param cols The number of samples per row.
+     * @param rows The number of rows. cols * rows can be at most 255.
+     * @param saturate [Optional] Scale each sample so that its greatest component is 255 (default), see videoGetRGB().
+     * @returns It returns a buffer with 3 bytes (r, g, b) per sample. It is shorter than that if a request failed, and null if the video program couldn't be started or the grid is too large.
+     */
+    //%
+    Buffer videoGetRGBGrid(uint16_t x, uint16_t y, uint16_t dx, uint16_t dy, uint8_t cols, uint8_t rows, bool saturate = true)
+    {
+#if PIXY2_ENABLE_VIDEO
+        if (cols * rows > VIDEO_MAX_SAMPLES)
+        {
+            return NULL;
+        }
+        if (getPixy()->useProg(PIXY_PROG_VIDEO, true) < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, VIDEO_REQUEST_GET_RGB);
+        Buffer rgb = pxt::mkBuffer(NULL, 3 * cols * rows);
+        int16_t result = getPixy()->video.getRGBGrid(x, y, dx, dy, cols, rows, rgb->data, saturate);
+        if (result < cols * rows)
+        {
+            PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_MARSHAL, VIDEO_REQUEST_GET_RGB);
+            return pxt::mkBuffer(rgb->data, 3 * result);
+        }
+        return rgb;
+#else
+        return NULL;
+#endif
+    }
+
+    /**
+     * videoBeginThumbnail() starts a new low resolution thumbnail of the camera image. The thumbnail is sampled with videoScanThumbnail(), one getRGB sample per pixel.
+     * @param width The width of the thumbnail in pixels, e.g. 16.
+     * @param height The height of the thumbnail in pixels, e.g. 12.
+     * @param format 0 for RGB565 (2 bytes per pixel, little endian), 1 for RGB332 (1 byte per pixel). The thumbnail can be at most 384 bytes.
+     * @param interlaced If true, pixels are sampled coarse to fine so that a partly scanned thumbnail is already a usable low detail image. If false, pixels are sampled row by row.
+     * @returns It returns 0 if it succeeds, or -1 if the thumbnail is too large.
+     */
+    //% help=pixy2/video-begin-thumbnail
+    //% weight=81 blockGap=8
+    //% block="video begin thumbnail %width|x %height|format %format|interlaced %interlaced"
+    //% blockId=pixy2_video_begin_thumbnail
+    //% parts="pixy2"
+    //% group="Video"
+    int8_t videoBeginThumbnail(uint8_t width, uint8_t height, uint8_t format, bool interlaced)
+    {
+#if PIXY2_ENABLE_VIDEO
+        return thumbnail.begin(width, height, format, interlaced ? VIDEO_THUMB_INTERLACED : VIDEO_THUMB_ROWS);
+#else
+        return PIXY_RESULT_ERROR;
+#endif
+    }
+
+    /**
+     * videoScanThumbnail() takes more samples for the thumbnail started with videoBeginThumbnail(). Spreading the scan over several calls keeps each call short.
+     * @param maxSamples The maximum number of samples to take in this call.
+     * @returns It returns the number of pixels still to be sampled (0 once the thumbnail is complete), or -1 if the video program couldn't be started.
+     */
+    //% help=pixy2/video-scan-thumbnail
+    //% weight=80 blockGap=8
+    //% block="video scan thumbnail %maxSamples"
+    //% blockId=pixy2_video_scan_thumbnail
+    //% parts="pixy2"
+    //% group="Video"
+    int videoScanThumbnail(int maxSamples)
+    {
+#if PIXY2_ENABLE_VIDEO
+        if (getPixy()->useProg(PIXY_PROG_VIDEO, true) < 0)
+        {
+            return -1;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, VIDEO_REQUEST_GET_RGB);
+        getPixy()->video.scanThumbnail(&thumbnail, maxSamples);
+        return thumbnail.width * thumbnail.height - thumbnail.samples;
+#else
+        return -1;
+#endif
+    }
+
+    /**
+     * videoGetThumbnail() gets the pixels of the thumbnail, row by row from the top left. Pixels that haven't been sampled yet are filled in from the nearest coarser sample when scanning interlaced, and 0 otherwise.
+     * @returns It returns a buffer of width * height pixels in the format given to videoBeginThumbnail().
+     */
+    //% help=pixy2/video-get-thumbnail
+    //% weight=79 blockGap=8
+    //% block="video get thumbnail"
+    //% blockId=pixy2_video_get_thumbnail
+    //% parts="pixy2"
+    //% group="Video"
+    Buffer videoGetThumbnail()
+    {
+#if PIXY2_ENABLE_VIDEO
+        return pxt::mkBuffer(thumbnail.pixels, thumbnail.size());
+#else
+        return pxt::mkBuffer(NULL, 0);
+#endif
+    }
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the color summary of a region as a buffer holding a packed ColorSummary record (16 bytes).
+     */
+    //%
+    Buffer videoGetColorSummaryAsBuffer(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t cols, uint8_t rows, uint8_t mode)
+    {
+#if PIXY2_ENABLE_VIDEO
+        if (cols * rows > VIDEO_MAX_SAMPLES || mode > VIDEO_HIST_RGB)
+        {
+            return NULL;
+        }
+        if (getPixy()->useProg(PIXY_PROG_VIDEO, true) < 0)
+        {
+            return NULL;
+        }
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_SHIM, VIDEO_REQUEST_GET_RGB);
+        Pixy2ColorHistogram hist(mode);
+        ColorSummary summary;
+        getPixy()->video.sampleHistogram(&hist, x, y, width, height, cols, rows);
+        PIXY_SPAN_SCOPE(getPixy()->spans, PIXY_SPAN_MARSHAL, VIDEO_REQUEST_GET_RGB);
+        hist.summarize(&summary);
+        return pxt::mkBuffer((uint8_t *)&summary, sizeof(summary));
+#else
+        return NULL;
+#endif
     }
 
 }
@@ -16,6 +16,45 @@ namespace pixy2 {
         m_age: number;
     }
 
+    export interface ColorCode {
+        m_signature: number;
+        m_x: number;
+        m_y: number;
+        m_width: number;
+        m_height: number;
+        m_angle: number;
+        m_headingX: number;
+        m_headingY: number;
+        m_index: number;
+        m_age: number;
+        m_match: number;
+        m_digits: number[];
+        m_flags: number;
+    }
+
+    // size of the packed ColorCode record in Pixy2ColorCodes.h
+    const COLOR_CODE_SIZE = 26;
+
+    export interface BlockGeometry {
+        block: Block;
+        area: number;
+        distance2: number;
+        iou: number;
+        inside: boolean;
+    }
+
+    // size of the packed geometry record of cccGetBlockGeometryAsBuffer() in pixy2.cpp
+    const BLOCK_GEOMETRY_SIZE = 26;
+
+    export interface TrackingStatus {
+        running: boolean;
+        locked: boolean;
+        pan: number;
+        tilt: number;
+        target: Block;
+        lostFrames: number;
+    }
+
     export interface Vector {
         m_x0: number;
         m_y0: number;
@@ -52,6 +91,145 @@ namespace pixy2 {
         barcodes: Barcode[];
     }
 
+    export interface FeatureChange {
+        op: number;
+        type: number;
+        vector: Vector;
+        intersection: Intersection;
+        barcode: Barcode;
+    }
+
+    // feature types and change ops as defined in Pixy2Line.h and Pixy2LineDelta.h
+    const LINE_VECTOR = 0x01;
+    const LINE_INTERSECTION = 0x02;
+    const LINE_BARCODE = 0x04;
+    export const LINE_DELTA_ADDED = 0x01;
+    export const LINE_DELTA_REMOVED = 0x02;
+    export const LINE_DELTA_MOVED = 0x03;
+    export const LINE_DELTA_TRUNCATED = 0x04;
+
+    export interface Steering {
+        heading: number;
+        offset: number;
+        output: number;
+        valid: boolean;
+    }
+
+    export interface Lookahead {
+        heading: number;
+        offset: number;
+        headingRate: number;
+        offsetRate: number;
+        curvature: number;
+        predictedHeading: number;
+        predictedOffset: number;
+        predictedX: number;
+        samples: number;
+        valid: boolean;
+    }
+
+    export interface LineMapStatus {
+        nodes: number;
+        node: number;
+        goal: number;
+        nextTurn: number;
+        turnArmed: boolean;
+        atGoal: boolean;
+        full: boolean;
+        routeKnown: boolean;
+        eta: number;
+    }
+
+    export interface LineMapBranch {
+        angle: number;
+        to: number;
+        toBranch: number;
+        time: number;
+        next: number;
+    }
+
+    export interface LineMapNode {
+        key: number;
+        barcode: boolean;
+        branches: LineMapBranch[];
+    }
+
+    // as defined in Pixy2LineMap.h
+    const LINE_MAP_NONE = 0xff;
+    const LINE_MAP_NODE_SIZE = 52;
+
+    export interface BarcodeSighting {
+        time: number;
+        barcode: Barcode;
+    }
+
+    export interface ColorSummary {
+        samples: number;
+        mean: RGB;
+        bins: number[];
+        counts: number[];
+    }
+
+    // color histogram binnings and special bins, as defined in Pixy2ColorHistogram.h
+    export const VIDEO_HIST_HSV = 0;
+    export const VIDEO_HIST_RGB = 1;
+    export const VIDEO_HIST_BLACK = 12;
+    export const VIDEO_HIST_GRAY = 13;
+    export const VIDEO_HIST_WHITE = 14;
+    const VIDEO_HIST_NO_BIN = 0xff;
+
+    // size of the packed BarcodeSighting record in Pixy2BarcodeHistory.h
+    const BARCODE_SIGHTING_SIZE = 8;
+    // message bus ids, as defined in TPixy2.h
+    const PIXY_EVT_LINE_BARCODE = 4201;
+    const PIXY_EVT_CCC_SIG_APPEARED = 4202;
+    const PIXY_EVT_CCC_SIG_DISAPPEARED = 4203;
+    const PIXY_EVT_LINE_INTERSECTION = 4204;
+    const PIXY_EVT_LINE_BARCODE_SEEN = 4205;
+    const PIXY_EVT_LINE_VECTOR_LOST = 4206;
+    // modes of the acquisition fiber, as defined in Pixy2Monitor.h
+    const PIXY_MONITOR_CCC = 1;
+    const PIXY_MONITOR_LINE = 2;
+
+    function readVector(buf: Buffer, off: number): Vector {
+        return {
+            m_x0: buf.getNumber(NumberFormat.UInt8LE, off),
+            m_y0: buf.getNumber(NumberFormat.UInt8LE, off + 1),
+            m_x1: buf.getNumber(NumberFormat.UInt8LE, off + 2),
+            m_y1: buf.getNumber(NumberFormat.UInt8LE, off + 3),
+            m_index: buf.getNumber(NumberFormat.UInt8LE, off + 4),
+            m_flags: buf.getNumber(NumberFormat.UInt8LE, off + 5)
+        };
+    }
+
+    function readIntersection(buf: Buffer, off: number): Intersection {
+        let n = buf.getNumber(NumberFormat.UInt8LE, off + 2);
+        let intersectionLines: IntersectionLine[] = [];
+        for (let i = 0; i < n; i++) {
+            intersectionLines.push({
+                m_index: buf.getNumber(NumberFormat.UInt8LE, off + 4 + 4 * i),
+                m_reserved: buf.getNumber(NumberFormat.UInt8LE, off + 5 + 4 * i),
+                m_angle: buf.getNumber(NumberFormat.Int16LE, off + 6 + 4 * i)
+            });
+        }
+        return {
+            m_x: buf.getNumber(NumberFormat.UInt8LE, off),
+            m_y: buf.getNumber(NumberFormat.UInt8LE, off + 1),
+            m_n: n,
+            m_reserved: buf.getNumber(NumberFormat.UInt8LE, off + 3),
+            m_intLines: intersectionLines
+        };
+    }
+
+    function readBarcode(buf: Buffer, off: number): Barcode {
+        return {
+            m_x: buf.getNumber(NumberFormat.UInt8LE, off),
+            m_y: buf.getNumber(NumberFormat.UInt8LE, off + 1),
+            m_flags: buf.getNumber(NumberFormat.UInt8LE, off + 2),
+            m_code: buf.getNumber(NumberFormat.UInt8LE, off + 3)
+        };
+    }
+
     function convertFeaturesStringToInterface(str: string): Features {
         let featuresArray = str.split("\n");
         let vectors: Vector[] = [];
@@ -141,6 +319,158 @@ namespace pixy2 {
         return blocksArray;
     }
 
+    /**
+     * cccGetColorCodes() gets the color code blocks of the most recent frame, decoded natively. Each color code is split into its digits (signatures), matched against the codes registered with cccRegisterColorCode() and given a heading vector computed from its angle.
+     * @param wait Setting wait to false causes cccGetColorCodes() to return immediately if no new data is available (polling mode). Setting wait to true (default) causes cccGetColorCodes() to block (wait) until the next frame of block data is available.
+     * @param maxblocks maxblocks indicates the maximum number of color code blocks you wish to receive. At most 8 color codes are decoded per frame.
+     * @returns It returns an array of color codes. If it fails, it returns an empty array. Each color code contains m_signature, m_x, m_y, m_width, m_height, m_angle, m_headingX, m_headingY (cos and sin of m_angle scaled so that 16384 is 1.0), m_index, m_age, m_match (index of the matching registered code, or 255 if none matched), m_digits and m_flags (1 if the code is invalid).
+     */
+    //% help=pixy2/ccc-get-color-codes
+    //% weight=81 blockGap=8
+    //% block="ccc get color codes"
+    //% blockId=pixy2_ccc_get_color_codes
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    export function cccGetColorCodes(wait: boolean = true, maxblocks: number = 255): ColorCode[] {
+        let buf = pixy2.cccGetColorCodesAsBuffer(wait, maxblocks);
+        let codes: ColorCode[] = [];
+        if (!buf)
+            return codes;
+        for (let off = 0; off + COLOR_CODE_SIZE <= buf.length; off += COLOR_CODE_SIZE) {
+            let digits: number[] = [];
+            let numDigits = buf.getNumber(NumberFormat.UInt8LE, off + 19);
+            for (let i = 0; i < numDigits; i++)
+                digits.push(buf.getNumber(NumberFormat.UInt8LE, off + 20 + i));
+            codes.push({
+                m_signature: buf.getNumber(NumberFormat.UInt16LE, off),
+                m_x: buf.getNumber(NumberFormat.UInt16LE, off + 2),
+                m_y: buf.getNumber(NumberFormat.UInt16LE, off + 4),
+                m_width: buf.getNumber(NumberFormat.UInt16LE, off + 6),
+                m_height: buf.getNumber(NumberFormat.UInt16LE, off + 8),
+                m_angle: buf.getNumber(NumberFormat.Int16LE, off + 10),
+                m_headingX: buf.getNumber(NumberFormat.Int16LE, off + 12),
+                m_headingY: buf.getNumber(NumberFormat.Int16LE, off + 14),
+                m_index: buf.getNumber(NumberFormat.UInt8LE, off + 16),
+                m_age: buf.getNumber(NumberFormat.UInt8LE, off + 17),
+                m_match: buf.getNumber(NumberFormat.UInt8LE, off + 18),
+                m_digits: digits,
+                m_flags: buf.getNumber(NumberFormat.UInt8LE, off + 25)
+            });
+        }
+        return codes;
+    }
+
+    /**
+     * cccGetBlockGeometry() gets the blocks of the most recent frame, like cccGetBlocks(), together with their geometry against a reference box, computed natively for all blocks at once.
+     * @param x The x coordinate of the center of the reference box.
+     * @param y The y coordinate of the center of the reference box.
+     * @param width The width of the reference box.
+     * @param height The height of the reference box.
+     * @param wait [Optional] See cccGetBlocks(), default true.
+     * @param sigmap [Optional] See cccGetBlocks(), default 255 (all signatures).
+     * @param maxblocks [Optional] See cccGetBlocks(), default 255.
+     * @returns It returns an array with, for each block, the block, its area, the squared distance of its center to the center of the box (distance2), the intersection over union with the box scaled so that 16384 is 1.0 (iou) and whether its center is inside the box. If it fails, it returns an empty array.
+     */
+    //% help=pixy2/ccc-get-block-geometry
+    //% weight=71 blockGap=8
+    //% block="ccc get block geometry x %x y %y width %width height %height"
+    //% blockId=pixy2_ccc_get_block_geometry
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    export function cccGetBlockGeometry(x: number, y: number, width: number, height: number, wait: boolean = true, sigmap: number = 255, maxblocks: number = 255): BlockGeometry[] {
+        let buf = pixy2.cccGetBlockGeometryAsBuffer(wait, sigmap, maxblocks, x, y, width, height);
+        let geometry: BlockGeometry[] = [];
+        if (!buf)
+            return geometry;
+        for (let off = 0; off + BLOCK_GEOMETRY_SIZE <= buf.length; off += BLOCK_GEOMETRY_SIZE) {
+            geometry.push({
+                block: {
+                    m_signature: buf.getNumber(NumberFormat.UInt16LE, off),
+                    m_x: buf.getNumber(NumberFormat.UInt16LE, off + 2),
+                    m_y: buf.getNumber(NumberFormat.UInt16LE, off + 4),
+                    m_width: buf.getNumber(NumberFormat.UInt16LE, off + 6),
+                    m_height: buf.getNumber(NumberFormat.UInt16LE, off + 8),
+                    m_angle: buf.getNumber(NumberFormat.Int16LE, off + 10),
+                    m_index: buf.getNumber(NumberFormat.UInt8LE, off + 12),
+                    m_age: buf.getNumber(NumberFormat.UInt8LE, off + 13)
+                },
+                area: buf.getNumber(NumberFormat.UInt32LE, off + 14),
+                distance2: buf.getNumber(NumberFormat.UInt32LE, off + 18),
+                iou: buf.getNumber(NumberFormat.UInt16LE, off + 22),
+                inside: buf.getNumber(NumberFormat.UInt8LE, off + 24) != 0
+            });
+        }
+        return geometry;
+    }
+
+    /**
+     * cccGetTrackingStatus() gets the state of the tracker started with cccStartTracking().
+     * @returns It returns whether the tracker is running and locked on a target, the current servo positions (pan and tilt), the last seen target block (m_angle and m_age are always 0) and the number of frames since the target was last seen.
+     */
+    //% help=pixy2/ccc-get-tracking-status
+    //% weight=74 blockGap=8
+    //% block="ccc get tracking status"
+    //% blockId=pixy2_ccc_get_tracking_status
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    export function cccGetTrackingStatus(): TrackingStatus {
+        let buf = pixy2.cccGetTrackingStatusAsBuffer();
+        let flags = buf.getNumber(NumberFormat.UInt8LE, 17);
+        return {
+            running: (flags & 0x01) != 0,
+            locked: (flags & 0x02) != 0,
+            pan: buf.getNumber(NumberFormat.UInt16LE, 0),
+            tilt: buf.getNumber(NumberFormat.UInt16LE, 2),
+            target: {
+                m_signature: buf.getNumber(NumberFormat.UInt16LE, 4),
+                m_x: buf.getNumber(NumberFormat.UInt16LE, 6),
+                m_y: buf.getNumber(NumberFormat.UInt16LE, 8),
+                m_width: buf.getNumber(NumberFormat.UInt16LE, 10),
+                m_height: buf.getNumber(NumberFormat.UInt16LE, 12),
+                m_angle: 0,
+                m_index: buf.getNumber(NumberFormat.UInt8LE, 16),
+                m_age: 0
+            },
+            lostFrames: buf.getNumber(NumberFormat.UInt16LE, 14)
+        };
+    }
+
+    /**
+     * onSignatureAppeared() runs some code when a signature comes into view. Registering the handler starts a background fiber that watches the color connected components, nothing has to be polled. Only one program can be watched at a time, so this stops the line events.
+     * @param handler The code to run. It gets the signature (1 to 7).
+     */
+    //% help=pixy2/on-signature-appeared
+    //% weight=73 blockGap=8
+    //% block="on signature appeared"
+    //% blockId=pixy2_on_signature_appeared
+    //% draggableParameters="reporter"
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    export function onSignatureAppeared(handler: (signature: number) => void): void {
+        control.onEvent(PIXY_EVT_CCC_SIG_APPEARED, EventBusValue.MICROBIT_EVT_ANY, () => {
+            handler(control.eventValue());
+        });
+        pixy2.startEvents(PIXY_MONITOR_CCC);
+    }
+
+    /**
+     * onSignatureDisappeared() runs some code when a signature goes out of view (see setEventHoldFrames()). Like onSignatureAppeared(), it starts watching the color connected components in the background.
+     * @param handler The code to run. It gets the signature (1 to 7).
+     */
+    //% help=pixy2/on-signature-disappeared
+    //% weight=72 blockGap=8
+    //% block="on signature disappeared"
+    //% blockId=pixy2_on_signature_disappeared
+    //% draggableParameters="reporter"
+    //% parts="pixy2"
+    //% group="Color Connected Components"
+    export function onSignatureDisappeared(handler: (signature: number) => void): void {
+        control.onEvent(PIXY_EVT_CCC_SIG_DISAPPEARED, EventBusValue.MICROBIT_EVT_ANY, () => {
+            handler(control.eventValue());
+        });
+        pixy2.startEvents(PIXY_MONITOR_CCC);
+    }
+
     /**
      * lineGetMainFeatures() gets the latest features including the Vector, any intersection that connects to the Vector, and barcodes.  lineGetMainFeatures() tries to send only the most relevant information. Some notes:
         The line tracking algorithm finds the best Vector candidate and begins tracking it from frame to frame 1). The Vector is often the only feature lineGetMainFeatures() returns.
@@ -188,6 +518,268 @@ namespace pixy2 {
         return convertFeaturesStringToInterface(pixy2.lineGetAllFeaturesAsString(features, wait));
     }
 
+    /**
+     * lineGetFeatureChanges() compares all features of the latest frame against the frame seen by the previous call and returns only what changed. Vectors are matched by m_index, barcodes by m_code and intersections by their number of branches, so on a mostly static course most calls return an empty array.
+     * @param features [optional] The features argument is a bitwise-ORing of LINE_VECTOR (1), LINE_INTERSECTION (2), and LINE_BARCODE (4). Feature types that aren't requested are neither compared nor forgotten.
+     * @param wait [optional] Setting wait to false causes lineGetFeatureChanges() to return immediately if no new data is available (polling mode). Setting wait to true (default) causes it to block until the next frame of line feature data is available.
+     * @returns It returns an array of changes. Each change has op (LINE_DELTA_ADDED, LINE_DELTA_REMOVED or LINE_DELTA_MOVED), type (1 vector, 2 intersection, 4 barcode) and the matching vector, intersection or barcode member (the others are null). Removed features carry their last known values. Only the first 16 vectors, 4 intersections and 8 barcodes of a frame are compared; if a frame has more, a change with op LINE_DELTA_TRUNCATED and no feature comes first for that type. If it fails, it returns an empty array.
+     */
+    //% help=pixy2/line-get-feature-changes
+    //% weight=83 blockGap=8
+    //% block="line get feature changes"
+    //% blockId=pixy2_line_get_feature_changes
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    export function lineGetFeatureChanges(features: number = 7, wait: boolean = true): FeatureChange[] {
+        let buf = pixy2.lineGetFeatureChangesAsBuffer(features, wait);
+        let changes: FeatureChange[] = [];
+        if (!buf)
+            return changes;
+        let off = 0;
+        while (off + 3 <= buf.length) {
+            let type = buf.getNumber(NumberFormat.UInt8LE, off + 1);
+            let size = buf.getNumber(NumberFormat.UInt8LE, off + 2);
+            let data = size > 0 ? type : 0; // LINE_DELTA_TRUNCATED carries no feature
+            changes.push({
+                op: buf.getNumber(NumberFormat.UInt8LE, off),
+                type: type,
+                vector: data == LINE_VECTOR ? readVector(buf, off + 3) : null,
+                intersection: data == LINE_INTERSECTION ? readIntersection(buf, off + 3) : null,
+                barcode: data == LINE_BARCODE ? readBarcode(buf, off + 3) : null
+            });
+            off += 3 + size;
+        }
+        return changes;
+    }
+
+    /**
+     * lineGetSteering() gets the main vector and computes the steering natively. The heading error is the angle of the vector from straight ahead, the offset error is how far the head of the vector is from the frame center. If gains were set with lineSetSteeringGains(), the PID output is the motor differential to apply (e.g. left = speed + output, right = speed - output).
+     * @param wait [optional] Setting wait to true (default) causes lineGetSteering() to block until the next frame of line data is available.
+     * @returns It returns heading (degrees), offset (-1 to 1 of the half frame width), output (motor differential) and valid (false if no vector was found, output then keeps its last value). Errors are positive when the line is to the right. If it fails, it returns null.
+     */
+    //% help=pixy2/line-get-steering
+    //% weight=81 blockGap=8
+    //% block="line get steering"
+    //% blockId=pixy2_line_get_steering
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    export function lineGetSteering(wait: boolean = true): Steering {
+        let buf = pixy2.lineGetSteeringAsBuffer(wait);
+        if (!buf)
+            return null;
+        return {
+            heading: buf.getNumber(NumberFormat.Int16LE, 0) / 64,
+            offset: buf.getNumber(NumberFormat.Int16LE, 2) / 16384,
+            output: buf.getNumber(NumberFormat.Int16LE, 4),
+            valid: buf.getNumber(NumberFormat.UInt8LE, 6) != 0
+        };
+    }
+
+    /**
+     * lineGetLookahead() gets the main vector and estimates natively from it and the vectors of the last frames how the line goes on: how fast its heading and offset change, and where it will be after the lookahead time set with lineSetLookahead(). Use it to slow down before a curve. The history starts over when the line is lost or Pixy2 starts tracking another line.
+     * @param wait [optional] Setting wait to true (default) causes lineGetLookahead() to block until the next frame of line data is available.
+     * @returns It returns heading (degrees) and offset (-1 to 1 of the half frame width) of the current vector like lineGetSteering(), headingRate (degrees per second), offsetRate (per second), curvature (degrees per meter, 0 unless the speed was set with lineSetLookahead()), predictedHeading, predictedOffset and predictedX (pixels) at the lookahead time, the number of frames the estimate is made from and valid (false if there is no vector). If it fails, it returns null.
+     */
+    //% help=pixy2/line-get-lookahead
+    //% weight=67 blockGap=8
+    //% block="line get lookahead"
+    //% blockId=pixy2_line_get_lookahead
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    export function lineGetLookahead(wait: boolean = true): Lookahead {
+        let buf = pixy2.lineGetLookaheadAsBuffer(wait);
+        if (!buf)
+            return null;
+        return {
+            heading: buf.getNumber(NumberFormat.Int16LE, 0) / 64,
+            offset: buf.getNumber(NumberFormat.Int16LE, 2) / 16384,
+            headingRate: buf.getNumber(NumberFormat.Int32LE, 4) / 64,
+            offsetRate: buf.getNumber(NumberFormat.Int32LE, 8) / 16384,
+            curvature: buf.getNumber(NumberFormat.Int32LE, 12) / 64,
+            predictedHeading: buf.getNumber(NumberFormat.Int16LE, 16) / 64,
+            predictedOffset: buf.getNumber(NumberFormat.Int16LE, 18) / 16384,
+            predictedX: buf.getNumber(NumberFormat.Int16LE, 20),
+            samples: buf.getNumber(NumberFormat.UInt8LE, 22),
+            valid: buf.getNumber(NumberFormat.UInt8LE, 23) != 0
+        };
+    }
+
+    /**
+     * lineMapGetStatus() gets the state of the native line map (see lineMapSetGoal()).
+     * @returns It returns the number of mapped intersections (nodes), the index of the one passed last (node, -1 if the robot is lost), the goal barcode (-1 if none), the turn sent to Pixy2 for the next intersection (nextTurn, valid if turnArmed), whether the last intersection was the goal (atGoal), whether the map ran out of room (full), and whether the way from the intersection ahead to the goal is known (routeKnown) and how long it took (eta, ms). If the map isn't compiled in (PIXY2_ENABLE_LINE_MAP), it returns null.
+     */
+    //% help=pixy2/line-map-get-status
+    //% weight=63 blockGap=8
+    //% block="line map get status"
+    //% blockId=pixy2_line_map_get_status
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    export function lineMapGetStatus(): LineMapStatus {
+        let buf = pixy2.lineMapGetStatusAsBuffer();
+        if (!buf)
+            return null;
+        let node = buf.getNumber(NumberFormat.UInt8LE, 3);
+        let goal = buf.getNumber(NumberFormat.UInt8LE, 4);
+        let flags = buf.getNumber(NumberFormat.UInt8LE, 5);
+        return {
+            nodes: buf.getNumber(NumberFormat.UInt8LE, 2),
+            node: node == LINE_MAP_NONE ? -1 : node,
+            goal: goal == LINE_MAP_NONE ? -1 : goal,
+            nextTurn: buf.getNumber(NumberFormat.Int16LE, 0),
+            turnArmed: (flags & 0x01) != 0,
+            atGoal: (flags & 0x02) != 0,
+            full: (flags & 0x04) != 0,
+            routeKnown: (flags & 0x08) != 0,
+            eta: buf.getNumber(NumberFormat.UInt16LE, 6)
+        };
+    }
+
+    /**
+     * lineMapGetNodes() gets the intersections the native line map has learned, to show or save the map.
+     * @returns It returns an array with, for each intersection, its key (the barcode, or the visit number if barcode is false) and its branches: the angle as seen on the first visit, the index of the intersection it leads to and the branch it arrives by there (-1 if not travelled yet), the travel time in ms, and coming in by this branch, the branch to leave by towards the goal (next, -1 if none). If the map isn't compiled in, it returns an empty array.
+     */
+    //% help=pixy2/line-map-get-nodes
+    //% weight=62 blockGap=8
+    //% block="line map get nodes"
+    //% blockId=pixy2_line_map_get_nodes
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    export function lineMapGetNodes(): LineMapNode[] {
+        let buf = pixy2.lineMapGetNodesAsBuffer();
+        let nodes: LineMapNode[] = [];
+        if (!buf)
+            return nodes;
+        for (let off = 0; off + LINE_MAP_NODE_SIZE <= buf.length; off += LINE_MAP_NODE_SIZE) {
+            let branches: LineMapBranch[] = [];
+            let n = buf.getNumber(NumberFormat.UInt8LE, off + 2);
+            for (let i = 0; i < n; i++) {
+                let b = off + 4 + i * 8;
+                let to = buf.getNumber(NumberFormat.UInt8LE, b + 2);
+                let toBranch = buf.getNumber(NumberFormat.UInt8LE, b + 3);
+                let next = buf.getNumber(NumberFormat.UInt8LE, b + 6);
+                branches.push({
+                    angle: buf.getNumber(NumberFormat.Int16LE, b),
+                    to: to == LINE_MAP_NONE ? -1 : to,
+                    toBranch: toBranch == LINE_MAP_NONE ? -1 : toBranch,
+                    time: buf.getNumber(NumberFormat.UInt16LE, b + 4),
+                    next: next == LINE_MAP_NONE ? -1 : next
+                });
+            }
+            nodes.push({
+                key: buf.getNumber(NumberFormat.UInt8LE, off),
+                barcode: (buf.getNumber(NumberFormat.UInt8LE, off + 1) & 0x01) != 0,
+                branches: branches
+            });
+        }
+        return nodes;
+    }
+
+    /**
+     * lineSetSteeringGains() sets the gains of the native steering PID. The error is scaled so that 1 is the line at the edge of the frame (or 90 degrees off when steering on the heading), so kp is the motor differential for that error. Setting all gains to 0 (default) turns the PID off.
+     * @param kp Proportional gain.
+     * @param ki Integral gain, per second.
+     * @param kd Derivative gain, per second.
+     */
+    //% help=pixy2/line-set-steering-gains
+    //% weight=80 blockGap=8
+    //% block="line set steering gains kp %kp ki %ki kd %kd"
+    //% blockId=pixy2_line_set_steering_gains
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    export function lineSetSteeringGains(kp: number, ki: number, kd: number): void {
+        pixy2.lineSetSteeringGainsQ8(Math.round(kp * 256), Math.round(ki * 256), Math.round(kd * 256));
+    }
+
+    /**
+     * lineGetBarcodeHistory() gets the most recent barcode sightings (up to 16), oldest first. Sightings are recorded natively every time line features are fetched, so barcodes aren't lost when they are only reported once.
+     * @returns It returns an array of sightings, each with the time (in ms since start) and the barcode.
+     */
+    //% help=pixy2/line-get-barcode-history
+    //% weight=72 blockGap=8
+    //% block="line get barcode history"
+    //% blockId=pixy2_line_get_barcode_history
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    export function lineGetBarcodeHistory(): BarcodeSighting[] {
+        let buf = pixy2.lineGetBarcodeHistoryAsBuffer();
+        let sightings: BarcodeSighting[] = [];
+        for (let off = 0; off + BARCODE_SIGHTING_SIZE <= buf.length; off += BARCODE_SIGHTING_SIZE) {
+            sightings.push({
+                time: buf.getNumber(NumberFormat.UInt32LE, off),
+                barcode: readBarcode(buf, off + 4)
+            });
+        }
+        return sightings;
+    }
+
+    /**
+     * onBarcodeConfirmed() runs some code when a barcode is confirmed, that is, when it has been seen enough times (see lineSetBarcodeVoting()). The event is raised natively while line features are fetched, so there's no need to parse barcodes in every frame.
+     * @param handler The code to run. It gets the barcode value (0 to 15).
+     */
+    //% help=pixy2/on-barcode-confirmed
+    //% weight=71 blockGap=8
+    //% block="on barcode confirmed"
+    //% blockId=pixy2_on_barcode_confirmed
+    //% draggableParameters="reporter"
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    export function onBarcodeConfirmed(handler: (code: number) => void): void {
+        control.onEvent(PIXY_EVT_LINE_BARCODE, EventBusValue.MICROBIT_EVT_ANY, () => {
+            handler(control.eventValue() - 1);
+        });
+    }
+
+    /**
+     * onIntersection() runs some code when the line reaches an intersection. Registering the handler starts a background fiber that watches the line features, nothing has to be polled. Only one program can be watched at a time, so this stops the signature events.
+     * @param handler The code to run. It gets the number of branches of the intersection.
+     */
+    //% help=pixy2/on-intersection
+    //% weight=70 blockGap=8
+    //% block="on intersection"
+    //% blockId=pixy2_on_intersection
+    //% draggableParameters="reporter"
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    export function onIntersection(handler: (branches: number) => void): void {
+        control.onEvent(PIXY_EVT_LINE_INTERSECTION, EventBusValue.MICROBIT_EVT_ANY, () => {
+            handler(control.eventValue());
+        });
+        pixy2.startEvents(PIXY_MONITOR_LINE);
+    }
+
+    /**
+     * onBarcodeSeen() runs some code when a barcode comes into view, without the voting of onBarcodeConfirmed(). Like onIntersection(), it starts watching the line features in the background.
+     * @param handler The code to run. It gets the barcode value (0 to 15).
+     */
+    //% help=pixy2/on-barcode-seen
+    //% weight=69 blockGap=8
+    //% block="on barcode seen"
+    //% blockId=pixy2_on_barcode_seen
+    //% draggableParameters="reporter"
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    export function onBarcodeSeen(handler: (code: number) => void): void {
+        control.onEvent(PIXY_EVT_LINE_BARCODE_SEEN, EventBusValue.MICROBIT_EVT_ANY, () => {
+            handler(control.eventValue() - 1);
+        });
+        pixy2.startEvents(PIXY_MONITOR_LINE);
+    }
+
+    /**
+     * onVectorLost() runs some code when the line vector is lost (see setEventHoldFrames()). Like onIntersection(), it starts watching the line features in the background.
+     * @param handler The code to run.
+     */
+    //% help=pixy2/on-vector-lost
+    //% weight=68 blockGap=8
+    //% block="on vector lost"
+    //% blockId=pixy2_on_vector_lost
+    //% parts="pixy2"
+    //% group="Line Tracking"
+    export function onVectorLost(handler: () => void): void {
+        control.onEvent(PIXY_EVT_LINE_VECTOR_LOST, EventBusValue.MICROBIT_EVT_ANY, handler);
+        pixy2.startEvents(PIXY_MONITOR_LINE);
+    }
+
     /**
      * videoGetRGB() is currently the only function supported by the video program. It takes an x and y location in the image and returns red, green, blue values of the pixel. The individual values of red, green and blue vary from 0 to 255. Instead of using just one pixel, videoGetRGB() takes a 5×5 section of pixels centered at the x, y location and performs an average of all 25 pixels to obtain a representative result. Locations on the edge or close to the edge of the image are allowed, but will result in fewer pixels being averaged. The width and height values are both available through pixy.frameWidth and pixy.frameHeight, if you don't want to remember their specific values.
      * @param x The x location of the pixel.
@@ -206,4 +798,60 @@ namespace pixy2 {
         let rgb = str.split(",");
         return { r: parseInt(rgb[0]), g: parseInt(rgb[1]), b: parseInt(rgb[2]) };
     }
-}
\ No newline at end of file
+
+    /**
+     * videoUnpackRGB() converts the buffer returned by videoGetRGBPoints() or videoGetRGBGrid() into an array of RGB values.
+     * @param buf A buffer with 3 bytes (r, g, b) per sample.
+     * @returns It returns an array of RGB values, empty if buf is null.
+     */
+    //% help=pixy2/video-unpack-rgb
+    //% weight=82 blockGap=8
+    //% block="video unpack RGB %buf"
+    //% blockId=pixy2_video_unpack_rgb
+    //% parts="pixy2"
+    //% group="Video"
+    export function videoUnpackRGB(buf: Buffer): RGB[] {
+        let samples: RGB[] = [];
+        if (!buf)
+            return samples;
+        for (let off = 0; off + 3 <= buf.length; off += 3)
+            samples.push({ r: buf[off], g: buf[off + 1], b: buf[off + 2] });
+        return samples;
+    }
+
+    /**
+     * videoGetColorSummary() samples a grid of pixels over a region of the image and sums them up natively into a color histogram. Only the mean color and the most common colors are sent back, so it is much cheaper than fetching and sorting the samples in TS.
+     * @param x The x location of the top left corner of the region.
+     * @param y The y location of the top left corner of the region.
+     * @param width The width of the region.
+     * @param height The height of the region.
+     * @param cols The number of samples across the region, e.g. 8.
+     * @param rows The number of samples down the region, e.g. 6. cols * rows can be at most 255.
+     * @param mode [Optional] VIDEO_HIST_HSV (default) sorts samples into 12 hue bins of 30 degrees (0 is red, 4 is green, 8 is blue) plus VIDEO_HIST_BLACK, VIDEO_HIST_GRAY and VIDEO_HIST_WHITE. VIDEO_HIST_RGB uses 2 bits per channel, bin = r * 16 + g * 4 + b.
+     * @returns It returns the number of samples, their mean color and up to 3 bins with their sample counts, most common first. It returns null if the region couldn't be sampled.
+     */
+    //% help=pixy2/video-get-color-summary
+    //% weight=78 blockGap=8
+    //% block="video get color summary x %x y %y width %width height %height cols %cols rows %rows"
+    //% blockId=pixy2_video_get_color_summary
+    //% parts="pixy2"
+    //% group="Video"
+    export function videoGetColorSummary(x: number, y: number, width: number, height: number, cols: number, rows: number, mode: number = VIDEO_HIST_HSV): ColorSummary {
+        let buf = pixy2.videoGetColorSummaryAsBuffer(x, y, width, height, cols, rows, mode);
+        if (!buf)
+            return null;
+        let summary: ColorSummary = {
+            samples: buf.getNumber(NumberFormat.UInt16LE, 0),
+            mean: { r: buf[11], g: buf[12], b: buf[13] },
+            bins: [],
+            counts: []
+        };
+        for (let i = 0; i < 3; i++) {
+            if (buf[8 + i] == VIDEO_HIST_NO_BIN)
+                break;
+            summary.bins.push(buf[8 + i]);
+            summary.counts.push(buf.getNumber(NumberFormat.UInt16LE, 2 + 2 * i));
+        }
+        return summary;
+    }
+}
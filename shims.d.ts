@@ -33,7 +33,7 @@ declare namespace pixy2 {
     function changeProg(prog: string): string;
 
     /**
-     * setServos() sets the servo positions of servos plugged into Pixy2's two RC servo connectors.
+     * setServos() sets the servo positions of servos plugged into Pixy2's two RC servo connectors. Nothing is sent if Pixy2 already has these positions.
      * @param s0 The servo value ranges between PIXY_RCS_MIN_POS (0) and PIXY_RCS_MAX_POS (1000).
      * @param s1 The servo value ranges between PIXY_RCS_MIN_POS (0) and PIXY_RCS_MAX_POS (1000).
      * @returns It returns an error value (<0) if it fails and 0 (PIXY_RESULT_OK) if it succeeds.
@@ -47,7 +47,7 @@ declare namespace pixy2 {
     function setServos(s0: uint16, s1: uint16): int8;
 
     /**
-     * setCameraBrightness() sets the relative exposure level of Pixy2's image sensor.
+     * setCameraBrightness() sets the relative exposure level of Pixy2's image sensor. Nothing is sent if Pixy2 already has this brightness.
      * @param brightness Higher values result in a brighter (more exposed) image.
      * @returns It returns an error value (<0) if it fails and 0 (PIXY_RESULT_OK) if it succeeds.
      */
@@ -60,7 +60,7 @@ declare namespace pixy2 {
     function setCameraBrightness(brightness: uint8): int8;
 
     /**
-     * setLED() sets Pixy2's RGB LED value. It will override Pixy2's own setting of the RGB LED
+     * setLED() sets Pixy2's RGB LED value. It will override Pixy2's own setting of the RGB LED. Nothing is sent if Pixy2 already has this value.
      * @param r Sets the brightness of the red section of the LED
      * @param g Sets the brightness of the green section of the LED
      * @param b Sets the brightness of the blue section of the LED
@@ -75,7 +75,7 @@ declare namespace pixy2 {
     function setLED(r: uint8, g: uint8, b: uint8): int8;
 
     /**
-     * setLamp() turns on/off Pixy2's integrated light source. Both arguments are binary, zero or non-zero. It returns an error value (<0) if it fails and 0 (PIXY_RESULT_OK) if it succeeds.
+     * setLamp() turns on/off Pixy2's integrated light source. Both arguments are binary, zero or non-zero. Nothing is sent if the lamp is already in this state. It returns an error value (<0) if it fails and 0 (PIXY_RESULT_OK) if it succeeds.
      * @param upper The upper argument controls the two white LEDs along the top edge of Pixy2's PCB.
      * @param lower The lower argument sets the RGB LED, causing it to turn on all three color channels at full brightness, resulting in white light.
      */
@@ -87,6 +87,55 @@ declare namespace pixy2 {
     //% group="General" shim=pixy2::setLamp
     function setLamp(upper: boolean, lower: boolean): int32;
 
+    /**
+     * refreshActuators() sends the last servo positions, LED value, lamp state and camera brightness set through this library to Pixy2 again, even if they haven't changed. Use it if Pixy2 was reset or power cycled behind the library's back.
+     * @returns It returns an error value (<0) if any of them fails and 0 (PIXY_RESULT_OK) if they all succeed.
+     */
+    //% help=pixy2/refresh-actuators
+    //% weight=91 blockGap=8
+    //% block="refresh actuators"
+    //% blockId=pixy2_refresh_actuators
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::refreshActuators
+    function refreshActuators(): int8;
+
+    /**
+     * setServosAsync() sets new target positions for the servos without waiting for Pixy2. The positions are sent in the background at most at the rate set with setServoRate(), and only the latest target is sent, so it's safe to call it from a fast loop.
+     * @param s0 The servo value, clamped to PIXY_RCS_MIN_POS (0)..PIXY_RCS_MAX_POS (1000).
+     * @param s1 The servo value, clamped to PIXY_RCS_MIN_POS (0)..PIXY_RCS_MAX_POS (1000).
+     */
+    //% help=pixy2/set-servos-async
+    //% weight=90 blockGap=8
+    //% block="set servos async %s0 %s1"
+    //% blockId=pixy2_set_servos_async
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::setServosAsync
+    function setServosAsync(s0: int32, s1: int32): void;
+
+    /**
+     * setServoRate() sets how often positions posted with setServosAsync() may be sent to Pixy2.
+     * @param hz The maximum number of servo requests per second, from 1 to 200. Default is 50.
+     */
+    //% help=pixy2/set-servo-rate
+    //% weight=89 blockGap=8
+    //% block="set servo rate %hz"
+    //% blockId=pixy2_set_servo_rate
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::setServoRate
+    function setServoRate(hz: int32): void;
+
+    /**
+     * setServoSlew() limits how fast the positions sent for setServosAsync() move towards the target.
+     * @param unitsPerSecond The maximum change in servo position per second, or 0 (default) to go straight to the target.
+     */
+    //% help=pixy2/set-servo-slew
+    //% weight=88 blockGap=8
+    //% block="set servo slew %unitsPerSecond"
+    //% blockId=pixy2_set_servo_slew
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::setServoSlew
+    function setServoSlew(unitsPerSecond: int32): void;
+
     /**
      * getResolution() gets the width and height of the frames used by the current program.
      * @returns It returns the resolution of the new program containing frameWidth, frameHeight as a string. If it fails, it returns an null.
@@ -111,12 +160,489 @@ declare namespace pixy2 {
     //% group="General" shim=pixy2::getFPS
     function getFPS(): int8;
 
+    /**
+     * getEnabledFeatures() tells which program modules this build was compiled with, see Pixy2Config.h for how to select them.
+     * @returns It returns a bit mask: 1 for color connected components, 2 for line tracking and 4 for video.
+     */
+    //% help=pixy2/get-enabled-features
+    //% weight=81 blockGap=8
+    //% block="get enabled features"
+    //% blockId=pixy2_get_enabled_features
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::getEnabledFeatures
+    function getEnabledFeatures(): int32;
+
+    /**
+     * getRamFootprint() gets the number of bytes of RAM this library takes for the selected modules and buffer size: the Pixy2 object, which includes the packet buffer, and the static state of the shims.
+     * @returns It returns the size in bytes.
+     */
+    //% help=pixy2/get-ram-footprint
+    //% weight=80 blockGap=8
+    //% block="get ram footprint"
+    //% blockId=pixy2_get_ram_footprint
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::getRamFootprint
+    function getRamFootprint(): int32;
+
+    /**
+     * startRecording() starts capturing the traffic with Pixy2 (every request and response, with timestamps) into the trace returned by getRecording(), dropping the previous one. Capturing stops when the trace buffer is full. Only works in builds with PIXY2_ENABLE_RECORD, see Pixy2Config.h.
+     * @returns It returns 0 if recording started, or -1 if this build can't record.
+     */
+    //% help=pixy2/start-recording
+    //% weight=79 blockGap=8
+    //% block="start recording"
+    //% blockId=pixy2_start_recording
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::startRecording
+    function startRecording(): int8;
+
+    /**
+     * stopRecording() stops capturing the traffic with Pixy2. The trace is kept until the next startRecording().
+     */
+    //% help=pixy2/stop-recording
+    //% weight=78 blockGap=8
+    //% block="stop recording"
+    //% blockId=pixy2_stop_recording
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::stopRecording
+    function stopRecording(): void;
+
+    /**
+     * getRecording() gets the trace captured since startRecording(), e.g. to write it to the serial port and replay it on a computer with tools/pixy2replay.
+     * @returns It returns the trace as a buffer, empty if nothing was recorded.
+     */
+    //% help=pixy2/get-recording
+    //% weight=77 blockGap=8
+    //% block="get recording"
+    //% blockId=pixy2_get_recording
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::getRecording
+    function getRecording(): Buffer;
+
+    /**
+     * startTelemetry() starts streaming every frame of blocks, line vectors and barcodes that is fetched from Pixy2 to the serial port, as compact binary records that tools/pixy2telemetry on a computer turns into CSV or JSON. Frames are queued and sent in the background; when the serial port can't keep up, frames are dropped instead of slowing the program down. Don't write anything else to the serial port while streaming. Only works in builds with PIXY2_ENABLE_TELEMETRY, see Pixy2Config.h.
+     * @returns It returns 0 if streaming started, or -1 if this build has no telemetry.
+     */
+    //% help=pixy2/start-telemetry
+    //% weight=76 blockGap=8
+    //% block="start telemetry"
+    //% blockId=pixy2_start_telemetry
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::startTelemetry
+    function startTelemetry(): int8;
+
+    /**
+     * stopTelemetry() stops streaming frames to the serial port.
+     */
+    //% help=pixy2/stop-telemetry
+    //% weight=75 blockGap=8
+    //% block="stop telemetry"
+    //% blockId=pixy2_stop_telemetry
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::stopTelemetry
+    function stopTelemetry(): void;
+
+    /**
+     * getTelemetryDropped() gets the number of frames that weren't streamed since startTelemetry() because the serial port couldn't keep up.
+     * @returns It returns the number of dropped frames.
+     */
+    //% help=pixy2/get-telemetry-dropped
+    //% weight=74 blockGap=8
+    //% block="get telemetry dropped"
+    //% blockId=pixy2_get_telemetry_dropped
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::getTelemetryDropped
+    function getTelemetryDropped(): int32;
+
+    /**
+     * setLinkRetries() sets how many times a request is sent again when the response from Pixy2 is garbled or missing, before it fails. Requests that failed a few times in a row make the next request reconnect to Pixy2 first, which also sets the program and the servos, LEDs and brightness again in case Pixy2 was restarted.
+     * @param retries The number of retries, 0 to 10. Default is 2.
+     */
+    //% help=pixy2/set-link-retries
+    //% weight=73 blockGap=8
+    //% block="set link retries %retries"
+    //% blockId=pixy2_set_link_retries
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::setLinkRetries
+    function setLinkRetries(retries: int32): void;
+
+    /**
+     * getReconnectCount() gets how many times the connection to Pixy2 was lost and recovered, see setLinkRetries().
+     * @returns It returns the number of reconnects.
+     */
+    //% help=pixy2/get-reconnect-count
+    //% weight=72 blockGap=8
+    //% block="get reconnect count"
+    //% blockId=pixy2_get_reconnect_count
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::getReconnectCount
+    function getReconnectCount(): int32;
+
+    /**
+     * setProgramRate() sets how often a program (0 color connected components, 1 line, 2 video) should get its turn. Every program change keeps Pixy2 busy for a while, so once a rate is set, requests are grouped into time slices per program: a request for another program than the one Pixy2 runs waits until the current slice is over (or returns null/busy if it doesn't wait), then the program furthest behind its rate gets the next slice. The slices are sized so that about a quarter of the time goes to changing programs and the rest is shared between the programs in use in proportion to their rates (1 for programs without one). Setting all rates to 0 (default) changes the program for every request straight away.
+     * @param program The program, 0 color connected components, 1 line, 2 video.
+     * @param hz How many requests of the program should be served per second, 0 for no target.
+     * @returns It returns 0, or an error value (<0) if the program is invalid.
+     */
+    //% help=pixy2/set-program-rate
+    //% weight=63 blockGap=8
+    //% block="set program %program rate %hz Hz"
+    //% blockId=pixy2_set_program_rate
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::setProgramRate
+    function setProgramRate(program: int32, hz: int32): int8;
+
+    /**
+     * getProgramChangeStats() gets how much time went to changing programs since clearProgramChangeStats().
+     * @returns It returns the number of program changes, the time they took (ms), that time as a percentage of the time since the statistics were cleared, the time requests waited for their slice (ms), the number of requests turned away because they didn't wait, and the current slice length (ms) as a comma separated string (in that order).
+     */
+    //% help=pixy2/get-program-change-stats
+    //% weight=62 blockGap=8
+    //% block="get program change stats"
+    //% blockId=pixy2_get_program_change_stats
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::getProgramChangeStats
+    function getProgramChangeStats(): string;
+
+    /**
+     * clearProgramChangeStats() starts the statistics of getProgramChangeStats() over.
+     */
+    //% help=pixy2/clear-program-change-stats
+    //% weight=61 blockGap=8
+    //% block="clear program change stats"
+    //% blockId=pixy2_clear_program_change_stats
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::clearProgramChangeStats
+    function clearProgramChangeStats(): void;
+
+    /**
+     * setI2CFrequency() sets the I2C bus frequency. Pixy2 supports up to 400000 Hz; see probeLink() to find the fastest that works with your wiring.
+     * @param hz The frequency in Hz, e.g. 100000, 250000 or 400000.
+     */
+    //% help=pixy2/set-i2c-frequency
+    //% weight=71 blockGap=8
+    //% block="set i2c frequency %hz"
+    //% blockId=pixy2_set_i2c_frequency
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::setI2CFrequency
+    function setI2CFrequency(hz: int32): void;
+
+    /**
+     * setI2CMaxWrite() sets how many bytes of a request are written to Pixy2 at a time. Only changing the program takes requests of more than 16 bytes.
+     * @param bytes The number of bytes, 1 to 255. Default is 16.
+     */
+    //% help=pixy2/set-i2c-max-write
+    //% weight=70 blockGap=8
+    //% block="set i2c max write %bytes"
+    //% blockId=pixy2_set_i2c_max_write
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::setI2CMaxWrite
+    function setI2CMaxWrite(bytes: int32): void;
+
+    /**
+     * setI2CRepeatedStart() sets whether the response of Pixy2 is read with a repeated start right after the request, without releasing the bus in between.
+     * @param on True to use a repeated start, false (default) for a separate write and read.
+     */
+    //% help=pixy2/set-i2c-repeated-start
+    //% weight=69 blockGap=8
+    //% block="set i2c repeated start %on"
+    //% blockId=pixy2_set_i2c_repeated_start
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::setI2CRepeatedStart
+    function setI2CRepeatedStart(on: boolean): void;
+
+    /**
+     * probeLink() tries the I2C bus at 100, 250 and 400 kHz, with and without repeated start, and keeps the fastest setting under which a series of requests to Pixy2 all come back intact. Requests aren't retried while probing, so a setting that only works with retries is rejected. Each setting is timed over 10 pairs of requests.
+     * @returns It returns the chosen frequency in Hz, or -1 if Pixy2 doesn't respond and the settings are left as they were.
+     */
+    //% help=pixy2/probe-link
+    //% weight=68 blockGap=8
+    //% block="probe link"
+    //% blockId=pixy2_probe_link
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::probeLink
+    function probeLink(): int32;
+
+    /**
+     * startSpans() starts timing every phase of the requests to Pixy2 (building and sending the request, waiting for and receiving the response, parsing it and turning it into the result of the block) into a ring of the most recent spans, see getSpansAsText(). The spans kept so far are dropped.
+     * @returns It returns 0, or an error value (<0) if span tracing isn't compiled in (PIXY2_ENABLE_SPANS).
+     */
+    //% help=pixy2/start-spans
+    //% weight=67 blockGap=8
+    //% block="start spans"
+    //% blockId=pixy2_start_spans
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::startSpans
+    function startSpans(): int32;
+
+    /**
+     * stopSpans() stops timing requests, the spans kept so far can still be read.
+     */
+    //% help=pixy2/stop-spans
+    //% weight=66 blockGap=8
+    //% block="stop spans"
+    //% blockId=pixy2_stop_spans
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::stopSpans
+    function stopSpans(): void;
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the last count spans, oldest first, as a buffer of packed Span records (12 bytes each: start and duration in us as UInt32LE, then phase, tag, depth and a reserved byte).
+     */
+    //% shim=pixy2::getSpans
+    function getSpans(count: int32): Buffer;
+
+    /**
+     * getSpansAsText() gets the last spans, oldest first, one per line: the phase, the request type, the nesting depth, the start and the duration in microseconds (-1 if the span hasn't ended). The shim span ends when its result is handed to the program.
+     * @param count The number of spans, e.g. 16.
+     * @returns It returns the spans as text, or an empty string if there are none.
+     */
+    //% help=pixy2/get-spans-as-text
+    //% weight=65 blockGap=8
+    //% block="get spans as text %count"
+    //% blockId=pixy2_get_spans_as_text
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::getSpansAsText
+    function getSpansAsText(count: int32): string;
+
+    /**
+     * benchmarkBlockGeometry() times the block geometry of cccGetBlockGeometry() on a made-up frame of blocks, once with the packed 16-bit DSP instructions and once in plain C. The DSP instructions are only there on the micro:bit v2, on the micro:bit v1 the packed version is emulated and slower.
+     * @param blocks The number of blocks in the frame, 1 to 32, e.g. 32.
+     * @returns It returns the time per frame in microseconds of the packed and the plain version, as "packed,plain".
+     */
+    //% help=pixy2/benchmark-block-geometry
+    //% weight=64 blockGap=8
+    //% block="benchmark block geometry %blocks"
+    //% blockId=pixy2_benchmark_block_geometry
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::benchmarkBlockGeometry
+    function benchmarkBlockGeometry(blocks: int32): string;
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to start the acquisition fiber that raises the detection events, mode 1 watches color connected components and mode 2 line features.
+     */
+    //% shim=pixy2::startEvents
+    function startEvents(mode: uint8): void;
+
+    /**
+     * stopEvents() stops watching for the detections that raise the on signature appeared/disappeared, on intersection, on barcode seen and on vector lost events. Registering a handler for one of them starts watching again.
+     */
+    //% help=pixy2/stop-events
+    //% weight=87 blockGap=8
+    //% block="stop events"
+    //% blockId=pixy2_stop_events
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::stopEvents
+    function stopEvents(): void;
+
+    /**
+     * setEventHoldFrames() sets for how many frames in a row a signature or the line vector has to be missing before it counts as gone (disappeared or lost). Higher values ignore flickering detections but report real losses later.
+     * @param frames The number of frames, 1 or more. Default is 3.
+     */
+    //% help=pixy2/set-event-hold-frames
+    //% weight=86 blockGap=8
+    //% block="set event hold frames %frames"
+    //% blockId=pixy2_set_event_hold_frames
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::setEventHoldFrames
+    function setEventHoldFrames(frames: int32): void;
+
+    /**
+     * startAutoExposure() starts adjusting the camera brightness in the background: it is lowered whenever the frame rate drops below the target, and raised again slowly while the frame rate has headroom. The frame rate is read every half second.
+     * @param targetFps The lowest acceptable frame rate, e.g. 50.
+     */
+    //% help=pixy2/start-auto-exposure
+    //% weight=85 blockGap=8
+    //% block="start auto exposure target fps %targetFps"
+    //% blockId=pixy2_start_auto_exposure
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::startAutoExposure
+    function startAutoExposure(targetFps: int32): void;
+
+    /**
+     * stopAutoExposure() stops the brightness control started with startAutoExposure(). The brightness stays where it is.
+     */
+    //% help=pixy2/stop-auto-exposure
+    //% weight=84 blockGap=8
+    //% block="stop auto exposure"
+    //% blockId=pixy2_stop_auto_exposure
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::stopAutoExposure
+    function stopAutoExposure(): void;
+
+    /**
+     * setAutoExposureLuma() makes the auto exposure also keep the image brightness near a target, measured with a few getRGB samples. getRGB is a video program function, so the samples are only taken while Pixy2 runs the video program for other requests; other programs aren't interrupted for them, and meanwhile only the frame rate is used.
+     * @param target The target luminance, 1 to 255, or 0 (default) to only use the frame rate.
+     */
+    //% help=pixy2/set-auto-exposure-luma
+    //% weight=83 blockGap=8
+    //% block="set auto exposure luma %target"
+    //% blockId=pixy2_set_auto_exposure_luma
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::setAutoExposureLuma
+    function setAutoExposureLuma(target: int32): void;
+
+    /**
+     * getAutoExposureBrightness() gets the camera brightness chosen by the auto exposure.
+     * @returns It returns the current brightness setting.
+     */
+    //% help=pixy2/get-auto-exposure-brightness
+    //% weight=82 blockGap=8
+    //% block="get auto exposure brightness"
+    //% blockId=pixy2_get_auto_exposure_brightness
+    //% parts="pixy2"
+    //% group="General" shim=pixy2::getAutoExposureBrightness
+    function getAutoExposureBrightness(): int32;
+
     /**
      * Internal use only. This function will be used in pixy2.ts to return the blocks of color connected components as a string.
      */
     //% shim=pixy2::cccGetBlocksAsString
     function cccGetBlocksAsString(wait: boolean, sigmap: uint8, maxBlocks: uint8): string;
 
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the decoded color codes of the most recent frame as a buffer of packed ColorCode records.
+     */
+    //% shim=pixy2::cccGetColorCodesAsBuffer
+    function cccGetColorCodesAsBuffer(wait: boolean, maxBlocks: uint8): Buffer;
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the blocks of the most recent frame with their geometry against a reference box as a buffer of packed records: the Block, the area and the squared distance of its center to the center of the box (UInt32LE), the intersection over union with the box in Q14 (UInt16LE), 1 if its center is inside the box, and a reserved byte.
+     */
+    //% shim=pixy2::cccGetBlockGeometryAsBuffer
+    function cccGetBlockGeometryAsBuffer(wait: boolean, sigmap: uint8, maxBlocks: uint8, x: int32, y: int32, width: int32, height: int32): Buffer;
+
+    /**
+     * cccStartHeatmap() starts keeping track of where in the frame each signature shows up, in a grid of 12 x 8 cells per signature (color codes share one grid). Every frame of blocks fetched adds to it, older frames fade out. The heatmap is cleared.
+     * @param frames How many frames the heatmap remembers, the time constant of the fade, rounded to a power of two between 2 and 4096, e.g. 256.
+     * @returns It returns 0, or an error value (<0) if the heatmap isn't compiled in (PIXY2_ENABLE_HEATMAP).
+     */
+    //% help=pixy2/ccc-start-heatmap
+    //% weight=70 blockGap=8
+    //% block="ccc start heatmap remembering %frames frames"
+    //% blockId=pixy2_ccc_start_heatmap
+    //% parts="pixy2"
+    //% group="Color Connected Components" shim=pixy2::cccStartHeatmap
+    function cccStartHeatmap(frames: int32): int32;
+
+    /**
+     * cccStopHeatmap() stops adding frames to the heatmap, it can still be read.
+     */
+    //% help=pixy2/ccc-stop-heatmap
+    //% weight=69 blockGap=8
+    //% block="ccc stop heatmap"
+    //% blockId=pixy2_ccc_stop_heatmap
+    //% parts="pixy2"
+    //% group="Color Connected Components" shim=pixy2::cccStopHeatmap
+    function cccStopHeatmap(): void;
+
+    /**
+     * cccResetHeatmap() clears the heatmap, it keeps running if it was.
+     */
+    //% help=pixy2/ccc-reset-heatmap
+    //% weight=68 blockGap=8
+    //% block="ccc reset heatmap"
+    //% blockId=pixy2_ccc_reset_heatmap
+    //% parts="pixy2"
+    //% group="Color Connected Components" shim=pixy2::cccResetHeatmap
+    function cccResetHeatmap(): void;
+
+    /**
+     * cccGetHeatmap() gets the heatmap of a signature: the number of columns, the number of rows, then a byte per cell, row by row from the top left. A cell is 255 if a block of the signature was in it in every frame (or more than one block on average), less the less often it was.
+     * @param signature The signature, 1 to 7, or 8 for the color codes.
+     * @param normalize [Optional] Scale the cells so that the hottest one is 255, default false.
+     * @returns It returns the heatmap as a buffer, empty if the signature is invalid or the heatmap isn't compiled in.
+     */
+    //% help=pixy2/ccc-get-heatmap
+    //% weight=67 blockGap=8
+    //% block="ccc get heatmap of signature %signature"
+    //% blockId=pixy2_ccc_get_heatmap
+    //% parts="pixy2"
+    //% group="Color Connected Components" normalize.defl=0 shim=pixy2::cccGetHeatmap
+    function cccGetHeatmap(signature: int32, normalize?: boolean): Buffer;
+
+    /**
+     * cccRegisterColorCode() adds a color code to the set that cccGetColorCodes() matches each decoded color code against. Up to 8 codes can be registered.
+     * @param code The color code written as its digits, for example 123 for the color code made of signatures 1, 2 and 3.
+     * @returns It returns the index of the code in the registered set (this is the m_match value reported for it), or an error value (<0) if the code is invalid or the set is full.
+     */
+    //% help=pixy2/ccc-register-color-code
+    //% weight=80 blockGap=8
+    //% block="ccc register color code %code"
+    //% blockId=pixy2_ccc_register_color_code
+    //% parts="pixy2"
+    //% group="Color Connected Components" shim=pixy2::cccRegisterColorCode
+    function cccRegisterColorCode(code: int32): int8;
+
+    /**
+     * cccClearColorCodes() removes all registered color codes.
+     */
+    //% help=pixy2/ccc-clear-color-codes
+    //% weight=79 blockGap=8
+    //% block="ccc clear color codes"
+    //% blockId=pixy2_ccc_clear_color_codes
+    //% parts="pixy2"
+    //% group="Color Connected Components" shim=pixy2::cccClearColorCodes
+    function cccClearColorCodes(): void;
+
+    /**
+     * cccRetarget() makes the tracker drop the block it follows and pick the largest block of a signature instead.
+     * @param signature The signature to track, 1 to 7, or a color code written as its digits (e.g. 123). 0 tracks the largest block of any signature.
+     * @returns It returns 0 (PIXY_RESULT_OK) if it succeeds, or -1 (PIXY_RESULT_ERROR) if the signature is invalid.
+     */
+    //% help=pixy2/ccc-retarget
+    //% weight=76 blockGap=8
+    //% block="ccc retarget signature %signature"
+    //% blockId=pixy2_ccc_retarget
+    //% parts="pixy2"
+    //% group="Color Connected Components" shim=pixy2::cccRetarget
+    function cccRetarget(signature: int32): int8;
+
+    /**
+     * cccStartTracking() starts a background tracker that moves the pan-tilt servos (pan on servo 0, tilt on servo 1) to keep a block in the middle of the frame. It runs on its own at the camera frame rate, nothing has to be called in a loop.
+     * @param signature The signature to track, 1 to 7, or a color code written as its digits (e.g. 123). 0 tracks the largest block of any signature.
+     * @returns It returns 0 (PIXY_RESULT_OK) if it succeeds, or -1 (PIXY_RESULT_ERROR) if the signature is invalid.
+     */
+    //% help=pixy2/ccc-start-tracking
+    //% weight=78 blockGap=8
+    //% block="ccc start tracking signature %signature"
+    //% blockId=pixy2_ccc_start_tracking
+    //% parts="pixy2"
+    //% group="Color Connected Components" shim=pixy2::cccStartTracking
+    function cccStartTracking(signature: int32): int8;
+
+    /**
+     * cccStopTracking() stops the tracker started with cccStartTracking(). The servos stay where they are.
+     */
+    //% help=pixy2/ccc-stop-tracking
+    //% weight=77 blockGap=8
+    //% block="ccc stop tracking"
+    //% blockId=pixy2_ccc_stop_tracking
+    //% parts="pixy2"
+    //% group="Color Connected Components" shim=pixy2::cccStopTracking
+    function cccStopTracking(): void;
+
+    /**
+     * cccSetTrackingGains() sets the gains of the tracker's servo loops. Each loop adds (p * error + d * change of error) / 1024 to the servo position every frame, with the error in pixels. The defaults are 400, 400 for pan and 500, 500 for tilt. Use negative gains if a servo is mounted the other way round.
+     * @param panP Proportional gain of the pan loop.
+     * @param panD Derivative gain of the pan loop.
+     * @param tiltP Proportional gain of the tilt loop.
+     * @param tiltD Derivative gain of the tilt loop.
+     */
+    //% help=pixy2/ccc-set-tracking-gains
+    //% weight=75 blockGap=8
+    //% block="ccc set tracking gains pan p %panP d %panD tilt p %tiltP d %tiltD"
+    //% blockId=pixy2_ccc_set_tracking_gains
+    //% parts="pixy2"
+    //% group="Color Connected Components" shim=pixy2::cccSetTrackingGains
+    function cccSetTrackingGains(panP: int32, panD: int32, tiltP: int32, tiltD: int32): void;
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the state of the tracker as an object
+     */
+    //% shim=pixy2::cccGetTrackingStatusAsBuffer
+    function cccGetTrackingStatusAsBuffer(): Buffer;
+
     /**
      * Internal use only. This function will be used in pixy2.ts to return the main features of line tracking as a string.
      */
@@ -129,6 +655,120 @@ declare namespace pixy2 {
     //% features.defl=0x07 wait.defl=1 shim=pixy2::lineGetAllFeaturesAsString
     function lineGetAllFeaturesAsString(features?: uint8, wait?: boolean): string;
 
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the line features that were added, removed or moved since the previous call as a buffer of change records.
+     */
+    //% features.defl=0x07 wait.defl=1 shim=pixy2::lineGetFeatureChangesAsBuffer
+    function lineGetFeatureChangesAsBuffer(features?: uint8, wait?: boolean): Buffer;
+
+    /**
+     * lineSetChangeThreshold() sets how far (in pixels) a line feature has to move before lineGetFeatureChanges() reports it as moved.
+     * @param threshold The movement threshold in pixels. The default is 2.
+     */
+    //% help=pixy2/line-set-change-threshold
+    //% weight=82 blockGap=8
+    //% block="line set change threshold %threshold"
+    //% blockId=pixy2_line_set_change_threshold
+    //% parts="pixy2"
+    //% group="Line Tracking" shim=pixy2::lineSetChangeThreshold
+    function lineSetChangeThreshold(threshold: uint8): void;
+
+    /**
+     * lineResetChanges() forgets the previous frame, so that the next call to lineGetFeatureChanges() reports every feature as added.
+     */
+    //% help=pixy2/line-reset-changes
+    //% weight=81 blockGap=8
+    //% block="line reset changes"
+    //% blockId=pixy2_line_reset_changes
+    //% parts="pixy2"
+    //% group="Line Tracking" shim=pixy2::lineResetChanges
+    function lineResetChanges(): void;
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the steering computed from the main vector as a buffer: heading error, offset error and output (int16 each), followed by a valid flag.
+     */
+    //% wait.defl=1 shim=pixy2::lineGetSteeringAsBuffer
+    function lineGetSteeringAsBuffer(wait?: boolean): Buffer;
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the estimate of the line ahead as a buffer holding a packed LineLookahead record.
+     */
+    //% wait.defl=1 shim=pixy2::lineGetLookaheadAsBuffer
+    function lineGetLookaheadAsBuffer(wait?: boolean): Buffer;
+
+    /**
+     * lineSetLookahead() sets how far ahead lineGetLookahead() predicts the line, and the speed of the robot it works out the curvature with.
+     * @param ms How far ahead to predict, in milliseconds, 0 to 2000. Default is 200.
+     * @param speed [Optional] The speed of the robot in mm/s, 0 (default) if it isn't known, the curvature is 0 then.
+     */
+    //% help=pixy2/line-set-lookahead
+    //% weight=66 blockGap=8
+    //% block="line set lookahead %ms ms speed %speed mm/s"
+    //% blockId=pixy2_line_set_lookahead
+    //% parts="pixy2"
+    //% group="Line Tracking" speed.defl=0 shim=pixy2::lineSetLookahead
+    function lineSetLookahead(ms: int32, speed?: int32): void;
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to set the steering PID gains, scaled by 256.
+     */
+    //% shim=pixy2::lineSetSteeringGainsQ8
+    function lineSetSteeringGainsQ8(kp: int32, ki: int32, kd: int32): void;
+
+    /**
+     * lineSetSteeringMix() sets how the steering error is made up from the offset of the line from the frame center and the heading of the line.
+     * @param headingPercent 0 (default) steers on the offset of the vector head only, 100 steers on the heading of the vector only, values in between blend the two.
+     */
+    //% help=pixy2/line-set-steering-mix
+    //% weight=79 blockGap=8
+    //% block="line set steering mix %headingPercent"
+    //% blockId=pixy2_line_set_steering_mix
+    //% parts="pixy2"
+    //% group="Line Tracking" shim=pixy2::lineSetSteeringMix
+    function lineSetSteeringMix(headingPercent: uint8): void;
+
+    /**
+     * lineSetSteeringLimit() sets the largest motor differential the steering PID will output.
+     * @param limit The output is clamped to -limit..limit. The default is 255.
+     */
+    //% help=pixy2/line-set-steering-limit
+    //% weight=78 blockGap=8
+    //% block="line set steering limit %limit"
+    //% blockId=pixy2_line_set_steering_limit
+    //% parts="pixy2"
+    //% group="Line Tracking" shim=pixy2::lineSetSteeringLimit
+    function lineSetSteeringLimit(limit: int16): void;
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the recent barcode sightings, oldest first, as a buffer of packed BarcodeSighting records.
+     */
+    //% shim=pixy2::lineGetBarcodeHistoryAsBuffer
+    function lineGetBarcodeHistoryAsBuffer(): Buffer;
+
+    /**
+     * lineSetBarcodeVoting() sets how many times a barcode has to be seen before it is confirmed and the barcode event is raised. Barcodes are only seen repeatedly when features are fetched with getAllFeatures().
+     * @param votes The number of sightings needed, from 1 to 16. The default is 3.
+     * @param window The sightings have to happen within this many milliseconds. A confirmed barcode is confirmed again only after it has been out of sight for this long. The default is 500.
+     */
+    //% help=pixy2/line-set-barcode-voting
+    //% weight=74 blockGap=8
+    //% block="line set barcode voting %votes|within %window ms"
+    //% blockId=pixy2_line_set_barcode_voting
+    //% parts="pixy2"
+    //% group="Line Tracking" shim=pixy2::lineSetBarcodeVoting
+    function lineSetBarcodeVoting(votes: uint8, window: uint16): void;
+
+    /**
+     * lineClearBarcodeHistory() forgets all barcode sightings and confirmations.
+     */
+    //% help=pixy2/line-clear-barcode-history
+    //% weight=73 blockGap=8
+    //% block="line clear barcode history"
+    //% blockId=pixy2_line_clear_barcode_history
+    //% parts="pixy2"
+    //% group="Line Tracking" shim=pixy2::lineClearBarcodeHistory
+    function lineClearBarcodeHistory(): void;
+
     /**
      * lineSetMode() function sets various modes in the line tracking algorithm
      * @param mode The mode argument consists of a bitwise-ORing of the following bits:
@@ -174,6 +814,77 @@ declare namespace pixy2 {
     //% group="Line Tracking" shim=pixy2::lineSetDefaultTurn
     function lineSetDefaultTurn(angle: int16): int8;
 
+    /**
+     * linePlanTurn() appends a turn angle to the route plan. The planned turns are sent to Pixy2 natively, one per intersection and in order, as the main line features are fetched (getMainFeatures(), intersections seen by getAllFeatures() don't count), so the next turn is always set well before the robot reaches the intersection and no TS code has to react to it.
+     * @param angle Turn angle in degrees, with 0 being straight ahead, left being 90 and right being -90. Valid angles are between -180 and 180.
+     * @returns It returns 0 if it succeeds, or -1 if the plan is full (16 turns).
+     */
+    //% help=pixy2/line-plan-turn
+    //% weight=77 blockGap=8
+    //% block="line plan turn %angle"
+    //% blockId=pixy2_line_plan_turn
+    //% parts="pixy2"
+    //% group="Line Tracking" shim=pixy2::linePlanTurn
+    function linePlanTurn(angle: int16): int8;
+
+    /**
+     * lineClearPlan() removes all planned turns. A turn that was already sent to Pixy2 will still be taken at the next intersection unless lineSetNextTurn() overrides it.
+     */
+    //% help=pixy2/line-clear-plan
+    //% weight=76 blockGap=8
+    //% block="line clear plan"
+    //% blockId=pixy2_line_clear_plan
+    //% parts="pixy2"
+    //% group="Line Tracking" shim=pixy2::lineClearPlan
+    function lineClearPlan(): void;
+
+    /**
+     * linePlannedTurns() gets the number of planned turns that haven't been taken yet, including the one armed for the next intersection.
+     */
+    //% help=pixy2/line-planned-turns
+    //% weight=75 blockGap=8
+    //% block="line planned turns"
+    //% blockId=pixy2_line_planned_turns
+    //% parts="pixy2"
+    //% group="Line Tracking" shim=pixy2::linePlannedTurns
+    function linePlannedTurns(): uint8;
+
+    /**
+     * lineMapSetGoal() sets the intersection the line map plans the way to, by the barcode in front of it. While the robot drives the intersections it passes are mapped natively, and once the way from the intersection ahead to the goal is known the turn there is sent to Pixy2 before the robot gets to it. Planned turns (linePlanTurn()) come first.
+     * @param barcode The barcode of the goal, 0 to 15, or -1 for no goal.
+     * @returns It returns 0, or an error value (<0) if the barcode is invalid or the map isn't compiled in (PIXY2_ENABLE_LINE_MAP).
+     */
+    //% help=pixy2/line-map-set-goal
+    //% weight=65 blockGap=8
+    //% block="line map set goal %barcode"
+    //% blockId=pixy2_line_map_set_goal
+    //% parts="pixy2"
+    //% group="Line Tracking" shim=pixy2::lineMapSetGoal
+    function lineMapSetGoal(barcode: int32): int8;
+
+    /**
+     * lineMapReset() forgets all mapped intersections, for example when the robot is put down somewhere else. The goal stays.
+     */
+    //% help=pixy2/line-map-reset
+    //% weight=64 blockGap=8
+    //% block="line map reset"
+    //% blockId=pixy2_line_map_reset
+    //% parts="pixy2"
+    //% group="Line Tracking" shim=pixy2::lineMapReset
+    function lineMapReset(): void;
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the state of the line map as a buffer holding a packed LineMapStatus record.
+     */
+    //% shim=pixy2::lineMapGetStatusAsBuffer
+    function lineMapGetStatusAsBuffer(): Buffer;
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the mapped intersections as a buffer of packed LineMapNode records.
+     */
+    //% shim=pixy2::lineMapGetNodesAsBuffer
+    function lineMapGetNodesAsBuffer(): Buffer;
+
     /**
      * If the LINE_MODE_MANUAL_SELECT_VECTOR mode bit is set, the line tracking algorithm will no longer choose the Vector automatically. Instead, lineSetVector() will set the Vector by providing the index of the line.
      * @param index The index of the line to set as the Vector.
@@ -204,6 +915,76 @@ declare namespace pixy2 {
      */
     //% saturate.defl=1 shim=pixy2::videoGetRGBAsString
     function videoGetRGBAsString(x: uint16, y: uint16, saturate?: boolean): string;
+
+    /**
+     * videoGetRGBPoints() samples many pixels in one call. It switches to the video program once and sends the getRGB requests back to back, reusing one request buffer, which is much faster than calling videoGetRGB() for every point.
+     * @param points A buffer of points, each an x and a y value stored as UInt16LE (4 bytes per point). At most 255 points are sampled.
+     * @param saturate [Optional] Scale each sample so that its greatest component is 255 (default), see videoGetRGB().
+     * @returns It returns a buffer with 3 bytes (r, g, b) per sample, in the order of the points. It is shorter than that if a request failed, and null if the video program couldn't be started.
+     */
+    //% saturate.defl=1 shim=pixy2::videoGetRGBPoints
+    function videoGetRGBPoints(points: Buffer, saturate?: boolean): Buffer;
+
+    /**
+     * videoGetRGBGrid() samples a grid of pixels in one call, row by row starting at the top left. It is much faster than calling videoGetRGB() for every point.
+     * @param x The x location of the first (top left) sample.
+     * @param y The y location of the first (top left) sample.
+     * @param dx The horizontal distance between samples.
+     * @param dy The vertical distance between samples.
+     * @param cols The number of samples per row.
+     * @param rows The number of rows. cols * rows can be at most 255.
+     * @param saturate [Optional] Scale each sample so that its greatest component is 255 (default), see videoGetRGB().
+     * @returns It returns a buffer with 3 bytes (r, g, b) per sample. It is shorter than that if a request failed, and null if the video program couldn't be started or the grid is too large.
+     */
+    //% saturate.defl=1 shim=pixy2::videoGetRGBGrid
+    function videoGetRGBGrid(x: uint16, y: uint16, dx: uint16, dy: uint16, cols: uint8, rows: uint8, saturate?: boolean): Buffer;
+
+    /**
+     * videoBeginThumbnail() starts a new low resolution thumbnail of the camera image. The thumbnail is sampled with videoScanThumbnail(), one getRGB sample per pixel.
+     * @param width The width of the thumbnail in pixels, e.g. 16.
+     * @param height The height of the thumbnail in pixels, e.g. 12.
+     * @param format 0 for RGB565 (2 bytes per pixel, little endian), 1 for RGB332 (1 byte per pixel). The thumbnail can be at most 384 bytes.
+     * @param interlaced If true, pixels are sampled coarse to fine so that a partly scanned thumbnail is already a usable low detail image. If false, pixels are sampled row by row.
+     * @returns It returns 0 if it succeeds, or -1 if the thumbnail is too large.
+     */
+    //% help=pixy2/video-begin-thumbnail
+    //% weight=81 blockGap=8
+    //% block="video begin thumbnail %width|x %height|format %format|interlaced %interlaced"
+    //% blockId=pixy2_video_begin_thumbnail
+    //% parts="pixy2"
+    //% group="Video" shim=pixy2::videoBeginThumbnail
+    function videoBeginThumbnail(width: uint8, height: uint8, format: uint8, interlaced: boolean): int8;
+
+    /**
+     * videoScanThumbnail() takes more samples for the thumbnail started with videoBeginThumbnail(). Spreading the scan over several calls keeps each call short.
+     * @param maxSamples The maximum number of samples to take in this call.
+     * @returns It returns the number of pixels still to be sampled (0 once the thumbnail is complete), or -1 if the video program couldn't be started.
+     */
+    //% help=pixy2/video-scan-thumbnail
+    //% weight=80 blockGap=8
+    //% block="video scan thumbnail %maxSamples"
+    //% blockId=pixy2_video_scan_thumbnail
+    //% parts="pixy2"
+    //% group="Video" shim=pixy2::videoScanThumbnail
+    function videoScanThumbnail(maxSamples: int32): int32;
+
+    /**
+     * videoGetThumbnail() gets the pixels of the thumbnail, row by row from the top left. Pixels that haven't been sampled yet are filled in from the nearest coarser sample when scanning interlaced, and 0 otherwise.
+     * @returns It returns a buffer of width * height pixels in the format given to videoBeginThumbnail().
+     */
+    //% help=pixy2/video-get-thumbnail
+    //% weight=79 blockGap=8
+    //% block="video get thumbnail"
+    //% blockId=pixy2_video_get_thumbnail
+    //% parts="pixy2"
+    //% group="Video" shim=pixy2::videoGetThumbnail
+    function videoGetThumbnail(): Buffer;
+
+    /**
+     * Internal use only. This function will be used in pixy2.ts to return the color summary of a region as a buffer holding a packed ColorSummary record (16 bytes).
+     */
+    //% shim=pixy2::videoGetColorSummaryAsBuffer
+    function videoGetColorSummaryAsBuffer(x: uint16, y: uint16, width: uint16, height: uint16, cols: uint8, rows: uint8, mode: uint8): Buffer;
 }
 
 // Auto-generated. Do not edit. Really.
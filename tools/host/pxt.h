@@ -0,0 +1,53 @@
+//
+// Stand-in for the pxt.h of the micro:bit runtime, just enough of it to
+// compile TPixy2 and its modules on a desktop host for the tools in this
+// directory.  Events are dropped and time is the host's monotonic clock.
+//
+
+#ifndef _PIXY2_HOST_PXT_H
+#define _PIXY2_HOST_PXT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+inline uint64_t host_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+inline unsigned long current_time_ms()
+{
+    return host_time_us() / 1000;
+}
+
+inline unsigned long system_timer_current_time_us()
+{
+    return host_time_us();
+}
+
+inline void sleep_us(uint64_t us)
+{
+    struct timespec ts;
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    nanosleep(&ts, NULL);
+}
+
+// There's only one fiber on the host
+inline void fiber_sleep(unsigned long ms)
+{
+    sleep_us((uint64_t)ms * 1000);
+}
+
+struct MicroBitEvent
+{
+    MicroBitEvent(uint16_t source, uint16_t value)
+    {
+    }
+};
+
+#endif
@@ -0,0 +1,166 @@
+//
+// Checks the packed block geometry kernels of Pixy2Geometry.h against the
+// scalar ones on random frames and edge cases, then times both.  Exits with
+// 1 if they differ.
+//
+// Build from the root of the extension:
+//
+//     g++ -std=c++11 -O2 -Itools/host -I. tools/pixy2geometry.cpp -o pixy2geometry
+//     ./pixy2geometry
+//
+// On an x86 host the packed instructions are emulated in C, so this checks
+// the kernels but the timing says nothing about the micro:bit.  On an ARMv7
+// Linux host (e.g. a Raspberry Pi running a 32-bit system) the compiler has
+// the DSP extension and the real instructions are checked and timed.  The
+// speedup on the micro:bit v2 itself is measured by benchmarkBlockGeometry().
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "TPixy2.h"
+
+#define FRAMES 20000
+#define MAX_BLOCKS 64
+#define TIMING_ROUNDS 200000
+
+static uint32_t s_seed = 1;
+
+static uint32_t rnd(uint32_t n)
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return (s_seed >> 8) % n;
+}
+
+static int32_t coord()
+{
+    // mostly on screen, sometimes at the limits
+    switch (rnd(8))
+    {
+    case 0:
+        return -PIXY_GEOMETRY_COORD_LIMIT;
+    case 1:
+        return PIXY_GEOMETRY_COORD_LIMIT;
+    default:
+        return (int32_t)rnd(400) - 40;
+    }
+}
+
+static void randomFrame(Block *blocks, uint8_t n)
+{
+    uint8_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        blocks[i].m_signature = 1 + rnd(7);
+        blocks[i].m_x = rnd(317);
+        blocks[i].m_y = rnd(209);
+        // zero sizes and whole frame boxes too
+        blocks[i].m_width = rnd(4) ? rnd(317) : (rnd(2) ? 0 : 316);
+        blocks[i].m_height = rnd(4) ? rnd(209) : (rnd(2) ? 0 : 208);
+        blocks[i].m_angle = 0;
+        blocks[i].m_index = i;
+        blocks[i].m_age = rnd(256);
+    }
+}
+
+static uint32_t s_errors = 0;
+
+template <class T>
+static void expect(const char *kernel, const T *packed, const T *scalar, uint8_t n)
+{
+    uint8_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (packed[i] != scalar[i] && s_errors++ < 10)
+            printf("%s differs at block %u: packed %lu scalar %lu\n", kernel, i, (unsigned long)packed[i], (unsigned long)scalar[i]);
+    }
+}
+
+static void check(const Block *blocks, uint8_t n)
+{
+    uint32_t a[MAX_BLOCKS], b[MAX_BLOCKS], maskA[MAX_BLOCKS / 32], maskB[MAX_BLOCKS / 32];
+    uint16_t ia[MAX_BLOCKS], ib[MAX_BLOCKS];
+    int16_t x, y, left, top, right, bottom;
+    uint16_t width, height;
+
+    pixyBlockAreasPacked(blocks, n, a);
+    pixyBlockAreasScalar(blocks, n, b);
+    expect("areas", a, b, n);
+
+    x = pixyClampCoord(coord());
+    y = pixyClampCoord(coord());
+    pixyBlockDistancesPacked(blocks, n, x, y, a);
+    pixyBlockDistancesScalar(blocks, n, x, y, b);
+    expect("distances", a, b, n);
+
+    width = rnd(8) ? rnd(400) : 2 * PIXY_GEOMETRY_COORD_LIMIT;
+    height = rnd(8) ? rnd(300) : 2 * PIXY_GEOMETRY_COORD_LIMIT;
+    pixyBlockIoUsPacked(blocks, n, x, y, width, height, ia);
+    pixyBlockIoUsScalar(blocks, n, x, y, width, height, ib);
+    expect("IoUs", ia, ib, n);
+
+    left = pixyClampCoord(coord());
+    top = pixyClampCoord(coord());
+    right = pixyClampCoord(coord());
+    bottom = pixyClampCoord(coord());
+    pixyBlockInRegionPacked(blocks, n, left, top, right, bottom, maskA);
+    pixyBlockInRegionScalar(blocks, n, left, top, right, bottom, maskB);
+    expect("region mask", maskA, maskB, (n + 31) / 32);
+}
+
+// ns per frame of all four kernels
+static double timeKernels(bool packed, const Block *blocks, uint8_t n)
+{
+    uint32_t areas[MAX_BLOCKS], dist2[MAX_BLOCKS], mask[MAX_BLOCKS / 32];
+    uint16_t iou[MAX_BLOCKS];
+    volatile uint32_t sink = 0;
+    uint32_t r;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (r = 0; r < TIMING_ROUNDS; r++)
+    {
+        if (packed)
+        {
+            pixyBlockAreasPacked(blocks, n, areas);
+            pixyBlockDistancesPacked(blocks, n, 158, 104, dist2);
+            pixyBlockIoUsPacked(blocks, n, 158, 104, 80, 60, iou);
+            pixyBlockInRegionPacked(blocks, n, 40, 30, 275, 177, mask);
+        }
+        else
+        {
+            pixyBlockAreasScalar(blocks, n, areas);
+            pixyBlockDistancesScalar(blocks, n, 158, 104, dist2);
+            pixyBlockIoUsScalar(blocks, n, 158, 104, 80, 60, iou);
+            pixyBlockInRegionScalar(blocks, n, 40, 30, 275, 177, mask);
+        }
+        sink = sink + areas[r % n] + dist2[r % n] + iou[r % n] + mask[0];
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / (double)TIMING_ROUNDS;
+}
+
+int main()
+{
+    Block blocks[MAX_BLOCKS];
+    double packed, scalar;
+    uint32_t f;
+    uint8_t n;
+
+    for (f = 0; f < FRAMES; f++)
+    {
+        n = 1 + rnd(MAX_BLOCKS);
+        randomFrame(blocks, n);
+        check(blocks, n);
+    }
+    printf("%u frames checked, %u differences (packed instructions %s)\n", FRAMES, s_errors,
+           PIXY2_GEOMETRY_DSP ? "native" : "emulated");
+
+    randomFrame(blocks, 32);
+    packed = timeKernels(true, blocks, 32);
+    scalar = timeKernels(false, blocks, 32);
+    printf("32 blocks: packed %.0f ns/frame, scalar %.0f ns/frame, speedup %.2fx\n", packed, scalar, scalar / packed);
+    return s_errors ? 1 : 0;
+}
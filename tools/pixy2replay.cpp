@@ -0,0 +1,273 @@
+//
+// Replays a Pixy2 link trace (see Pixy2LinkTrace.h) through TPixy2 on a
+// desktop host.  Every request found in the trace is made again with the
+// same arguments through a TPixy2 on a Link2Replay, so the library parses
+// exactly the responses Pixy sent on the device.  Prints, per request type,
+// how often it was made, how many failed, the bus time on the device and the
+// time the library took on the host; exits with 1 if the library's requests
+// didn't match the trace.
+//
+// Build from the root of the extension:
+//
+//     g++ -std=c++11 -O2 -Itools/host -I. tools/pixy2replay.cpp -o pixy2replay
+//
+// and run with the buffer returned by getRecording(), saved to a file:
+//
+//     ./pixy2replay trace.bin
+//
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "TPixy2.h"
+#include "Pixy2LinkTrace.h"
+
+typedef TPixy2Sized<Link2Replay> Pixy2Replay;
+
+struct RequestStats
+{
+    const char *name;
+    uint32_t count;
+    uint32_t failed;
+    uint64_t deviceUs; // bus time on the device, from the trace
+    uint64_t hostNs;
+};
+
+static RequestStats stats[] = {
+    {"init", 0, 0, 0, 0},
+    {"getVersion", 0, 0, 0, 0},
+    {"getResolution", 0, 0, 0, 0},
+    {"changeProg", 0, 0, 0, 0},
+    {"getFPS", 0, 0, 0, 0},
+    {"setCameraBrightness", 0, 0, 0, 0},
+    {"setServos", 0, 0, 0, 0},
+    {"setLED", 0, 0, 0, 0},
+    {"setLamp", 0, 0, 0, 0},
+    {"getBlocks", 0, 0, 0, 0},
+    {"getFeatures", 0, 0, 0, 0},
+    {"setMode", 0, 0, 0, 0},
+    {"setVector", 0, 0, 0, 0},
+    {"setNextTurn", 0, 0, 0, 0},
+    {"setDefaultTurn", 0, 0, 0, 0},
+    {"reverseVector", 0, 0, 0, 0},
+    {"getRGB", 0, 0, 0, 0},
+    {"unknown", 0, 0, 0, 0},
+};
+
+enum
+{
+    REQ_INIT,
+    REQ_VERSION,
+    REQ_RESOLUTION,
+    REQ_CHANGE_PROG,
+    REQ_FPS,
+    REQ_BRIGHTNESS,
+    REQ_SERVOS,
+    REQ_LED,
+    REQ_LAMP,
+    REQ_BLOCKS,
+    REQ_FEATURES,
+    REQ_SET_MODE,
+    REQ_SET_VECTOR,
+    REQ_NEXT_TURN,
+    REQ_DEFAULT_TURN,
+    REQ_REVERSE_VECTOR,
+    REQ_RGB,
+    REQ_UNKNOWN,
+    REQ_COUNT
+};
+
+static uint16_t u16(const uint8_t *p)
+{
+    return p[0] | (uint16_t)p[1] << 8;
+}
+
+// Skip the records of a request the library doesn't know, up to the next request
+static void skipRequest(Pixy2LinkTrace *trace)
+{
+    LinkRecord rec;
+
+    trace->next(&rec);
+    while (trace->peek(&rec) && rec.m_op == PIXY_LINK_RECV)
+        trace->next(&rec);
+}
+
+// Make the request that starts with rec again, returns the request kind
+static int replay(Pixy2Replay *pixy, Pixy2LinkTrace *trace, const LinkRecord &rec, int8_t *res)
+{
+    const uint8_t *req = rec.m_data + PIXY_SEND_HEADER_SIZE;
+    uint8_t r, g, b, n;
+    char prog[PIXY_MAX_PROGNAME + 1];
+
+    if (rec.m_op == PIXY_LINK_OPEN)
+    {
+        *res = pixy->init(rec.m_data[0] | (uint32_t)rec.m_data[1] << 8 | (uint32_t)rec.m_data[2] << 16 | (uint32_t)rec.m_data[3] << 24);
+        return REQ_INIT;
+    }
+    if (rec.m_len < PIXY_SEND_HEADER_SIZE || rec.m_len != PIXY_SEND_HEADER_SIZE + rec.m_data[3])
+    {
+        skipRequest(trace);
+        *res = PIXY_RESULT_ERROR;
+        return REQ_UNKNOWN;
+    }
+
+    switch (rec.m_data[2])
+    {
+    case PIXY_TYPE_REQUEST_VERSION:
+        *res = pixy->getVersion();
+        return REQ_VERSION;
+    case PIXY_TYPE_REQUEST_RESOLUTION:
+        *res = pixy->getResolution();
+        return REQ_RESOLUTION;
+    case PIXY_TYPE_REQUEST_CHANGE_PROG:
+        n = rec.m_data[3] < PIXY_MAX_PROGNAME ? rec.m_data[3] : PIXY_MAX_PROGNAME;
+        memcpy(prog, req, n);
+        prog[n] = '\0';
+        *res = pixy->changeProg(prog);
+        return REQ_CHANGE_PROG;
+    case PIXY_TYPE_REQUEST_FPS:
+        *res = pixy->getFPS();
+        return REQ_FPS;
+    // the actuator setters are forced, the trace has the request so it wasn't skipped
+    case PIXY_TYPE_REQUEST_BRIGHTNESS:
+        *res = pixy->setCameraBrightness(req[0], true);
+        return REQ_BRIGHTNESS;
+    case PIXY_TYPE_REQUEST_SERVO:
+        *res = pixy->setServos(u16(req), u16(req + 2), true);
+        return REQ_SERVOS;
+    case PIXY_TYPE_REQUEST_LED:
+        *res = pixy->setLED(req[0], req[1], req[2], true);
+        return REQ_LED;
+    case PIXY_TYPE_REQUEST_LAMP:
+        *res = pixy->setLamp(req[0], req[1], true);
+        return REQ_LAMP;
+#if PIXY2_ENABLE_CCC
+    // don't wait, a busy response followed by another request is in the trace as such
+    case CCC_REQUEST_BLOCKS:
+        *res = pixy->ccc.getBlocks(false, req[0], req[1]);
+        return REQ_BLOCKS;
+#endif
+#if PIXY2_ENABLE_LINE
+    case LINE_REQUEST_GET_FEATURES:
+        if (req[0] == LINE_GET_ALL_FEATURES)
+            *res = pixy->line.getAllFeatures(req[1], false);
+        else
+            *res = pixy->line.getMainFeatures(req[1], false);
+        return REQ_FEATURES;
+    case LINE_REQUEST_SET_MODE:
+        *res = pixy->line.setMode(req[0]);
+        return REQ_SET_MODE;
+    case LINE_REQUEST_SET_VECTOR:
+        *res = pixy->line.setVector(req[0]);
+        return REQ_SET_VECTOR;
+    case LINE_REQUEST_SET_NEXT_TURN_ANGLE:
+        *res = pixy->line.setNextTurn((int16_t)u16(req));
+        return REQ_NEXT_TURN;
+    case LINE_REQUEST_SET_DEFAULT_TURN_ANGLE:
+        *res = pixy->line.setDefaultTurn((int16_t)u16(req));
+        return REQ_DEFAULT_TURN;
+    case LINE_REQUEST_REVERSE_VECTOR:
+        *res = pixy->line.reverseVector();
+        return REQ_REVERSE_VECTOR;
+#endif
+#if PIXY2_ENABLE_VIDEO
+    case VIDEO_REQUEST_GET_RGB:
+        *res = pixy->video.getRGB(u16(req), u16(req + 2), &r, &g, &b, req[4]);
+        return REQ_RGB;
+#endif
+    default:
+        skipRequest(trace);
+        *res = PIXY_RESULT_ERROR;
+        return REQ_UNKNOWN;
+    }
+}
+
+// Bus time on the device of the records up to position to, the dt of a
+// record is the time before it so the first one is left out
+static uint64_t deviceTime(Pixy2LinkTrace scan, uint32_t to)
+{
+    LinkRecord rec;
+    uint64_t us = 0;
+    bool first = true;
+
+    while (scan.position() < to && scan.next(&rec))
+    {
+        if (!first)
+            us += rec.m_dt;
+        first = false;
+    }
+    return us;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *f;
+    std::vector<uint8_t> buf;
+    uint8_t chunk[512];
+    size_t n;
+    LinkRecord rec;
+    uint32_t from;
+    int kind, i;
+    int8_t res;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s trace.bin\n", argv[0]);
+        return 2;
+    }
+    f = fopen(argv[1], "rb");
+    if (!f)
+    {
+        perror(argv[1]);
+        return 2;
+    }
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        buf.insert(buf.end(), chunk, chunk + n);
+    fclose(f);
+
+    Pixy2LinkTrace trace(buf.data(), buf.size());
+    if (trace.startReplay(buf.size()) < 0)
+    {
+        fprintf(stderr, "%s: not a Pixy2 link trace\n", argv[1]);
+        return 2;
+    }
+
+    // static, TPixy2Sized embeds its buffer
+    static Pixy2Replay pixy;
+    pixy.m_link.trace = &trace;
+
+    while (trace.peek(&rec))
+    {
+        if (rec.m_op == PIXY_LINK_CLOSE || rec.m_op == PIXY_LINK_RECV)
+        {
+            // a close, or a response nobody asked for
+            trace.next(&rec);
+            continue;
+        }
+        Pixy2LinkTrace start = trace;
+        from = trace.position();
+        auto t0 = std::chrono::steady_clock::now();
+        kind = replay(&pixy, &trace, rec, &res);
+        auto t1 = std::chrono::steady_clock::now();
+        stats[kind].count++;
+        if (res < 0 && res != PIXY_RESULT_BUSY)
+            stats[kind].failed++;
+        stats[kind].deviceUs += deviceTime(start, trace.position());
+        stats[kind].hostNs += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        // a request the library didn't make the way the trace has it would never move on
+        if (trace.position() == from)
+            trace.next(&rec);
+    }
+
+    printf("%-20s %8s %8s %14s %14s\n", "request", "count", "failed", "device us/req", "host ns/req");
+    for (i = 0; i < REQ_COUNT; i++)
+    {
+        if (stats[i].count == 0)
+            continue;
+        printf("%-20s %8u %8u %14llu %14llu\n", stats[i].name, stats[i].count, stats[i].failed,
+               (unsigned long long)(stats[i].deviceUs / stats[i].count), (unsigned long long)(stats[i].hostNs / stats[i].count));
+    }
+    printf("%u bytes of trace, %u mismatches\n", trace.length, trace.mismatches);
+    return trace.mismatches ? 1 : 0;
+}
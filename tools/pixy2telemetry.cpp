@@ -0,0 +1,267 @@
+//
+// Decodes the telemetry stream of startTelemetry() (see Pixy2Telemetry.h)
+// into CSV, one line per item:
+//
+//     blocks,seq,index,signature,x,y,width,height,angle,age
+//     vectors,seq,index,x0,y0,x1,y1,flags
+//     barcodes,seq,position,x,y,flags,code
+//
+// or, with --json, into one JSON object per record.  A summary of bad and
+// missing records goes to stderr at the end.
+//
+// Build from the root of the extension:
+//
+//     g++ -std=c++11 -O2 -Itools/host -I. tools/pixy2telemetry.cpp -o pixy2telemetry
+//
+// and read a saved stream, or the serial port directly (115200 baud):
+//
+//     stty -F /dev/ttyACM0 115200 raw
+//     ./pixy2telemetry /dev/ttyACM0 > frames.csv
+//
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <vector>
+
+#include "TPixy2.h"
+
+struct TelemetryType
+{
+    const char *name;
+    const char *fields[PIXY_TELEMETRY_MAX_FIELDS + 1]; // key first
+    uint8_t numFields;
+    uint8_t signedFields; // bit per field
+};
+
+static const TelemetryType types[PIXY_TELEMETRY_TYPES] = {
+    {"blocks", {"index", "signature", "x", "y", "width", "height", "angle", "age"}, 7, 1 << 5},
+    {"vectors", {"index", "x0", "y0", "x1", "y1", "flags"}, 5, 0},
+    {"barcodes", {"position", "x", "y", "flags", "code"}, 4, 0},
+};
+
+class TelemetryDecoder
+{
+public:
+    TelemetryDecoder(bool json)
+    {
+        m_json = json;
+        m_haveSeq = false;
+        records = crcErrors = lost = skipped = 0;
+        for (int t = 0; t < PIXY_TELEMETRY_TYPES; t++)
+            m_valid[t] = false;
+    }
+
+    // Feed bytes of the stream
+    void feed(const uint8_t *data, size_t len)
+    {
+        m_in.insert(m_in.end(), data, data + len);
+        while (parse())
+            ;
+    }
+
+    uint32_t records;
+    uint32_t crcErrors;
+    uint32_t lost; // seq gaps
+    uint32_t skipped; // delta records without the record they're relative to
+
+private:
+    bool parse();
+    void record(uint8_t type, uint8_t flags, uint16_t seq, const uint8_t *p, uint16_t len);
+    void print(uint8_t type, uint16_t seq, uint8_t flags);
+
+    bool m_json;
+    bool m_haveSeq;
+    uint16_t m_seq;
+    std::vector<uint8_t> m_in;
+    bool m_valid[PIXY_TELEMETRY_TYPES];
+    std::vector<std::vector<uint16_t> > m_items[PIXY_TELEMETRY_TYPES];
+};
+
+// Take one record (or garbage) off the input, returns false if more input is needed
+bool TelemetryDecoder::parse()
+{
+    size_t i;
+    uint16_t len, crc, seq;
+
+    // find the sync bytes
+    for (i = 0; i + 1 < m_in.size() && !(m_in[i] == PIXY_TELEMETRY_SYNC0 && m_in[i + 1] == PIXY_TELEMETRY_SYNC1); i++)
+        ;
+    m_in.erase(m_in.begin(), m_in.begin() + i);
+    if (m_in.size() < PIXY_TELEMETRY_HEADER_SIZE)
+        return false;
+    len = m_in[6] | m_in[7] << 8;
+    if (len > PIXY_TELEMETRY_MAX_PAYLOAD)
+    {
+        // a false sync, don't wait for up to 64 KB of input to find out from the CRC
+        crcErrors++;
+        m_in.erase(m_in.begin(), m_in.begin() + 2);
+        return true;
+    }
+    if (m_in.size() < (size_t)PIXY_TELEMETRY_HEADER_SIZE + len + PIXY_TELEMETRY_CRC_SIZE)
+        return false;
+
+    for (i = 2, crc = 0xffff; i < (size_t)PIXY_TELEMETRY_HEADER_SIZE + len; i++)
+        crc = Pixy2Telemetry::crc16(crc, m_in[i]);
+    if (m_in[i] != (crc & 0xff) || m_in[i + 1] != crc >> 8 || m_in[2] >= PIXY_TELEMETRY_TYPES)
+    {
+        // not a record after all, or a damaged one: look for the next sync
+        crcErrors++;
+        m_in.erase(m_in.begin(), m_in.begin() + 2);
+        return true;
+    }
+
+    seq = m_in[4] | m_in[5] << 8;
+    if (m_haveSeq && seq != (uint16_t)(m_seq + 1))
+    {
+        // the deltas may be against a record we didn't get
+        lost += (uint16_t)(seq - m_seq - 1);
+        for (int t = 0; t < PIXY_TELEMETRY_TYPES; t++)
+            m_valid[t] = false;
+    }
+    m_seq = seq;
+    m_haveSeq = true;
+
+    record(m_in[2], m_in[3], seq, &m_in[PIXY_TELEMETRY_HEADER_SIZE], len);
+    m_in.erase(m_in.begin(), m_in.begin() + PIXY_TELEMETRY_HEADER_SIZE + len + PIXY_TELEMETRY_CRC_SIZE);
+    return true;
+}
+
+void TelemetryDecoder::record(uint8_t type, uint8_t flags, uint16_t seq, const uint8_t *p, uint16_t len)
+{
+    const uint8_t *end = p + len;
+    std::vector<std::vector<uint16_t> > items;
+    uint8_t numItems, numFields, mask, f, shift;
+    uint32_t v;
+    int32_t delta;
+    size_t i, j;
+
+    records++;
+    if (flags & PIXY_TELEMETRY_FLAG_KEY)
+        m_valid[type] = true;
+    if (!m_valid[type])
+    {
+        skipped++;
+        return;
+    }
+
+    numFields = types[type].numFields;
+    numItems = p < end ? *p++ : 0;
+    for (i = 0; i < numItems && p + 2 <= end; i++)
+    {
+        std::vector<uint16_t> item(numFields + 1, 0);
+        const std::vector<uint16_t> *ref = NULL;
+
+        item[0] = *p++;
+        mask = *p++;
+        if (!(mask & PIXY_TELEMETRY_NEW))
+        {
+            for (j = 0; j < m_items[type].size(); j++)
+            {
+                if (m_items[type][j][0] == item[0])
+                    ref = &m_items[type][j];
+            }
+            if (!ref)
+            {
+                // corrupt in a way the CRC didn't catch, wait for a key record
+                m_valid[type] = false;
+                skipped++;
+                return;
+            }
+        }
+        for (f = 0; f < numFields; f++)
+        {
+            if (ref)
+                item[f + 1] = (*ref)[f + 1];
+            if (!(mask & (1 << f)))
+                continue;
+            for (v = 0, shift = 0; p < end; shift += 7)
+            {
+                v |= (uint32_t)(*p & 0x7f) << shift;
+                if (!(*p++ & 0x80))
+                    break;
+            }
+            delta = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+            item[f + 1] += delta;
+        }
+        items.push_back(item);
+    }
+    m_items[type].swap(items);
+    print(type, seq, flags);
+}
+
+void TelemetryDecoder::print(uint8_t type, uint16_t seq, uint8_t flags)
+{
+    const TelemetryType &t = types[type];
+    size_t i;
+    uint8_t f;
+
+    if (m_json)
+        printf("{\"seq\":%u,\"type\":\"%s\",\"truncated\":%s,\"items\":[", seq, t.name,
+               flags & PIXY_TELEMETRY_FLAG_TRUNCATED ? "true" : "false");
+    for (i = 0; i < m_items[type].size(); i++)
+    {
+        const std::vector<uint16_t> &item = m_items[type][i];
+        if (m_json)
+            printf("%s{", i ? "," : "");
+        else
+            printf("%s,%u", t.name, seq);
+        for (f = 0; f <= t.numFields; f++)
+        {
+            int value = f && (t.signedFields & (1 << (f - 1))) ? (int16_t)item[f] : item[f];
+            if (m_json)
+                printf("%s\"%s\":%d", f ? "," : "", t.fields[f], value);
+            else
+                printf(",%d", value);
+        }
+        if (m_json)
+            printf("}");
+        else
+            printf("\n");
+    }
+    if (m_json)
+        printf("]}\n");
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    bool json = false;
+    int fd;
+    uint8_t chunk[256];
+    ssize_t n;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--json"))
+            json = true;
+        else if (!path)
+            path = argv[i];
+        else
+            path = "";
+    }
+    if (!path || !*path)
+    {
+        fprintf(stderr, "usage: %s [--json] stream|-\n", argv[0]);
+        return 2;
+    }
+    // read() returns what's there, so a serial port is decoded as it comes in
+    fd = strcmp(path, "-") ? open(path, O_RDONLY) : 0;
+    if (fd < 0)
+    {
+        perror(path);
+        return 2;
+    }
+
+    TelemetryDecoder decoder(json);
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0)
+        decoder.feed(chunk, n);
+    if (fd)
+        close(fd);
+
+    fprintf(stderr, "%u records, %u bad, %u lost, %u skipped until the next key record\n", decoder.records,
+            decoder.crcErrors, decoder.lost, decoder.skipped);
+    return 0;
+}